@@ -28,6 +28,8 @@
 #include "modify.h"
 #include "asciimap.h"
 #include "quest.h"
+#include "mempool.h"
+#include "keyword.h"
 
 /* prototypes of local functions */
 /* do_diagnose utility functions */
@@ -1600,10 +1602,10 @@ static void print_object_location(int num, struct obj_data *obj, struct char_dat
 
 static void perform_immort_where(struct char_data *ch, char *arg)
 {
-  struct char_data *i;
-  struct obj_data *k;
+  struct char_data *i, **chars;
+  struct obj_data *k, **objs;
   struct descriptor_data *d;
-  int num = 0, found = 0;
+  int num = 0, found = 0, n, j;
 
   if (!*arg) {
     send_to_char(ch, "   ȣ  ġ                           \r\n");
@@ -1624,7 +1626,9 @@ static void perform_immort_where(struct char_data *ch, char *arg)
         }
       }
   } else {
-    for (i = character_list; i; i = i->next)
+    n = keyword_chars(arg, &chars);
+    for (j = 0; j < n; j++) {
+      i = chars[j];
       if (CAN_SEE(ch, i) && IN_ROOM(i) != NOWHERE && isname(arg, i->player.name)) {
         found = 1;
         send_to_char(ch, "M%3d. %-25s%s - [%5d] %-25s%s", ++num, GET_NAME(i), QNRM,
@@ -1637,11 +1641,15 @@ static void perform_immort_where(struct char_data *ch, char *arg)
         }
       send_to_char(ch, "%s\r\n", QNRM);
       }
-    for (num = 0, k = object_list; k; k = k->next)
+    }
+    n = keyword_objs(arg, &objs);
+    for (num = 0, j = 0; j < n; j++) {
+      k = objs[j];
       if (CAN_SEE_OBJ(ch, k) && isname(arg, k->name)) {
         found = 1;
         print_object_location(++num, k, ch, TRUE);
       }
+    }
     if (!found)
       send_to_char(ch, "׷ ã  ϴ.\r\n");
   }
@@ -2340,7 +2348,7 @@ ACMD(do_whois)
 
   if (!(victim=get_player_vis(ch, buf, NULL, FIND_CHAR_WORLD)))
   {
-     CREATE(victim, struct char_data, 1);
+     victim = pool_alloc(char_pool);
      clear_char(victim);
      
      new_mobile_data(victim);
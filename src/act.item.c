@@ -22,6 +22,7 @@
 #include "oasis.h"
 #include "act.h"
 #include "quest.h"
+#include "keyword.h"
 
 
 /* local function prototypes */
@@ -810,6 +811,7 @@ void name_from_drinkcon(struct obj_data *obj)
   if (GET_OBJ_RNUM(obj) == NOTHING || obj->name != obj_proto[GET_OBJ_RNUM(obj)].name)
     free(obj->name);
   obj->name = new_name;
+  keyword_obj_renamed(obj);
 }
 
 void name_to_drinkcon(struct obj_data *obj, int type)
@@ -826,6 +828,7 @@ void name_to_drinkcon(struct obj_data *obj, int type)
     free(obj->name);
 
   obj->name = new_name;
+  keyword_obj_renamed(obj);
 }
 
 ACMD(do_drink)
@@ -34,6 +34,9 @@
 #include "quest.h"
 #include "ban.h"
 #include "screen.h"
+#include "bgsave.h"
+#include "mempool.h"
+#include "keyword.h"
 
 
 /* local utility functions with file scope */
@@ -968,7 +971,7 @@ static void do_stat_character(struct char_data *ch, struct char_data *k)
   }
   if (!(IS_NPC(k))) {
     /* this is a PC, display their global variables */
-    if (k->script && k->script->global_vars) {
+    if (k->script && k->script->global_vars.list) {
       struct trig_var_data *tv;
       char uname[MAX_INPUT_LENGTH];
 
@@ -976,7 +979,7 @@ static void do_stat_character(struct char_data *ch, struct char_data *k)
 
       /* currently, variable context for players is always 0, so it is not
        * displayed here. in the future, this might change */
-      for (tv = k->script->global_vars; tv; tv = tv->next) {
+      for (tv = k->script->global_vars.list; tv; tv = tv->next) {
         if (*(tv->value) == UID_CHAR) {
           find_uid_name(tv->value, uname, sizeof(uname));
           send_to_char(ch, "    %10s:  [UID]: %s\r\n", tv->name, uname);
@@ -1035,7 +1038,7 @@ ACMD(do_stat)
     else if ((victim = get_player_vis(ch, buf2, NULL, FIND_CHAR_WORLD)) != NULL)
 	do_stat_character(ch, victim);
     else {
-      CREATE(victim, struct char_data, 1);
+      victim = pool_alloc(char_pool);
       clear_char(victim);
       CREATE(victim->player_specials, struct player_special_data, 1);
       new_mobile_data(victim);
@@ -1238,6 +1241,7 @@ ACMD(do_switch)
 
     victim->desc = ch->desc;
     ch->desc = NULL;
+    update_zone_players(victim);
   }
 }
 
@@ -1274,6 +1278,7 @@ void return_to_char(struct char_data * ch)
   /* And our body's pointer to descriptor now points to our descriptor. */
   ch->desc->character->desc = ch->desc;
   ch->desc = NULL;  
+  update_zone_players(ch);
 }
 
 ACMD(do_return)
@@ -2067,7 +2072,7 @@ ACMD(do_last)
   }
 
   if (*name && !num) {
-    CREATE(vict, struct char_data, 1);
+    vict = pool_alloc(char_pool);
     clear_char(vict);
     CREATE(vict->player_specials, struct player_special_data, 1);
     new_mobile_data(vict);
@@ -2509,6 +2514,7 @@ ACMD(do_show)
     { "thaco",      LVL_IMMORT },
     { "exp",        LVL_IMMORT },
     { "colour",     LVL_IMMORT },
+    { "memory",     LVL_IMMORT },
     { "\n", 0 }
   };
 
@@ -2591,7 +2597,7 @@ ACMD(do_show)
       return;
     }
 
-    CREATE(vict, struct char_data, 1);
+    vict = pool_alloc(char_pool);
     clear_char(vict);
     CREATE(vict->player_specials, struct player_special_data, 1);
     new_mobile_data(vict);
@@ -2652,8 +2658,7 @@ ACMD(do_show)
 	"  %5d objects          %5d prototypes\r\n"
 	"  %5d rooms            %5d zones\r\n"
   "  %5d triggers         %5d shops\r\n"
-  "  %5d large bufs       %5d autoquests\r\n"
-	"  %5d buf switches     %5d overflows\r\n"
+  "  %5d output overflows %5d autoquests\r\n"
 	"  %5d lists\r\n",
 	i, con,
 	top_of_p_table + 1,
@@ -2661,9 +2666,11 @@ ACMD(do_show)
 	k, top_of_objt + 1,
 	top_of_world + 1, top_of_zone_table + 1,
 	top_of_trigt + 1, top_shop + 1,
-	buf_largecount, total_quests,
-	buf_switches, buf_overflows, global_lists->iSize
+	buf_overflows, total_quests,
+	global_lists->iSize
 	);
+    lookup_table_stats(buf, sizeof(buf));
+    send_to_char(ch, "%s", buf);
     break;
 
   /* show errors */
@@ -2794,6 +2801,12 @@ ACMD(do_show)
     page_string(ch->desc, buf, TRUE);
     break;
 
+  /* show memory pools */
+  case 14:
+    pool_stats(buf, sizeof(buf));
+    page_string(ch->desc, buf, TRUE);
+    break;
+
   /* show what? */
   default:
     send_to_char(ch, "Sorry, I don't understand that.\r\n");
@@ -3395,7 +3408,7 @@ ACMD(do_set)
     }
   } else if (is_file) {
     /* try to load the player off disk */
-    CREATE(cbuf, struct char_data, 1);
+    cbuf = pool_alloc(char_pool);
     clear_char(cbuf);
     CREATE(cbuf->player_specials, struct player_special_data, 1);
     new_mobile_data(cbuf);
@@ -4206,7 +4219,7 @@ ACMD(do_copyover)
 
   /* drop those logging on */
    if (!d->character || d->connected > CON_PLAYING) {
-     write_to_descriptor (d->descriptor, "\n\rSorry, we are rebooting. Come back in a few minutes.\n\r");
+     write_to_client (d, "\n\rSorry, we are rebooting. Come back in a few minutes.\n\r");
      close_socket (d); /* throw'em out */
    } else {
       fprintf (fp, "%d %ld %s %s %s\n", d->descriptor, GET_PREF(och), GET_NAME(och), d->host, CopyoverGet(d));
@@ -4214,13 +4227,16 @@ ACMD(do_copyover)
       GET_LOADROOM(och) = GET_ROOM_VNUM(IN_ROOM(och));
       Crash_rentsave(och,0);
       save_char(och);
-      write_to_descriptor (d->descriptor, buf);
+      write_to_client (d, buf);
     }
   }
 
   fprintf (fp, "-1\n");
   fclose (fp);
 
+  /* The new process reads the player files back at once; finish writing them. */
+  bgsave_flush();
+
   /* exec - descriptors are inherited */
   sprintf (buf, "%d", port);
   sprintf (buf2, "-C%d", mother_desc);
@@ -4632,7 +4648,7 @@ ACMD(do_wizupdate)
 bool change_player_name(struct char_data *ch, struct char_data *vict, char *new_name)
 {
   struct char_data *temp_ch=NULL;
-  int plr_i = 0, i, k;
+  int plr_i = 0, i;
   char old_name[MAX_NAME_LENGTH], old_pfile[50], new_pfile[50], buf[MAX_STRING_LENGTH];
 
   if (!ch)
@@ -4661,7 +4677,7 @@ bool change_player_name(struct char_data *ch, struct char_data *vict, char *new_
     return FALSE;
   } else  {
     /* try to load the player off disk */
-    CREATE(temp_ch, struct char_data, 1);
+    temp_ch = pool_alloc(char_pool);
     clear_char(temp_ch);
     CREATE(temp_ch->player_specials, struct player_special_data, 1);
     new_mobile_data(temp_ch);
@@ -4698,12 +4714,11 @@ bool change_player_name(struct char_data *ch, struct char_data *vict, char *new_
   }
 
   /* Now start changing the name over - all checks and setup have passed */
-  free(player_table[i].name);              // Free the old name in the index
-  player_table[i].name = strdup(new_name); // Insert the new name into the index
-  for (k=0; (*(player_table[i].name+k) = LOWER(*(player_table[i].name+k))); k++);
+  set_player_index_name(i, new_name);    // Insert the new name into the index
 
   free(GET_PC_NAME(vict));
   GET_PC_NAME(vict) = strdup(CAP(new_name));    // Change the name in the victims char struct
+  keyword_char_renamed(vict);
 
   /* Rename the player's pfile */
   sprintf(buf, "mv %s %s", old_pfile, new_pfile);
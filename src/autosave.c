@@ -0,0 +1,168 @@
+/**************************************************************************
+*  File: autosave.c                                        Part of tbaMUD *
+*  Usage: Spreads the periodic player and house autosave over pulses.     *
+*                                                                         *
+*  All rights reserved.  See license for complete information.            *
+*                                                                         *
+*  Copyright (C) 1993, 94 by the Trustees of the Johns Hopkins University *
+*  CircleMUD is based on DikuMUD, Copyright (C) 1990, 1991.               *
+**************************************************************************/
+
+#include "conf.h"
+#include "sysdep.h"
+#include "structs.h"
+#include "utils.h"
+#include "comm.h"
+#include "db.h"
+#include "house.h"
+#include "profiler.h"
+#include "autosave.h"
+
+/* Every CONFIG_AUTOSAVE_TIME minutes autosave_start() queues each player
+ * and house waiting on a crash save, and autosave_step() works through the
+ * queue a few entries a pulse instead of saving them all at once.  Players
+ * are queued by idnum and looked up again when their turn comes, so it
+ * doesn't matter if they quit in between; anyone who saved by other means
+ * meanwhile has lost PLR_CRASH and is skipped. */
+#define SAVE_PLAYER 0
+#define SAVE_HOUSE  1
+
+struct save_job {
+  int type;
+  long id;   /* player idnum or house vnum */
+};
+
+static struct save_job *save_queue = NULL;
+static int save_queue_size = 0;      /* entries allocated */
+static int save_head = 0, save_tail = 0;
+
+/* Counters for the 'profile' command. */
+static unsigned long saves_done = 0;      /* since boot */
+static unsigned long save_usec_total = 0;
+static unsigned long save_usec_max = 0;
+static unsigned long sweep_started = 0;   /* prof_now() at autosave_start() */
+static unsigned long last_sweep_usec = 0; /* start to last save */
+static int last_sweep_saves = 0, sweep_saves = 0;
+static int last_sweep_pulses = 0, sweep_pulses = 0;
+
+static void queue_save(int type, long id)
+{
+  if (save_tail == save_queue_size) {
+    save_queue_size = MAX(32, save_queue_size * 2);
+    RECREATE(save_queue, struct save_job, save_queue_size);
+  }
+  save_queue[save_tail].type = type;
+  save_queue[save_tail].id = id;
+  save_tail++;
+}
+
+/* Queue a fresh sweep.  Anything still waiting from the last one is queued
+ * again anyway if it's still flagged, so the old queue is simply dropped. */
+void autosave_start(void)
+{
+  struct descriptor_data *d;
+  room_vnum houses[MAX_HOUSES];
+  int i, count;
+
+  save_head = save_tail = 0;
+
+  for (d = descriptor_list; d; d = d->next)
+    if (STATE(d) == CON_PLAYING && !IS_NPC(d->character) &&
+        PLR_FLAGGED(d->character, PLR_CRASH))
+      queue_save(SAVE_PLAYER, GET_IDNUM(d->character));
+
+  count = House_save_pending(houses);
+  for (i = 0; i < count; i++)
+    queue_save(SAVE_HOUSE, houses[i]);
+
+  sweep_started = prof_now();
+  sweep_saves = sweep_pulses = 0;
+}
+
+/* Returns TRUE if a save was actually made. */
+static int run_save(struct save_job *job)
+{
+  struct descriptor_data *d;
+  room_rnum rnum;
+
+  if (job->type == SAVE_HOUSE) {
+    if ((rnum = real_room(job->id)) == NOWHERE || !ROOM_FLAGGED(rnum, ROOM_HOUSE_CRASH))
+      return (FALSE);
+    House_crashsave(job->id);
+    return (TRUE);
+  }
+
+  for (d = descriptor_list; d; d = d->next)
+    if (STATE(d) == CON_PLAYING && !IS_NPC(d->character) && GET_IDNUM(d->character) == job->id)
+      break;
+
+  if (!d || !PLR_FLAGGED(d->character, PLR_CRASH))
+    return (FALSE);
+
+  Crash_crashsave(d->character);
+  save_char(d->character);
+  REMOVE_BIT_AR(PLR_FLAGS(d->character), PLR_CRASH);
+  return (TRUE);
+}
+
+/* Called every pulse; saves queued entries until the budget is spent.
+ * Returns the number of saves made. */
+int autosave_step(void)
+{
+  unsigned long start, before, after, took;
+  int saved = 0;
+
+  if (save_head == save_tail)
+    return (0);
+
+  start = after = prof_now();
+  sweep_pulses++;
+
+  do {
+    before = after;
+    if (!run_save(&save_queue[save_head++]))
+      continue;
+    after = prof_now();
+    took = after - before;
+
+    saved++;
+    saves_done++;
+    save_usec_total += took;
+    save_usec_max = MAX(save_usec_max, took);
+  } while (save_head < save_tail && after - start < AUTOSAVE_BUDGET_USEC);
+
+  sweep_saves += saved;
+  if (save_head == save_tail) {
+    last_sweep_usec = after - sweep_started;
+    last_sweep_saves = sweep_saves;
+    last_sweep_pulses = sweep_pulses;
+  }
+
+  return (saved);
+}
+
+/* Finish the current sweep right now, for shutdown and the like. */
+void autosave_flush(void)
+{
+  while (save_head < save_tail)
+    run_save(&save_queue[save_head++]);
+}
+
+void free_autosave(void)
+{
+  if (save_queue)
+    free(save_queue);
+  save_queue = NULL;
+  save_queue_size = save_head = save_tail = 0;
+}
+
+/* One status line for the 'profile' command. */
+size_t autosave_status(char *buf, size_t len)
+{
+  return snprintf(buf, len,
+      "Autosave: %d queued, %lu saves (avg %lu us, max %lu us); last sweep "
+      "%d saves over %d pulses in %lu ms.\r\n",
+      save_tail - save_head, saves_done,
+      saves_done ? save_usec_total / saves_done : 0, save_usec_max,
+      last_sweep_saves, last_sweep_pulses, last_sweep_usec / 1000);
+}
@@ -0,0 +1,24 @@
+/**************************************************************************
+*  File: autosave.h                                        Part of tbaMUD *
+*  Usage: Spreads the periodic player and house autosave over pulses.     *
+*                                                                         *
+*  All rights reserved.  See license for complete information.            *
+*                                                                         *
+*  Copyright (C) 1993, 94 by the Trustees of the Johns Hopkins University *
+*  CircleMUD is based on DikuMUD, Copyright (C) 1990, 1991.               *
+**************************************************************************/
+#ifndef AUTOSAVE_H_
+#define AUTOSAVE_H_
+
+/* How long autosave_step() may spend saving in one pulse, in microseconds.
+ * At least one save is made each pulse, however long it takes. */
+#define AUTOSAVE_BUDGET_USEC 5000
+
+/* Exported function prototypes */
+void autosave_start(void);
+int autosave_step(void);
+void autosave_flush(void);
+void free_autosave(void);
+size_t autosave_status(char *buf, size_t len);
+
+#endif /* AUTOSAVE_H_ */
@@ -26,9 +26,36 @@ int num_invalid = 0;
 #define MAX_INVALID_NAMES 200
 static char *invalid_list[MAX_INVALID_NAMES];
 
+/* The ban list, compiled.  A site is banned by every entry that appears
+ * anywhere in its name, so the entries go into an Aho-Corasick automaton
+ * that finds all of them in one pass over the name, however many there
+ * are.  Entries written as address blocks, like 10.1.0.0/16, go into a
+ * binary trie over the bits of the address instead.  Each node carries the
+ * worst ban type of every entry that ends on it, or, in the automaton, on
+ * any node its failure links lead to. */
+struct ban_match {
+  int child;      /* first node one character on, or -1 */
+  int sibling;    /* next child of the same parent, or -1 */
+  int fail;       /* longest proper suffix that is also in the automaton */
+  char c;         /* the character leading here from the parent */
+  byte type;      /* worst ban type found on reaching here */
+};
+
+struct ban_block {
+  int child[2];   /* the next bit of the address a 0 or a 1, or -1 */
+  byte type;      /* worst ban on addresses with this prefix */
+};
+
+static struct ban_match *ban_names = NULL;
+static int num_ban_names = 0, max_ban_names = 0;
+static struct ban_block *ban_blocks = NULL;
+static int num_ban_blocks = 0, max_ban_blocks = 0;
+
 /* local utility functions */
 static void write_ban_list(void);
 static void _write_one_node(FILE *fp, struct ban_list_element *node);
+static int parse_block(const char *site, unsigned long *net, int *bits);
+static void compile_bans(void);
 
 static const char *ban_types[] = {
   "no",
@@ -72,24 +99,192 @@ void load_banned(void)
   }
 
   fclose(fl);
+  compile_bans();
 }
 
+/* Reads an address block, a.b.c.d/bits, into the network and its length.
+ * The bits of the address past the prefix are ignored. */
+static int parse_block(const char *site, unsigned long *net, int *bits)
+{
+  unsigned int a, b, c, d, n;
+  char extra;
+
+  if (sscanf(site, "%u.%u.%u.%u/%u%c", &a, &b, &c, &d, &n, &extra) != 5)
+    return (FALSE);
+  if (a > 255 || b > 255 || c > 255 || d > 255 || n > 32)
+    return (FALSE);
+
+  *net = ((unsigned long) a << 24) | (b << 16) | (c << 8) | d;
+  *bits = n;
+  return (TRUE);
+}
+
+static int new_ban_name(char c)
+{
+  struct ban_match *m;
+
+  if (num_ban_names >= max_ban_names) {
+    max_ban_names = MAX(64, max_ban_names * 2);
+    RECREATE(ban_names, struct ban_match, max_ban_names);
+  }
+  m = &ban_names[num_ban_names];
+  m->child = m->sibling = -1;
+  m->fail = 0;
+  m->c = c;
+  m->type = BAN_NOT;
+
+  return (num_ban_names++);
+}
+
+static int new_ban_block(void)
+{
+  struct ban_block *b;
+
+  if (num_ban_blocks >= max_ban_blocks) {
+    max_ban_blocks = MAX(64, max_ban_blocks * 2);
+    RECREATE(ban_blocks, struct ban_block, max_ban_blocks);
+  }
+  b = &ban_blocks[num_ban_blocks];
+  b->child[0] = b->child[1] = -1;
+  b->type = BAN_NOT;
+
+  return (num_ban_blocks++);
+}
+
+/* The node one 'c' on from 'node' in the automaton, or -1. */
+static int ban_name_step(int node, char c)
+{
+  for (node = ban_names[node].child; node >= 0; node = ban_names[node].sibling)
+    if (ban_names[node].c == c)
+      return (node);
+  return (-1);
+}
+
+static void add_ban_name(const char *site, int type)
+{
+  int node = 0, next;
+  char c;
+
+  for (; *site; site++) {
+    c = LOWER(*site);
+    if ((next = ban_name_step(node, c)) < 0) {
+      next = new_ban_name(c);
+      ban_names[next].sibling = ban_names[node].child;
+      ban_names[node].child = next;
+    }
+    node = next;
+  }
+  ban_names[node].type = MAX(ban_names[node].type, type);
+}
+
+static void add_ban_block(unsigned long net, int bits, int type)
+{
+  int node = 0, next, bit, i;
+
+  for (i = 0; i < bits; i++) {
+    bit = (net >> (31 - i)) & 1;
+    if ((next = ban_blocks[node].child[bit]) < 0) {
+      next = new_ban_block();
+      ban_blocks[node].child[bit] = next;
+    }
+    node = next;
+  }
+  ban_blocks[node].type = MAX(ban_blocks[node].type, type);
+}
+
+/* Rebuilds the automaton and the trie from ban_list.  Called whenever the
+ * list changes. */
+static void compile_bans(void)
+{
+  struct ban_list_element *ban_node;
+  unsigned long net;
+  int *queue, head = 0, tail = 0, node, child, fail, next, bits;
+
+  num_ban_names = num_ban_blocks = 0;
+  new_ban_name('\0');
+  new_ban_block();
+
+  for (ban_node = ban_list; ban_node; ban_node = ban_node->next) {
+    if (parse_block(ban_node->site, &net, &bits))
+      add_ban_block(net, bits, ban_node->type);
+    else
+      add_ban_name(ban_node->site, ban_node->type);
+  }
+
+  /* Failure links, breadth first so that every node's link points at a
+   * node already done. */
+  CREATE(queue, int, num_ban_names);
+  queue[tail++] = 0;
+  while (head < tail) {
+    node = queue[head++];
+    for (child = ban_names[node].child; child >= 0; child = ban_names[child].sibling) {
+      queue[tail++] = child;
+      if (node == 0)
+        continue;
+
+      for (fail = ban_names[node].fail;
+           (next = ban_name_step(fail, ban_names[child].c)) < 0 && fail; )
+        fail = ban_names[fail].fail;
+      ban_names[child].fail = MAX(next, 0);
+    }
+    if (node)
+      ban_names[node].type = MAX(ban_names[node].type, ban_names[ban_names[node].fail].type);
+  }
+  free(queue);
+}
+
+/** The worst ban on any entry that appears in 'hostname', ignoring case.
+ * An address block only counts against a numeric hostname. */
 int isbanned(char *hostname)
 {
-  int i;
-  struct ban_list_element *banned_node;
-  char *nextchar;
+  struct in_addr addr;
+  int i, node, next;
+  char *p, c;
+
+  if (!hostname || !*hostname || !ban_names)
+    return (BAN_NOT);
+
+  i = ban_names[0].type;
+  for (node = 0, p = hostname; *p && i < BAN_ALL; p++) {
+    c = LOWER(*p);
+    while ((next = ban_name_step(node, c)) < 0 && node)
+      node = ban_names[node].fail;
+    node = MAX(next, 0);
+    i = MAX(i, ban_names[node].type);
+  }
+
+  if (i < BAN_ALL && inet_aton(hostname, &addr))
+    i = MAX(i, isbanned_addr(addr));
+
+  return (i);
+}
+
+/** The worst ban on an address block holding 'addr'. */
+int isbanned_addr(struct in_addr addr)
+{
+  unsigned long a = ntohl(addr.s_addr);
+  int i, node, bit;
 
-  if (!hostname || !*hostname)
-    return (0);
+  if (!ban_blocks)
+    return (BAN_NOT);
 
-  i = 0;
-  for (nextchar = hostname; *nextchar; nextchar++)
-    *nextchar = LOWER(*nextchar);
+  i = ban_blocks[0].type;
+  for (node = 0, bit = 31; bit >= 0 && i < BAN_ALL; bit--) {
+    if ((node = ban_blocks[node].child[(a >> bit) & 1]) < 0)
+      break;
+    i = MAX(i, ban_blocks[node].type);
+  }
+
+  return (i);
+}
 
-  for (banned_node = ban_list; banned_node; banned_node = banned_node->next)
-    if (strstr(hostname, banned_node->site))	/* if hostname is a substring */
-      i = MAX(i, banned_node->type);
+/** The worst ban on d: on the name of its site, or on its address. */
+int site_banned(struct descriptor_data *d)
+{
+  int i = isbanned(d->host);
+
+  if (d->addr.s_addr)
+    i = MAX(i, isbanned_addr(d->addr));
 
   return (i);
 }
@@ -121,7 +316,8 @@ ACMD(do_ban)
 {
   char flag[MAX_INPUT_LENGTH], site[MAX_INPUT_LENGTH], *nextchar;
   char timestr[16];
-  int i;
+  unsigned long net;
+  int i, bits;
   struct ban_list_element *ban_node;
 
   if (!*argument) {
@@ -160,6 +356,10 @@ ACMD(do_ban)
     send_to_char(ch, "Flag must be ALL, SELECT, or NEW.\r\n");
     return;
   }
+  if (strchr(site, '/') && !parse_block(site, &net, &bits)) {
+    send_to_char(ch, "Address blocks are written like 10.1.0.0/16.\r\n");
+    return;
+  }
   for (ban_node = ban_list; ban_node; ban_node = ban_node->next) {
     if (!str_cmp(ban_node->site, site)) {
       send_to_char(ch, "That site has already been banned -- unban it to change the ban type.\r\n");
@@ -182,6 +382,7 @@ ACMD(do_ban)
 
   ban_node->next = ban_list;
   ban_list = ban_node;
+  compile_bans();
 
   mudlog(NRM, MAX(LVL_GOD, GET_INVIS_LEV(ch)), TRUE, "%s has banned %s for %s players.",
 	GET_NAME(ch), site, ban_types[ban_node->type]);
@@ -219,6 +420,7 @@ ACMD(do_unban)
 	GET_NAME(ch), ban_types[ban_node->type], ban_node->site);
 
   free(ban_node);
+  compile_bans();
   write_ban_list();
 }
 
@@ -37,6 +37,8 @@ struct ban_list_element {
 /* Utility Functions */
 void load_banned(void);
 int isbanned(char *hostname);
+int isbanned_addr(struct in_addr addr);
+int site_banned(struct descriptor_data *d);
 int valid_name(char *newname);
 void read_invalid_list(void);
 void free_invalid_list(void);
@@ -0,0 +1,394 @@
+/**************************************************************************
+*  File: bgsave.c                                          Part of tbaMUD *
+*  Usage: Hands player and rent files to a thread that writes them out.   *
+*                                                                         *
+*  All rights reserved.  See license for complete information.            *
+*                                                                         *
+*  Copyright (C) 1993, 94 by the Trustees of the Johns Hopkins University *
+*  CircleMUD is based on DikuMUD, Copyright (C) 1990, 1991.               *
+**************************************************************************/
+
+#include "conf.h"
+#include "sysdep.h"
+#include "structs.h"
+#include "utils.h"
+#include "comm.h"
+#include "bgsave.h"
+
+/* save_char() and the Crash_*save() functions print into memory through
+ * bgsave_open(), and bgsave_commit() queues the result.  A single thread
+ * takes whatever has queued up as one batch, writes each file to
+ * "<name>.tmp", fsyncs the whole batch, renames each over the real file
+ * and fsyncs the directories once, so a crash leaves either the old file
+ * or the new one.  A file queued again before the thread reached it just
+ * has its contents replaced, so writes to one file land in order.
+ *
+ * Anything that reads, removes or renames one of these files must call
+ * bgsave_sync() on it first, and bgsave_flush() waits for everything;
+ * copyover and shutdown use it.  The thread never logs itself: failures
+ * are queued and reported by bgsave_poll() on the game thread.  Without
+ * pthreads, with the zmalloc memory checker (which is not thread safe), or
+ * before bgsave_init(), files are written on the spot. */
+#if defined(HAVE_PTHREAD) && !defined(MEMORY_DEBUG)
+#define BGSAVE_THREAD
+#endif
+
+struct bgsave_job {
+  char *path;
+  char *data;
+  size_t len;
+  int fd;        /* temp file, while the batch is being written */
+  struct bgsave_job *next;
+};
+
+struct bgsave_error {
+  char msg[MAX_INPUT_LENGTH];
+  struct bgsave_error *next;
+};
+
+static struct bgsave_error *errors = NULL;
+
+#ifdef BGSAVE_THREAD
+static struct bgsave_job *pending = NULL, *pending_tail = NULL;
+static struct bgsave_job *inflight = NULL;  /* the batch being written */
+static pthread_t bgsave_thread;
+static pthread_mutex_t bgsave_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t bgsave_work = PTHREAD_COND_INITIALIZER; /* jobs queued */
+static pthread_cond_t bgsave_done = PTHREAD_COND_INITIALIZER; /* batch written */
+static int bgsave_running = FALSE, bgsave_stopping = FALSE;
+#define LOCK()   pthread_mutex_lock(&bgsave_lock)
+#define UNLOCK() pthread_mutex_unlock(&bgsave_lock)
+#else
+#define LOCK()
+#define UNLOCK()
+#endif
+
+/* open_memstream() buffers come from the C library's malloc, so they go back
+ * to its own free even when the zmalloc checker has taken the name. */
+static void free_buffer(char *buf)
+{
+#ifdef HAVE_OPEN_MEMSTREAM
+  (free)(buf);
+#else
+  free(buf);
+#endif
+}
+
+static void free_job(struct bgsave_job *job)
+{
+  if (job->data)
+    free_buffer(job->data);
+  free(job->path);
+  free(job);
+}
+
+/* Safe to call from either thread. */
+static void bgsave_error(const char *path, const char *what)
+{
+  struct bgsave_error *err, **tail;
+
+  CREATE(err, struct bgsave_error, 1);
+  snprintf(err->msg, sizeof(err->msg), "SYSERR: bgsave: %s %s: %s", what, path, strerror(errno));
+
+  LOCK();
+  for (tail = &errors; *tail; tail = &(*tail)->next)
+    ;
+  *tail = err;
+  UNLOCK();
+}
+
+static int write_all(int fd, const char *data, size_t len)
+{
+  ssize_t done;
+
+  while (len > 0) {
+    if ((done = write(fd, data, len)) < 0) {
+      if (errno == EINTR)
+        continue;
+      return (FALSE);
+    }
+    data += done;
+    len -= done;
+  }
+  return (TRUE);
+}
+
+/* Length of the directory part of 'path', 0 for the current directory. */
+static size_t dir_length(const char *path)
+{
+  const char *slash = strrchr(path, '/');
+
+  return (slash ? (size_t) (slash - path) : 0);
+}
+
+static void sync_dir(const char *path, size_t len)
+{
+  char dir[MAX_INPUT_LENGTH];
+  int fd;
+
+  if (len >= sizeof(dir))
+    return;
+  if (len)
+    strlcpy(dir, path, len + 1);
+  else
+    strcpy(dir, ".");	/* strcpy: OK */
+
+  if ((fd = open(dir, O_RDONLY)) < 0)
+    return;
+  fsync(fd);
+  close(fd);
+}
+
+/* Write out every job in 'batch'; see the comment at the top. */
+static void write_batch(struct bgsave_job *batch)
+{
+  char tmp[MAX_INPUT_LENGTH];
+  struct bgsave_job *job, *prev;
+
+  for (job = batch; job; job = job->next) {
+    snprintf(tmp, sizeof(tmp), "%s.tmp", job->path);
+    if ((job->fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0666)) < 0) {
+      bgsave_error(tmp, "can't create");
+      continue;
+    }
+    if (!write_all(job->fd, job->data, job->len)) {
+      bgsave_error(tmp, "can't write");
+      close(job->fd);
+      job->fd = -1;
+      unlink(tmp);
+    }
+  }
+
+  for (job = batch; job; job = job->next) {
+    if (job->fd < 0)
+      continue;
+    snprintf(tmp, sizeof(tmp), "%s.tmp", job->path);
+    if (fsync(job->fd) < 0 || close(job->fd) < 0 || rename(tmp, job->path) < 0) {
+      bgsave_error(job->path, "can't replace");
+      unlink(tmp);
+    }
+  }
+
+  /* The renames aren't durable until their directories are synced. */
+  for (job = batch; job; job = job->next) {
+    size_t len = dir_length(job->path);
+
+    for (prev = batch; prev != job; prev = prev->next)
+      if (dir_length(prev->path) == len && !strncmp(prev->path, job->path, len))
+        break;
+    if (prev == job)
+      sync_dir(job->path, len);
+  }
+}
+
+#ifdef BGSAVE_THREAD
+static void *bgsave_main(void *unused)
+{
+  struct bgsave_job *batch;
+
+  LOCK();
+  for (;;) {
+    while (!pending && !bgsave_stopping)
+      pthread_cond_wait(&bgsave_work, &bgsave_lock);
+    if (!pending)
+      break;
+
+    inflight = pending;
+    pending = pending_tail = NULL;
+    UNLOCK();
+
+    write_batch(inflight);
+
+    LOCK();
+    while ((batch = inflight) != NULL) {
+      inflight = batch->next;
+      free_job(batch);
+    }
+    pthread_cond_broadcast(&bgsave_done);
+  }
+  UNLOCK();
+
+  return (NULL);
+}
+#endif
+
+void bgsave_init(void)
+{
+#ifdef BGSAVE_THREAD
+  sigset_t all, old;
+
+  /* Signals are for the game thread. */
+  sigfillset(&all);
+  pthread_sigmask(SIG_SETMASK, &all, &old);
+  if (pthread_create(&bgsave_thread, NULL, bgsave_main, NULL) != 0)
+    log("SYSERR: bgsave: no writer thread, saving synchronously: %s", strerror(errno));
+  else
+    bgsave_running = TRUE;
+  pthread_sigmask(SIG_SETMASK, &old, NULL);
+#endif
+}
+
+/* Write out everything queued, then stop the thread. */
+void bgsave_shutdown(void)
+{
+#ifdef BGSAVE_THREAD
+  if (bgsave_running) {
+    LOCK();
+    bgsave_stopping = TRUE;
+    pthread_cond_signal(&bgsave_work);
+    UNLOCK();
+    pthread_join(bgsave_thread, NULL);
+    bgsave_running = bgsave_stopping = FALSE;
+  }
+#endif
+  bgsave_poll();
+}
+
+/* Start a replacement for 'path'.  Returns the stream to print into, or NULL
+ * if there's no memory for one. */
+FILE *bgsave_open(struct bgsave_file *bf, const char *path)
+{
+  bf->path = strdup(path);
+  bf->buf = NULL;
+  bf->len = 0;
+
+#ifdef HAVE_OPEN_MEMSTREAM
+  bf->fl = open_memstream(&bf->buf, &bf->len);
+#else
+  bf->fl = tmpfile();
+#endif
+
+  if (!bf->fl) {
+    bgsave_error(path, "can't buffer");
+    free(bf->path);
+  }
+  return (bf->fl);
+}
+
+void bgsave_abort(struct bgsave_file *bf)
+{
+  fclose(bf->fl);
+  if (bf->buf)
+    free_buffer(bf->buf);
+  free(bf->path);
+}
+
+/* Queue what was printed to 'bf' to replace its file. */
+void bgsave_commit(struct bgsave_file *bf)
+{
+  struct bgsave_job *job;
+
+#ifndef HAVE_OPEN_MEMSTREAM
+  long len;
+
+  if (fflush(bf->fl) == 0 && (len = ftell(bf->fl)) >= 0) {
+    CREATE(bf->buf, char, len + 1);
+    rewind(bf->fl);
+    bf->len = fread(bf->buf, 1, len, bf->fl);
+  }
+#endif
+
+  if (fclose(bf->fl) != 0 || !bf->buf) {
+    bgsave_error(bf->path, "can't buffer");
+    if (bf->buf)
+      free_buffer(bf->buf);
+    free(bf->path);
+    return;
+  }
+
+  CREATE(job, struct bgsave_job, 1);
+  job->path = bf->path;
+  job->data = bf->buf;
+  job->len = bf->len;
+  job->fd = -1;
+
+#ifdef BGSAVE_THREAD
+  if (bgsave_running) {
+    struct bgsave_job *queued;
+
+    LOCK();
+    for (queued = pending; queued; queued = queued->next)
+      if (!strcmp(queued->path, job->path))
+        break;
+
+    if (queued) {	/* not started yet: just swap the contents */
+      free_buffer(queued->data);
+      queued->data = job->data;
+      queued->len = job->len;
+      job->data = NULL;
+    } else {
+      if (pending_tail)
+        pending_tail->next = job;
+      else
+        pending = job;
+      pending_tail = job;
+      job = NULL;
+      pthread_cond_signal(&bgsave_work);
+    }
+    UNLOCK();
+
+    if (job)
+      free_job(job);
+    return;
+  }
+#endif
+
+  write_batch(job);
+  free_job(job);
+}
+
+#ifdef BGSAVE_THREAD
+static int job_listed(struct bgsave_job *list, const char *path)
+{
+  for (; list; list = list->next)
+    if (!strcmp(list->path, path))
+      return (TRUE);
+  return (FALSE);
+}
+#endif
+
+/* Wait until nothing is queued or being written for 'path'. */
+void bgsave_sync(const char *path)
+{
+#ifdef BGSAVE_THREAD
+  if (!bgsave_running)
+    return;
+
+  LOCK();
+  while (job_listed(pending, path) || job_listed(inflight, path))
+    pthread_cond_wait(&bgsave_done, &bgsave_lock);
+  UNLOCK();
+#endif
+}
+
+/* Wait until everything queued so far is on disk. */
+void bgsave_flush(void)
+{
+#ifdef BGSAVE_THREAD
+  if (!bgsave_running)
+    return;
+
+  LOCK();
+  while (pending || inflight)
+    pthread_cond_wait(&bgsave_done, &bgsave_lock);
+  UNLOCK();
+#endif
+  bgsave_poll();
+}
+
+/* Report any failures from the writer; called by the game thread. */
+void bgsave_poll(void)
+{
+  struct bgsave_error *list, *err;
+
+  LOCK();
+  list = errors;
+  errors = NULL;
+  UNLOCK();
+
+  while ((err = list) != NULL) {
+    list = err->next;
+    mudlog(BRF, LVL_GOD, TRUE, "%s", err->msg);
+    free(err);
+  }
+}
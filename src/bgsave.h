@@ -0,0 +1,33 @@
+/**************************************************************************
+*  File: bgsave.h                                          Part of tbaMUD *
+*  Usage: Hands player and rent files to a thread that writes them out.   *
+*                                                                         *
+*  All rights reserved.  See license for complete information.            *
+*                                                                         *
+*  Copyright (C) 1993, 94 by the Trustees of the Johns Hopkins University *
+*  CircleMUD is based on DikuMUD, Copyright (C) 1990, 1991.               *
+**************************************************************************/
+#ifndef BGSAVE_H_
+#define BGSAVE_H_
+
+/** A file being written.  The caller fills 'fl' with the usual stdio calls
+ * and then either commits or abandons it; the file on disk is replaced in
+ * one step or not at all. */
+struct bgsave_file {
+  FILE *fl;          /**< Where to write; in memory, not the real file */
+  char *path;        /**< The file this will replace */
+  char *buf;         /**< open_memstream() buffer */
+  size_t len;        /**< ...and its length */
+};
+
+/* Exported function prototypes */
+void bgsave_init(void);
+void bgsave_shutdown(void);
+FILE *bgsave_open(struct bgsave_file *bf, const char *path);
+void bgsave_commit(struct bgsave_file *bf);
+void bgsave_abort(struct bgsave_file *bf);
+void bgsave_sync(const char *path);
+void bgsave_flush(void);
+void bgsave_poll(void);
+
+#endif /* BGSAVE_H_ */
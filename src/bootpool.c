@@ -0,0 +1,260 @@
+/**************************************************************************
+*  File: bootpool.c                                        Part of tbaMUD *
+*  Usage: Parses world files on worker threads during boot.               *
+*                                                                         *
+*  All rights reserved.  See license for complete information.            *
+*                                                                         *
+*  Copyright (C) 1993, 94 by the Trustees of the Johns Hopkins University *
+*  CircleMUD is based on DikuMUD, Copyright (C) 1990, 1991.               *
+**************************************************************************/
+
+#include "conf.h"
+#include "sysdep.h"
+#include "structs.h"
+#include "utils.h"
+#include "bootpool.h"
+
+/* bootpool_run() hands jobs (one per world file) to a few threads in index
+ * order.  A job may only build private data; everything else it does goes
+ * through bootpool_defer(), and anything it logs is captured by
+ * basic_mud_vlog() instead of being written.  The game thread waits for job
+ * 0, replays its events, then waits for job 1, and so on, so the log and
+ * the world come out exactly as if the files had been read one by one.
+ *
+ * A job that hits a fatal error calls bootpool_fail() where it used to
+ * exit(1): its thread stops, and once the game thread has replayed that
+ * job up to the error it exits in its place.  Without pthreads, with one
+ * CPU, or with the zmalloc memory checker (which is not thread safe), the
+ * jobs are run on the game thread in order. */
+#if defined(HAVE_PTHREAD) && !defined(MEMORY_DEBUG)
+#define BOOTPOOL_THREADS
+#endif
+
+struct boot_job {
+  struct boot_event *events;  /* recorded so far, in order */
+  struct boot_event *last;
+  int done;                   /* parse() returned or the job failed */
+  int failed;
+};
+
+static struct boot_job *boot_jobs = NULL;
+static int boot_njobs = 0;
+static boot_job_fn boot_parse = NULL;
+static boot_replay_fn boot_replay = NULL;
+static int boot_serial_job = -1;  /* job running on the game thread */
+
+#ifdef BOOTPOOL_THREADS
+static int boot_threaded = FALSE;
+static int boot_next = 0;         /* next job to hand out */
+static pthread_key_t boot_key;    /* the calling worker's boot_job */
+static pthread_mutex_t boot_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t boot_finished = PTHREAD_COND_INITIALIZER;
+
+#define LOCK()   pthread_mutex_lock(&boot_lock)
+#define UNLOCK() pthread_mutex_unlock(&boot_lock)
+#endif
+
+/** The job the caller is running, or -1 when it is not running one. */
+int bootpool_job(void)
+{
+#ifdef BOOTPOOL_THREADS
+  if (boot_threaded) {
+    struct boot_job *cur = pthread_getspecific(boot_key);
+
+    return (cur ? cur - boot_jobs : -1);
+  }
+#endif
+  return (boot_serial_job);
+}
+
+static void bootpool_record(int job, int kind, int num, char *text)
+{
+  struct boot_event *ev;
+
+  CREATE(ev, struct boot_event, 1);
+  ev->kind = kind;
+  ev->num = num;
+  ev->text = text;
+
+  if (boot_jobs[job].last)
+    boot_jobs[job].last->next = ev;
+  else
+    boot_jobs[job].events = ev;
+  boot_jobs[job].last = ev;
+}
+
+/** Records an event for the game thread to replay.  Returns FALSE, and
+ * records nothing, if the caller is not running a job. */
+int bootpool_defer(int kind, int num)
+{
+  int job = bootpool_job();
+
+  if (job < 0)
+    return (FALSE);
+
+  bootpool_record(job, kind, num, NULL);
+  return (TRUE);
+}
+
+/** Called by basic_mud_vlog(): keeps the line for replay and returns TRUE
+ * if the caller is running a job, otherwise returns FALSE. */
+int bootpool_capture(const char *format, va_list args)
+{
+  char buf[MAX_STRING_LENGTH];
+  int job = bootpool_job();
+
+  if (job < 0)
+    return (FALSE);
+
+  vsnprintf(buf, sizeof(buf), format, args);
+  bootpool_record(job, BOOT_EVENT_LOG, 0, strdup(buf));
+  return (TRUE);
+}
+
+static void bootpool_replay(int job, boot_replay_fn replay)
+{
+  struct boot_event *ev, *next;
+
+  for (ev = boot_jobs[job].events; ev; ev = next) {
+    next = ev->next;
+    if (ev->kind == BOOT_EVENT_LOG)
+      basic_mud_log("%s", ev->text);
+    else
+      replay(job, ev);
+    if (ev->text)
+      free(ev->text);
+    free(ev);
+  }
+  boot_jobs[job].events = boot_jobs[job].last = NULL;
+}
+
+#ifdef BOOTPOOL_THREADS
+static void bootpool_finish(int job)
+{
+  LOCK();
+  boot_jobs[job].done = TRUE;
+  pthread_cond_signal(&boot_finished);
+  UNLOCK();
+}
+
+static void *bootpool_main(void *arg)
+{
+  int job;
+
+  for (;;) {
+    LOCK();
+    job = (boot_next < boot_njobs ? boot_next++ : -1);
+    UNLOCK();
+
+    if (job < 0)
+      return (NULL);
+
+    pthread_setspecific(boot_key, &boot_jobs[job]);
+    boot_parse(job);
+    pthread_setspecific(boot_key, NULL);
+    bootpool_finish(job);
+  }
+}
+
+/* How many threads to start for 'njobs' jobs; 1 means none. */
+static int bootpool_threads(int njobs)
+{
+  long cpus = 1;
+
+#ifdef _SC_NPROCESSORS_ONLN
+  cpus = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+  return (MAX(1, MIN(MIN(cpus, BOOTPOOL_MAX_THREADS), njobs)));
+}
+#endif
+
+/** Stops the calling job after a fatal error; outside a job it just exits.
+ * Never returns. */
+void bootpool_fail(void)
+{
+  int job = bootpool_job();
+
+  if (job < 0)
+    exit(1);
+
+  boot_jobs[job].failed = TRUE;
+
+#ifdef BOOTPOOL_THREADS
+  if (boot_threaded) {
+    bootpool_finish(job);
+    pthread_exit(NULL);
+  }
+#endif
+
+  /* Running on the game thread: nobody else will replay it. */
+  boot_serial_job = -1;
+  bootpool_replay(job, boot_replay);
+  exit(1);
+}
+
+void bootpool_run(int njobs, boot_job_fn parse, boot_replay_fn replay)
+{
+  int job = 0;
+#ifdef BOOTPOOL_THREADS
+  pthread_t threads[BOOTPOOL_MAX_THREADS];
+  sigset_t all, old;
+  int nthreads, i;
+#endif
+
+  if (njobs <= 0)
+    return;
+
+  CREATE(boot_jobs, struct boot_job, njobs);
+  boot_njobs = njobs;
+  boot_parse = parse;
+  boot_replay = replay;
+
+#ifdef BOOTPOOL_THREADS
+  if ((nthreads = bootpool_threads(njobs)) > 1 && pthread_key_create(&boot_key, NULL) == 0) {
+    boot_threaded = TRUE;
+    boot_next = 0;
+
+    /* Signals stay with the game thread. */
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    for (i = 0; i < nthreads; i++)
+      if (pthread_create(&threads[i], NULL, bootpool_main, NULL) != 0)
+        break;
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    if ((nthreads = i) > 0) {
+      for (job = 0; job < njobs; job++) {
+        LOCK();
+        while (!boot_jobs[job].done)
+          pthread_cond_wait(&boot_finished, &boot_lock);
+        UNLOCK();
+
+        bootpool_replay(job, replay);
+        if (boot_jobs[job].failed)
+          exit(1);
+      }
+      job = njobs;
+
+      for (i = 0; i < nthreads; i++)
+        pthread_join(threads[i], NULL);
+    } else
+      log("SYSERR: bootpool_run: unable to start any threads, parsing in order.");
+
+    boot_threaded = FALSE;
+    pthread_key_delete(boot_key);
+  }
+#endif
+
+  /* No threads: run every job here, in order. */
+  for (; job < njobs; job++) {
+    boot_serial_job = job;
+    parse(job);
+    boot_serial_job = -1;
+    bootpool_replay(job, replay);
+  }
+
+  free(boot_jobs);
+  boot_jobs = NULL;
+  boot_njobs = 0;
+}
@@ -0,0 +1,42 @@
+/**************************************************************************
+*  File: bootpool.h                                        Part of tbaMUD *
+*  Usage: Parses world files on worker threads during boot.               *
+*                                                                         *
+*  All rights reserved.  See license for complete information.            *
+*                                                                         *
+*  Copyright (C) 1993, 94 by the Trustees of the Johns Hopkins University *
+*  CircleMUD is based on DikuMUD, Copyright (C) 1990, 1991.               *
+**************************************************************************/
+#ifndef BOOTPOOL_H_
+#define BOOTPOOL_H_
+
+/* Anything a job does that other code could observe is recorded instead,
+ * and replayed on the main thread in job order. */
+#define BOOT_EVENT_LOG      0  /**< a log line, in 'text' */
+#define BOOT_EVENT_ROOM     1  /**< staged room 'num' of this file begins */
+#define BOOT_EVENT_TRIGGER  2  /**< attach trigger vnum 'num' to that room */
+#define BOOT_EVENT_SAVE     3  /**< add zone vnum 'num' to the OLC save list */
+
+/* No more worker threads than this, whatever the CPU count. */
+#define BOOTPOOL_MAX_THREADS 8
+
+struct boot_event {
+  int kind;
+  int num;
+  char *text;
+  struct boot_event *next;
+};
+
+/** Runs parse(job) for every job, and replay(job, event) on the main
+ * thread for each event it recorded, job by job in order. */
+typedef void (*boot_job_fn)(int job);
+typedef void (*boot_replay_fn)(int job, struct boot_event *ev);
+
+/* Exported function prototypes */
+void bootpool_run(int njobs, boot_job_fn parse, boot_replay_fn replay);
+int bootpool_job(void);
+int bootpool_defer(int kind, int num);
+int bootpool_capture(const char *format, va_list args);
+void bootpool_fail(void);
+
+#endif /* BOOTPOOL_H_ */
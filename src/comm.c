@@ -83,6 +83,12 @@
 #include "ibt.h" /* for free_ibt_lists */
 #include "mud_event.h"
 #include "baseball.h"
+#include "profiler.h"
+#include "mail.h" /* for free_mail */
+#include "autosave.h"
+#include "bgsave.h"
+#include "resolver.h"
+#include "mempool.h"
 
 #ifndef INVALID_SOCKET
 #define INVALID_SOCKET (-1)
@@ -93,9 +99,7 @@ extern time_t newsmod;
 
 /* locally defined globals, used externally */
 struct descriptor_data *descriptor_list = NULL;   /* master desc list */
-int buf_largecount = 0;   /* # of large buffers which exist */
 int buf_overflows = 0;    /* # of overflows of output */
-int buf_switches = 0;     /* # of switches from small to large buf */
 int circle_shutdown = 0;  /* clean shutdown */
 int circle_reboot = 0;    /* reboot the game after a shutdown */
 int no_specials = 0;      /* Suppress ass. of special routines */
@@ -108,9 +112,22 @@ int next_tick = SECS_PER_MUD_HOUR;  /* Tick countdown */
 /* used with do_tell and handle_webster_file utility */
 long last_webster_teller = -1L;
 
+#ifdef HAVE_ZLIB
+/* MCCP state hung off descriptor_data->comp; see start_compression(). */
+struct compr_data {
+  z_stream stream;  /* the deflate stream itself */
+  Bytef *buf;       /* compressed bytes not yet accepted by the kernel */
+  size_t size;      /* allocated size of buf */
+  size_t len;       /* bytes waiting in buf */
+  bool finished;    /* stream ended; fall back to plain text once buf drains */
+};
+#endif
+
 /* static local global variable declarations (current file scope only) */
-static struct txt_block *bufpool = 0;  /* pool of large output buffers */
 static int max_players = 0;   /* max descriptors available */
+#ifdef HAVE_SYS_EPOLL_H
+static int epoll_desc = -1;   /* epoll set holding every open socket */
+#endif
 static int tics_passed = 0;     /* for extern checkpointing */
 static struct timeval null_time; /* zero-valued time structure */
 static byte reread_wizlist;   /* signal: SIGUSR1 */
@@ -151,11 +168,21 @@ static void record_usage(void);
 static char *make_prompt(struct descriptor_data *point);
 static void check_idle_passwords(void);
 static void init_descriptor (struct descriptor_data *newd, int desc);
+static void io_init(socket_t local_mother_desc);
+static int io_add(struct descriptor_data *d);
+static void io_remove(struct descriptor_data *d);
+static int io_poll(socket_t local_mother_desc, struct timeval *timeout);
 
 static struct in_addr *get_bind_addr(void);
 static int parse_ip(const char *addr, struct in_addr *inaddr);
 static int set_sendbuf(socket_t s);
-static void free_bufpool(void);
+static size_t out_room(struct descriptor_data *d, size_t len);
+static void out_append(struct descriptor_data *d, const char *txt, size_t len);
+static void out_share(struct descriptor_data *to, struct descriptor_data *from, size_t len);
+static void out_link(struct descriptor_data *d, struct out_block *block, size_t off, size_t len);
+static void out_consume(struct descriptor_data *d, size_t len);
+static void out_discard(struct descriptor_data *d);
+static int write_to_client_iov(struct descriptor_data *d, struct iovec *iov, int count);
 static void setup_log(const char *filename, int fd);
 static int open_logfile(const char *filename, FILE *stderr_fp);
 #if defined(POSIX)
@@ -166,6 +193,8 @@ static RETSIGTYPE websterlink(int sig);
 static void handle_webster_file(void);
 
 static void msdp_update(void); /* KaVir plugin*/
+static void host_resolved(struct in_addr addr, const char *name);
+static void recheck_ban(struct descriptor_data *d);
 
 /* externally defined functions, used locally */
 #ifdef __CXREF__
@@ -298,10 +327,14 @@ int main(int argc, char **argv)
       no_specials = 1;
       puts("Suppressing assignment of special routines.");
       break;
+    case 'w':
+      no_world_image = 1;
+      puts("Parsing the room files -- compiled world image ignored.");
+      break;
     case 'h':
       /* From: Anil Mahajan. Do NOT use -C, this is the copyover mode and
        * without the proper copyover.dat file, the game will go nuts! */
-      printf("Usage: %s [-c] [-m] [-q] [-r] [-s] [-d pathname] [port #]\n"
+      printf("Usage: %s [-c] [-m] [-q] [-r] [-s] [-w] [-d pathname] [port #]\n"
               "  -c             Enable syntax check mode.\n"
               "  -d <directory> Specify library directory (defaults to 'lib').\n"
               "  -h             Print this command line argument help.\n"
@@ -311,6 +344,7 @@ int main(int argc, char **argv)
               "  -q             Quick boot (doesn't scan rent for object limits)\n"
               "  -r             Restrict MUD -- no new players allowed.\n"
               "  -s             Suppress special procedure assignments.\n"
+              "  -w             Parse the room files even if an image is current.\n"
               " Note:		These arguments are 'CaSe SeNsItIvE!!!'\n",
 		 argv[0]
       );
@@ -324,7 +358,7 @@ int main(int argc, char **argv)
 
   if (pos < argc) {
     if (!isdigit(*argv[pos])) {
-      printf("Usage: %s [-c] [-m] [-q] [-r] [-s] [-d pathname] [port #]\n", argv[0]);
+      printf("Usage: %s [-c] [-m] [-q] [-r] [-s] [-w] [-d pathname] [port #]\n", argv[0]);
       exit(1);
     } else if ((port = atoi(argv[pos])) <= 1024) {
       printf("SYSERR: Illegal port number %d.\n", port);
@@ -358,7 +392,6 @@ int main(int argc, char **argv)
 
   if (!scheck) {
     log("Clearing other memory.");
-    free_bufpool();         /* comm.c */
     free_player_index();    /* players.c */
     free_messages();        /* fight.c */
     free_text_files();      /* db.c */
@@ -371,6 +404,8 @@ int main(int argc, char **argv)
     free_save_list();       /* genolc.c */
     free_strings(&config_info, OASIS_CFG); /* oasis_delete.c */
     free_ibt_lists();       /* ibt.c */
+    free_mail();            /* mail.c */
+    free_autosave();        /* autosave.c */
     free_recent_players();  /* act.informative.c */
     free_list(world_events); /* free up our global lists */
     free_list(global_lists);
@@ -456,7 +491,7 @@ void copyover_recover()
     CopyoverSet(d,guiopt);
 
     /* Now, find the pfile */
-    CREATE(d->character, struct char_data, 1);
+    d->character = pool_alloc(char_pool);
     clear_char(d->character);
     CREATE(d->character->player_specials, struct player_special_data, 1);
     
@@ -519,8 +554,14 @@ static void init_game(ush_int local_port)
      mother_desc = init_socket (local_port);
   }
 
+  io_init(mother_desc);
+
   event_init();
 
+  /* start the writer thread before anything can be saved */
+  bgsave_init();
+  resolver_init(host_resolved);
+
   /* set up hash table for find_char() */
   init_lookup_table();
 
@@ -541,6 +582,7 @@ static void init_game(ush_int local_port)
 
   game_loop(mother_desc);
 
+  autosave_flush();
   Crash_save_all();
 
   log("Closing all sockets.");
@@ -555,6 +597,10 @@ static void init_game(ush_int local_port)
   log("Saving current MUD time.");
   save_mud_time(&time_info);
 
+  /* Everything queued for the writer thread must be on disk before exit. */
+  bgsave_shutdown();
+  resolver_shutdown();
+
   if (circle_reboot) {
     log("Rebooting.");
     exit(52);			/* what's so great about HHGTTG, anyhow? */
@@ -724,6 +770,12 @@ static int get_max_players(void)
   max_descs = CONFIG_MAX_PLAYING + NUM_RESERVED_DESCS;
 #endif
 
+#ifndef HAVE_SYS_EPOLL_H
+  /* select() cannot watch a descriptor numbered FD_SETSIZE or higher, so
+   * that is a hard ceiling no matter what the kernel would give us. */
+  max_descs = MIN(FD_SETSIZE, max_descs);
+#endif
+
   /* now calculate max _players_ based on max descs */
   max_descs = MIN(CONFIG_MAX_PLAYING, max_descs - NUM_RESERVED_DESCS);
 
@@ -737,6 +789,170 @@ static int get_max_players(void)
 #endif /* CIRCLE_UNIX */
 }
 
+/* The I/O backend.  game_loop() asks io_poll() which sockets are ready and
+ * io_poll() records the answer in each descriptor's io_flags.  Where the
+ * system has epoll, every socket is registered once when it is opened and
+ * only the sockets that changed state are handed back, so a pass costs the
+ * same whether 10 or 10,000 players are connected.  Everywhere else we fall
+ * back to rebuilding fd_sets for select() on every pass.
+ *
+ * The epoll set is edge-triggered for player sockets: a readiness flag stays
+ * set until the code using it finds the socket would block (process_input()
+ * reads nothing more or process_output() fills the kernel buffer), and only
+ * then is it cleared.  The mother socket stays level-triggered so pending
+ * connections are still accepted one per pass. */
+#ifdef HAVE_SYS_EPOLL_H
+
+#define IO_MAX_EVENTS 256
+
+const char *io_backend_name(void)
+{
+  return ("epoll");
+}
+
+static void io_init(socket_t local_mother_desc)
+{
+  struct epoll_event ev;
+
+  if ((epoll_desc = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+    perror("SYSERR: epoll_create1");
+    exit(1);
+  }
+
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.ptr = NULL;	/* NULL marks the mother descriptor */
+  if (epoll_ctl(epoll_desc, EPOLL_CTL_ADD, local_mother_desc, &ev) < 0) {
+    perror("SYSERR: epoll_ctl (mother)");
+    exit(1);
+  }
+  log("Using %s for socket polling.", io_backend_name());
+}
+
+static int io_add(struct descriptor_data *d)
+{
+  struct epoll_event ev;
+
+  d->io_flags = 0;
+
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
+  ev.data.ptr = d;
+  if (epoll_ctl(epoll_desc, EPOLL_CTL_ADD, d->descriptor, &ev) < 0) {
+    perror("SYSERR: epoll_ctl (add)");
+    return (-1);
+  }
+  return (0);
+}
+
+static void io_remove(struct descriptor_data *d)
+{
+  struct epoll_event ev;	/* Kernels before 2.6.9 insist on a non-NULL event. */
+
+  if (epoll_ctl(epoll_desc, EPOLL_CTL_DEL, d->descriptor, &ev) < 0 && errno != ENOENT)
+    perror("SYSERR: epoll_ctl (del)");
+}
+
+/* Returns -1 on error, otherwise 1 if there is a connection waiting on the
+ * mother descriptor and 0 if not.  A NULL timeout blocks until something
+ * happens. */
+static int io_poll(socket_t local_mother_desc, struct timeval *timeout)
+{
+  struct epoll_event events[IO_MAX_EVENTS];
+  struct descriptor_data *d;
+  int i, nfds, msecs, mother_ready = 0;
+
+  msecs = timeout ? timeout->tv_sec * 1000 + timeout->tv_usec / 1000 : -1;
+
+  /* A full array may mean more events are queued; drain them without
+   * waiting before returning. */
+  do {
+    if ((nfds = epoll_wait(epoll_desc, events, IO_MAX_EVENTS, msecs)) < 0)
+      return (-1);
+
+    for (i = 0; i < nfds; i++) {
+      if ((d = (struct descriptor_data *) events[i].data.ptr) == NULL) {
+        mother_ready = 1;
+        continue;
+      }
+      /* A hangup is reported as readable so process_input() sees the EOF. */
+      if (events[i].events & (EPOLLIN | EPOLLHUP))
+        SET_BIT(d->io_flags, IO_READABLE);
+      if (events[i].events & EPOLLOUT)
+        SET_BIT(d->io_flags, IO_WRITABLE);
+      if (events[i].events & (EPOLLERR | EPOLLPRI))
+        SET_BIT(d->io_flags, IO_ERROR);
+    }
+    msecs = 0;
+  } while (nfds == IO_MAX_EVENTS);
+
+  return (mother_ready);
+}
+
+#else /* !HAVE_SYS_EPOLL_H */
+
+const char *io_backend_name(void)
+{
+  return ("select");
+}
+
+static void io_init(socket_t local_mother_desc)
+{
+  log("Using %s for socket polling.", io_backend_name());
+}
+
+static int io_add(struct descriptor_data *d)
+{
+  d->io_flags = 0;
+  return (0);
+}
+
+static void io_remove(struct descriptor_data *d)
+{
+}
+
+static int io_poll(socket_t local_mother_desc, struct timeval *timeout)
+{
+  fd_set input_set, output_set, exc_set;
+  struct descriptor_data *d;
+  int maxdesc;
+
+  /* Set up the input, output, and exception sets for select(). */
+  FD_ZERO(&input_set);
+  FD_ZERO(&output_set);
+  FD_ZERO(&exc_set);
+  FD_SET(local_mother_desc, &input_set);
+
+  maxdesc = local_mother_desc;
+  for (d = descriptor_list; d; d = d->next) {
+#ifndef CIRCLE_WINDOWS
+    if (d->descriptor > maxdesc)
+      maxdesc = d->descriptor;
+#endif
+    FD_SET(d->descriptor, &input_set);
+    FD_SET(d->descriptor, &output_set);
+    FD_SET(d->descriptor, &exc_set);
+  }
+
+  if (select(maxdesc + 1, &input_set, &output_set, &exc_set, timeout) < 0)
+    return (-1);
+
+  /* select() is level-triggered, so the flags are rebuilt from scratch. */
+  for (d = descriptor_list; d; d = d->next) {
+    d->io_flags = 0;
+    if (FD_ISSET(d->descriptor, &input_set))
+      SET_BIT(d->io_flags, IO_READABLE);
+    if (FD_ISSET(d->descriptor, &output_set))
+      SET_BIT(d->io_flags, IO_WRITABLE);
+    if (FD_ISSET(d->descriptor, &exc_set))
+      SET_BIT(d->io_flags, IO_ERROR);
+  }
+
+  return (FD_ISSET(local_mother_desc, &input_set) ? 1 : 0);
+}
+
+#endif /* HAVE_SYS_EPOLL_H */
+
 /* game_loop contains the main loop which drives the entire MUD.  It
  * cycles once every 0.10 seconds and is responsible for accepting new
  * new connections, polling existing connections for input, dequeueing
@@ -744,19 +960,18 @@ static int get_max_players(void)
  * such as mobile_activity(). */
 void game_loop(socket_t local_mother_desc)
 {
-  fd_set input_set, output_set, exc_set, null_set;
   struct timeval last_time, opt_time, process_time, temp_time;
   struct timeval before_sleep, now, timeout;
   char comm[MAX_INPUT_LENGTH];
   struct descriptor_data *d, *next_d;
-  int missed_pulses, maxdesc, aliased;
+  int missed_pulses, aliased, mother_ready, result;
+  unsigned long pass_start, t;
 
   /* initialize various time values */
   null_time.tv_sec = 0;
   null_time.tv_usec = 0;
   opt_time.tv_usec = OPT_USEC;
   opt_time.tv_sec = 0;
-  FD_ZERO(&null_set);
 
   gettimeofday(&last_time, (struct timezone *) 0);
 
@@ -766,9 +981,7 @@ void game_loop(socket_t local_mother_desc)
     /* Sleep if we don't have any connections */
     if (descriptor_list == NULL) {
       log("No connections.  Going to sleep.");
-      FD_ZERO(&input_set);
-      FD_SET(local_mother_desc, &input_set);
-      if (select(local_mother_desc + 1, &input_set, (fd_set *) 0, (fd_set *) 0, NULL) < 0) {
+      if (io_poll(local_mother_desc, NULL) < 0) {
 	if (errno == EINTR)
 	  log("Waking up to process signal.");
 	else
@@ -777,22 +990,6 @@ void game_loop(socket_t local_mother_desc)
 	log("New connection.  Waking up.");
       gettimeofday(&last_time, (struct timezone *) 0);
     }
-    /* Set up the input, output, and exception sets for select(). */
-    FD_ZERO(&input_set);
-    FD_ZERO(&output_set);
-    FD_ZERO(&exc_set);
-    FD_SET(local_mother_desc, &input_set);
-
-    maxdesc = local_mother_desc;
-    for (d = descriptor_list; d; d = d->next) {
-#ifndef CIRCLE_WINDOWS
-      if (d->descriptor > maxdesc)
-	maxdesc = d->descriptor;
-#endif
-      FD_SET(d->descriptor, &input_set);
-      FD_SET(d->descriptor, &output_set);
-      FD_SET(d->descriptor, &exc_set);
-    }
 
     /* At this point, we have completed all input, output and heartbeat
      * activity from the previous iteration, so we have to put ourselves
@@ -828,37 +1025,44 @@ void game_loop(socket_t local_mother_desc)
       timediff(&timeout, &last_time, &now);
     } while (timeout.tv_usec || timeout.tv_sec);
 
+    pass_start = t = prof_now();
+
     /* Poll (without blocking) for new input, output, and exceptions */
-    if (select(maxdesc + 1, &input_set, &output_set, &exc_set, &null_time) < 0) {
+    if ((mother_ready = io_poll(local_mother_desc, &null_time)) < 0) {
       perror("SYSERR: Select poll");
       return;
     }
     /* If there are new connections waiting, accept them. */
-    if (FD_ISSET(local_mother_desc, &input_set))
+    if (mother_ready)
       new_descriptor(local_mother_desc);
 
+    /* Name the connections whose site lookups have come back. */
+    resolver_poll();
+
     /* Kick out the freaky folks in the exception set and marked for close */
     for (d = descriptor_list; d; d = next_d) {
       next_d = d->next;
-      if (FD_ISSET(d->descriptor, &exc_set)) {
-        FD_CLR(d->descriptor, &input_set);
-	      FD_CLR(d->descriptor, &output_set);
-	      close_socket(d);
-      }
+      if (IS_SET(d->io_flags, IO_ERROR))
+	close_socket(d);
     }
 
-    /* Process descriptors with input pending */
+    /* Process descriptors with input pending.  Once a read would block, the
+     * socket is not readable again until the backend says so. */
     for (d = descriptor_list; d; d = next_d) {
       next_d = d->next;
-      if (FD_ISSET(d->descriptor, &input_set))
+      if (IS_SET(d->io_flags, IO_READABLE))
        {
         if ( d->pProtocol != NULL )      /* KaVir's plugin */
           d->pProtocol->WriteOOB = 0;    /* KaVir's plugin */
-	      if (process_input(d) < 0)
+	      if ((result = process_input(d)) < 0)
 	        close_socket(d);
+	      else if (result == 0)
+	        REMOVE_BIT(d->io_flags, IO_READABLE);
        }
     }
 
+    t = prof_lap(PROF_INPUT, t);
+
     /* Process commands we just read from process_input */
     for (d = descriptor_list; d; d = next_d) {
       next_d = d->next;
@@ -906,22 +1110,31 @@ void game_loop(socket_t local_mother_desc)
       }
     }
 
+    t = prof_lap(PROF_COMMANDS, t);
+
     /* Send queued output out to the operating system (ultimately to user). */
     for (d = descriptor_list; d; d = next_d) {
       next_d = d->next;
-      if (*(d->output) && FD_ISSET(d->descriptor, &output_set)) {
+      if (d->out_bytes && IS_SET(d->io_flags, IO_WRITABLE)) {
 	/* Output for this player is ready */
 	if (process_output(d) < 0)
 	  close_socket(d);
 	else
 	  d->has_prompt = 1;
       }
+#ifdef HAVE_ZLIB
+      /* Nothing new to say, but compressed output is still backed up. */
+      else if (d->comp && d->comp->len && IS_SET(d->io_flags, IO_WRITABLE)) {
+	if (write_to_client(d, "") < 0)
+	  close_socket(d);
+      }
+#endif
     }
 
     /* Print prompts for other descriptors who had no other output */
     for (d = descriptor_list; d; d = d->next) {
       if (!d->has_prompt) {
-	      write_to_descriptor(d->descriptor, make_prompt(d));
+	      write_to_client(d, make_prompt(d));
 	      d->has_prompt = TRUE;
       }
     }
@@ -933,6 +1146,8 @@ void game_loop(socket_t local_mother_desc)
 	close_socket(d);
     }
 
+    t = prof_lap(PROF_OUTPUT, t);
+
     /* Now, we execute as many pulses as necessary--just one if we haven't
      * missed any pulses, or make up for lost time if we missed a few
      * pulses by sleeping for too long. */
@@ -953,6 +1168,9 @@ void game_loop(socket_t local_mother_desc)
     while (missed_pulses--)
       heartbeat(++pulse);
 
+    t = prof_lap(PROF_HEARTBEAT, t);
+    prof_lap(PROF_PULSE, pass_start);
+
     /* Check for any signals we may have received. */
     if (reread_wizlist) {
       reread_wizlist = FALSE;
@@ -983,56 +1201,89 @@ void game_loop(socket_t local_mother_desc)
 void heartbeat(int heart_pulse)
 {
   static int mins_since_crashsave = 0;
+  unsigned long t;
 
+  /* Each phase that runs is charged to its own histogram; see 'profile'. */
+  t = prof_now();
   event_process();
+  t = prof_lap(PROF_EVENTS, t);
 
-  if (!(heart_pulse % PULSE_DG_SCRIPT))
+  if (!(heart_pulse % PULSE_DG_SCRIPT)) {
     script_trigger_check();
+    t = prof_lap(PROF_SCRIPTS, t);
+  }
 
   if (!(heart_pulse % PASSES_PER_SEC)) {    /* EVERY second */
     msdp_update();
     next_tick--;
+    t = prof_lap(PROF_MSDP, t);
   }
 
-  if (!(heart_pulse % PULSE_ZONE))
+  if (!(heart_pulse % PULSE_ZONE)) {
     zone_update();
+    t = prof_lap(PROF_ZONES, t);
+  }
 
-  if (!(heart_pulse % PULSE_IDLEPWD))		/* 15 seconds */
+  if (!(heart_pulse % PULSE_IDLEPWD)) {		/* 15 seconds */
     check_idle_passwords();
+    t = prof_lap(PROF_IDLEPWD, t);
+  }
 
-  if (!(heart_pulse % PULSE_MOBILE))
+  if (!(heart_pulse % PULSE_MOBILE)) {
     mobile_activity();
+    t = prof_lap(PROF_MOBILES, t);
+  }
 
-  if (!(heart_pulse % PULSE_VIOLENCE))
+  if (!(heart_pulse % PULSE_VIOLENCE)) {
     perform_violence();
+    t = prof_lap(PROF_VIOLENCE, t);
+  }
 
   if (!(heart_pulse % (SECS_PER_MUD_HOUR * PASSES_PER_SEC))) {  /* Tick ! */
     next_tick = SECS_PER_MUD_HOUR;  /* Reset tick coundown */
     weather_and_time(1);
     check_time_triggers();
+    t = prof_lap(PROF_TICK, t);
     affect_update();
+    t = prof_lap(PROF_AFFECTS, t);
     point_update();
+    t = prof_lap(PROF_POINTS, t);
     check_timed_quests();
+    t = prof_lap(PROF_QUESTS, t);
   }
 
   if (CONFIG_AUTO_SAVE && !(heart_pulse % PULSE_AUTOSAVE)) {	/* 1 minute */
     if (++mins_since_crashsave >= CONFIG_AUTOSAVE_TIME) {
       mins_since_crashsave = 0;
-      Crash_save_all();
-      House_save_all();
+      autosave_start();
     }
   }
 
-  if (!(heart_pulse % PULSE_USAGE))
+  /* The sweep queued above is worked off a little every pulse. */
+  if (autosave_step())
+    t = prof_lap(PROF_AUTOSAVE, t);
+
+  /* Report any player file the writer thread failed to write. */
+  bgsave_poll();
+
+  if (!(heart_pulse % PULSE_USAGE)) {
     record_usage();
+    t = prof_lap(PROF_USAGE, t);
+  }
 
-  if (!(heart_pulse % PULSE_TIMESAVE))
-  save_mud_time(&time_info);
+  if (!(heart_pulse % PULSE_TIMESAVE)) {
+    save_mud_time(&time_info);
+    t = prof_lap(PROF_TIMESAVE, t);
+  }
 
-  if(!(heart_pulse % BASEBALLGAME_PER_SEC)) move_ball();
+  if(!(heart_pulse % BASEBALLGAME_PER_SEC)) {
+    move_ball();
+    t = prof_lap(PROF_BALL, t);
+  }
 
   /* Every pulse! Don't want them to stink the place up... */
   extract_pending_chars();
+  prof_lap(PROF_EXTRACT, t);
 }
 
 /* new code to calculate time differences, which works on systems for which
@@ -1263,13 +1514,9 @@ static int get_from_q(struct txt_q *queue, char *dest, int *aliased)
   return (1);
 }
 
-/* Empty the queues before closing connection */
+/* Empty the input queue, before closing the connection or for '--'. */
 static void flush_queues(struct descriptor_data *d)
 {
-  if (d->large_outbuf) {
-    d->large_outbuf->next = bufpool;
-    bufpool = d->large_outbuf;
-  }
   while (d->input.head) {
     struct txt_block *tmp = d->input.head;
     d->input.head = d->input.head->next;
@@ -1300,7 +1547,7 @@ size_t vwrite_to_output(struct descriptor_data *t, const char *format, va_list a
   int size;
 
   /* if we're in the overflow state already, ignore this new output */
-  if (t->bufspace == 0)
+  if (t->out_overflow)
     return (0);
 
   wantsize = size = vsnprintf(txt, sizeof(txt), format, args);
@@ -1316,60 +1563,157 @@ size_t vwrite_to_output(struct descriptor_data *t, const char *format, va_list a
     strcpy(txt + size - strlen(text_overflow), text_overflow);	/* strcpy: OK */
   }
 
-  /* If the text is too big to fit into even a large buffer, truncate
-   * the new text to make it fit.  (This will switch to the overflow
-   * state automatically because t->bufspace will end up 0.) */
-  if (size + t->bufptr + 1 > LARGE_BUFSIZE) {
-    size = LARGE_BUFSIZE - t->bufptr - 1;
-    txt[size] = '\0';
+  /* Queue as much as fits.  Past MAX_OUTPUT_QUEUE the rest is dropped, and
+   * so is anything else until the queue has drained. */
+  out_append(t, txt, out_room(t, size));
+
+  return (t->out_overflow ? 0 : MAX_OUTPUT_QUEUE - t->out_bytes);
+}
+
+/* Output queues.  Text is copied once, into the last block of the queue if
+ * that block has room and no other queue shares it, or else into a new one.
+ * process_output() hands the segments to writev() where they lie, and a
+ * snooper is given references to the blocks its victim was sent rather than
+ * a copy.  Once the queue has drained its last block is kept for the next
+ * output, so a player who gets a line or two a pulse needs no allocation. */
+
+/* How many of 'len' more bytes d's queue will take.  If that is fewer than
+ * 'len', the queue goes into the overflow state. */
+static size_t out_room(struct descriptor_data *d, size_t len)
+{
+  if (d->out_overflow)
+    return (0);
+
+  if (d->out_bytes + len > MAX_OUTPUT_QUEUE) {
+    len = MAX_OUTPUT_QUEUE - d->out_bytes;
+    d->out_overflow = TRUE;
     buf_overflows++;
   }
+  return (len);
+}
+
+/* Queue 'len' bytes of block's text, from 'off', on the end of d's queue. */
+static void out_queue_block(struct descriptor_data *d, struct out_block *block, size_t off, size_t len)
+{
+  struct out_seg *seg = pool_alloc(out_seg_pool);
+
+  seg->block = block;
+  seg->off = off;
+  seg->len = len;
+  block->refs++;
+
+  if (d->out_tail)
+    d->out_tail->next = seg;
+  else
+    d->out_head = seg;
+  d->out_tail = seg;
+  d->out_bytes += len;
+}
 
-  /* If we have enough space, just write to buffer and that's it! If the
-   * text just barely fits, then it's switched to a large buffer instead. */
-  if (t->bufspace > size) {
-    strcpy(t->output + t->bufptr, txt);	/* strcpy: OK (size checked above) */
-    t->bufspace -= size;
-    t->bufptr += size;
-    return (t->bufspace);
+static void out_release(struct out_seg *seg)
+{
+  if (--seg->block->refs == 0)
+    pool_free(out_block_pool, seg->block);
+  pool_free(out_seg_pool, seg);
+}
+
+/* Copy 'len' bytes of txt onto the end of d's queue. */
+static void out_append(struct descriptor_data *d, const char *txt, size_t len)
+{
+  struct out_seg *tail;
+  struct out_block *block;
+  size_t n;
+
+  while (len > 0) {
+    tail = d->out_tail;
+
+    if (tail && tail->block->refs == 1 && tail->block->len < OUT_BLOCK_SIZE &&
+        tail->off + tail->len == tail->block->len) {
+      block = tail->block;
+      n = MIN(len, OUT_BLOCK_SIZE - block->len);
+      memcpy(block->text + block->len, txt, n);
+      block->len += n;
+      tail->len += n;
+      d->out_bytes += n;
+    } else {
+      block = pool_alloc(out_block_pool);
+      n = MIN(len, OUT_BLOCK_SIZE);
+      memcpy(block->text, txt, n);
+      block->len = n;
+      out_queue_block(d, block, 0, n);
+    }
+
+    txt += n;
+    len -= n;
   }
+}
 
-  buf_switches++;
+/* Queue the first 'len' bytes of from's queue on to's as well. */
+static void out_share(struct descriptor_data *to, struct descriptor_data *from, size_t len)
+{
+  struct out_seg *seg;
+  size_t n;
 
-  /* if the pool has a buffer in it, grab it */
-  if (bufpool != NULL) {
-    t->large_outbuf = bufpool;
-    bufpool = bufpool->next;
-  } else {			/* else create a new one */
-    CREATE(t->large_outbuf, struct txt_block, 1);
-    CREATE(t->large_outbuf->text, char, LARGE_BUFSIZE);
-    buf_largecount++;
+  for (seg = from->out_head; seg && len > 0; seg = seg->next) {
+    if ((n = MIN(len, seg->len)) > 0)
+      out_queue_block(to, seg->block, seg->off, n);
+    len -= n;
   }
+}
+
+/* Queue 'len' bytes of a block someone else filled, running on from the
+ * tail segment when they follow straight after it. */
+static void out_link(struct descriptor_data *d, struct out_block *block, size_t off, size_t len)
+{
+  struct out_seg *tail = d->out_tail;
+
+  if (len == 0)
+    return;
 
-  strcpy(t->large_outbuf->text, t->output);	/* strcpy: OK (size checked previously) */
-  t->output = t->large_outbuf->text;	/* make big buffer primary */
-  strcat(t->output, txt);	/* strcat: OK (size checked) */
+  if (tail && tail->block == block && tail->off + tail->len == off) {
+    tail->len += len;
+    d->out_bytes += len;
+  } else
+    out_queue_block(d, block, off, len);
+}
 
-  /* set the pointer for the next write */
-  t->bufptr = strlen(t->output);
+/* Drop the first 'len' bytes of d's queue, which have been sent. */
+static void out_consume(struct descriptor_data *d, size_t len)
+{
+  struct out_seg *seg;
 
-  /* calculate how much space is left in the buffer */
-  t->bufspace = LARGE_BUFSIZE - 1 - t->bufptr;
+  while ((seg = d->out_head) != NULL && len >= seg->len) {
+    len -= seg->len;
+    d->out_bytes -= seg->len;
+
+    if (!seg->next && seg->block->refs == 1) {
+      seg->block->len = seg->off = seg->len = 0;
+      return;
+    }
+    d->out_head = seg->next;
+    out_release(seg);
+  }
 
-  return (t->bufspace);
+  if (!seg)
+    d->out_tail = NULL;
+  else {
+    seg->off += len;
+    seg->len -= len;
+    d->out_bytes -= len;
+  }
 }
 
-static void free_bufpool(void)
+/* Throw away everything queued for d, when closing the connection. */
+static void out_discard(struct descriptor_data *d)
 {
-  struct txt_block *tmp;
+  struct out_seg *seg;
 
-  while (bufpool) {
-    tmp = bufpool->next;
-    if (bufpool->text)
-      free(bufpool->text);
-    free(bufpool);
-    bufpool = tmp;
+  while ((seg = d->out_head) != NULL) {
+    d->out_head = seg->next;
+    out_release(seg);
   }
+  d->out_tail = NULL;
+  d->out_bytes = 0;
 }
 
 /*  socket handling */
@@ -1461,11 +1805,7 @@ static void init_descriptor (struct descriptor_data *newd, int desc)
 
   newd->descriptor = desc;
   newd->idle_tics = 0;
-  newd->output = newd->small_outbuf;
-  newd->bufspace = SMALL_BUFSIZE - 1;
   newd->login_time = time(0);
-  *newd->output = '\0';
-  newd->bufptr = 0;
   newd->has_prompt = 1;  /* prompt is part of greetings */
   STATE(newd) = CONFIG_PROTOCOL_NEGOTIATION ? CON_GET_PROTOCOL : CON_GET_NAME;
   CREATE(newd->history, char *, HISTORY_SIZE);
@@ -1474,7 +1814,10 @@ static void init_descriptor (struct descriptor_data *newd, int desc)
   newd->desc_num = last_desc;
   newd->pProtocol = ProtocolCreate(); /* KaVir's plugin*/
   newd->events = create_list();
-  
+
+  /* If the backend will not watch it, drop it at the end of this pass. */
+  if (io_add(newd) < 0)
+    STATE(newd) = CON_CLOSE;
 }
 
 static int new_descriptor(socket_t s)
@@ -1485,7 +1828,6 @@ static int new_descriptor(socket_t s)
   socklen_t i;
   struct descriptor_data *newd;
   struct sockaddr_in peer;
-  struct hostent *from;
   
   /* accept the new connection */
   i = sizeof(peer);
@@ -1506,7 +1848,11 @@ static int new_descriptor(socket_t s)
   for (newd = descriptor_list; newd; newd = newd->next)
     sockets_connected++;
 
-  if (sockets_connected >= CONFIG_MAX_PLAYING) {
+  if (sockets_connected >= CONFIG_MAX_PLAYING || sockets_connected >= max_players
+#ifndef HAVE_SYS_EPOLL_H
+      || desc >= FD_SETSIZE
+#endif
+      ) {
     write_to_descriptor(desc, "Sorry, the game is full right now... please try again later!\r\n");
     CLOSE_SOCKET(desc);
     return (0);
@@ -1514,25 +1860,17 @@ static int new_descriptor(socket_t s)
   /* create a new descriptor */
   CREATE(newd, struct descriptor_data, 1);
 
-  /* find the sitename */
-  if (CONFIG_NS_IS_SLOW ||
-      !(from = gethostbyaddr((char *) &peer.sin_addr,
-		             sizeof(peer.sin_addr), AF_INET))) {
+  /* find the sitename: the numeric address, until the resolver has a name */
+  strncpy(newd->host, (char *)inet_ntoa(peer.sin_addr), HOST_LENGTH);	/* strncpy: OK (n->host:HOST_LENGTH+1) */
+  *(newd->host + HOST_LENGTH) = '\0';
+  newd->addr = peer.sin_addr;
 
-    /* resolution failed */
-    if (!CONFIG_NS_IS_SLOW)
-      perror("SYSERR: gethostbyaddr");
-
-    /* find the numeric site address */
-    strncpy(newd->host, (char *)inet_ntoa(peer.sin_addr), HOST_LENGTH);	/* strncpy: OK (n->host:HOST_LENGTH+1) */
-    *(newd->host + HOST_LENGTH) = '\0';
-  } else {
-    strncpy(newd->host, from->h_name, HOST_LENGTH);	/* strncpy: OK (n->host:HOST_LENGTH+1) */
-    *(newd->host + HOST_LENGTH) = '\0';
-  }
+  if (!CONFIG_NS_IS_SLOW &&
+      resolver_lookup(peer.sin_addr, newd->host, sizeof(newd->host)) == RESOLVE_PENDING)
+    newd->resolving = TRUE;
 
   /* determine if the site is banned */
-  if (isbanned(newd->host) == BAN_ALL) {
+  if (site_banned(newd) == BAN_ALL) {
     CLOSE_SOCKET(desc);
     mudlog(CMP, LVL_GOD, TRUE, "Connection attempt denied from [%s]", newd->host);
     free(newd);
@@ -1559,86 +1897,145 @@ static int new_descriptor(socket_t s)
   return (0);
 }
 
-/* Send all of the output that we've accumulated for a player out to the
- * player's descriptor. 32 byte GARBAGE_SPACE in MAX_SOCK_BUF used for:
- *	 2 bytes: prepended \r\n
- *	14 bytes: overflow message
- *	 2 bytes: extra \r\n for non-comapct
- *      14 bytes: unused */
-static int process_output(struct descriptor_data *t)
+/* The site lookup for 'addr' has come back.  Everyone connected from there
+ * still under the numeric address gets the name, and the bans on it. */
+static void host_resolved(struct in_addr addr, const char *name)
 {
-  char i[MAX_SOCK_BUF], *osb = i + 2;
-  int result;
+  struct descriptor_data *d;
+  char numeric[HOST_LENGTH + 1];
+
+  strlcpy(numeric, inet_ntoa(addr), sizeof(numeric));
 
-  /* we may need this \r\n for later -- see below */
-  strcpy(i, "\r\n");	/* strcpy: OK (for 'MAX_SOCK_BUF >= 3') */
+  for (d = descriptor_list; d; d = d->next) {
+    if (!d->resolving || strcmp(d->host, numeric))
+      continue;
+
+    d->resolving = FALSE;
+    if (name) {
+      strlcpy(d->host, name, sizeof(d->host));
+      recheck_ban(d);
+    }
+  }
+}
 
-  /* now, append the 'real' output */
-  strcpy(osb, t->output);	/* strcpy: OK (t->output:LARGE_BUFSIZE < osb:MAX_SOCK_BUF-2) */
+/* Hold d to the bans on the name it has just been given, as if it had had
+ * the name all along: new_descriptor() refuses BAN_ALL sites, and nanny()
+ * refuses new characters from BAN_NEW sites and logins from BAN_SELECT
+ * ones. */
+static void recheck_ban(struct descriptor_data *d)
+{
+  int ban = site_banned(d), state = STATE(d);
+  int creating = (state >= CON_NEWPASSWD && state <= CON_QCLASS);
+  int logging_in = (state == CON_GET_PROTOCOL || state == CON_GET_NAME ||
+                    state == CON_NAME_CNFRM || state == CON_PASSWORD);
+
+  if (ban == BAN_ALL)
+    mudlog(CMP, LVL_GOD, TRUE, "Connection attempt denied from [%s]", d->host);
+  else if (ban >= BAN_NEW && creating)
+    mudlog(NRM, LVL_GOD, TRUE, "Request for new char %s denied from [%s] (siteban)",
+           GET_PC_NAME(d->character), d->host);
+  else if (ban == BAN_SELECT && d->character && !creating && !logging_in &&
+           !PLR_FLAGGED(d->character, PLR_SITEOK))
+    mudlog(NRM, LVL_GOD, TRUE, "Connection attempt for %s denied from %s",
+           GET_NAME(d->character), d->host);
+  else
+    return;
 
-  /* if we're in the overflow state, notify the user */
-  if (t->bufspace == 0)
-    strcat(osb, "**OVERFLOW**\r\n");	/* strcpy: OK (osb:MAX_SOCK_BUF-2 reserves space) */
+  STATE(d) = IS_PLAYING(d) ? CON_DISCONNECT : CON_CLOSE;
+}
 
-  /* add the extra CRLF if the person isn't in compact mode */
-  if (STATE(t) == CON_PLAYING && t->character && !IS_NPC(t->character) && !PRF_FLAGGED(t->character, PRF_COMPACT))
-    if ( !t->pProtocol->WriteOOB ) 
-      strcat(osb, "\r\n");	/* strcpy: OK (osb:MAX_SOCK_BUF-2 reserves space) */
+/* Pieces passed to one writev(): the queue's segments, with a CRLF before
+ * them and up to three pieces after. */
+#if defined(IOV_MAX) && IOV_MAX < 64
+#define OUT_IOV_MAX  IOV_MAX
+#else
+#define OUT_IOV_MAX  64
+#endif
 
-  if (!t->pProtocol->WriteOOB) /* add a prompt */
-    strcat(i, make_prompt(t));	/* strcpy: OK (i:MAX_SOCK_BUF reserves space) */
+static void add_iov(struct iovec *iov, int *count, const char *txt, size_t len)
+{
+  if (len > 0) {
+    iov[*count].iov_base = (void *) txt;
+    iov[*count].iov_len = len;
+    (*count)++;
+  }
+}
 
-  /* now, send the output.  If this is an 'interruption', use the prepended
-   * CRLF, otherwise send the straight output sans CRLF. */
+/* Send all of the output that we've accumulated for a player out to the
+ * player's descriptor.  The queued segments go out where they lie, in one
+ * writev() with a prepended \r\n if this output interrupts a prompt and,
+ * once the whole queue fits in the call, the overflow notice, the extra
+ * \r\n for non-compact players and the new prompt. Returns -1 on a fatal
+ * error, 0 if the socket buffer is full, otherwise the bytes written. */
+static int process_output(struct descriptor_data *t)
+{
+  static char crlf[] = "\r\n", overflow[] = "**OVERFLOW**\r\n";
+  struct iovec iov[OUT_IOV_MAX];
+  struct out_seg *seg;
+  size_t lead = 0, queued = 0, sent, extra;
+  int count = 0, suffix, i, result;
+  char *prompt;
+
+  /* If this is an 'interruption', start with a CRLF. */
   if (t->has_prompt && !t->pProtocol->WriteOOB) {
     t->has_prompt = FALSE;
-    result = write_to_descriptor(t->descriptor, i);
-    if (result >= 2)
-      result -= 2;
-  } else
-    result = write_to_descriptor(t->descriptor, osb);
+    add_iov(iov, &count, crlf, lead = 2);
+  }
 
-  if (result < 0) {	/* Oops, fatal error. Bye! */
-    close_socket(t);
-    return (-1);
-  } else if (result == 0)	/* Socket buffer full. Try later. */
-    return (0);
+  /* now, the 'real' output */
+  for (seg = t->out_head; seg && count < OUT_IOV_MAX - 3; seg = seg->next) {
+    add_iov(iov, &count, seg->block->text + seg->off, seg->len);
+    queued += seg->len;
+  }
 
-  /* Handle snooping: prepend "% " and send to snooper. */
-  if (t->snoop_by)
-    write_to_output(t->snoop_by, "%% %*s%%%%", result, t->output);
-
-  /* The common case: all saved output was handed off to the kernel buffer. */
-  if (result >= t->bufptr) {
-    /* If we were using a large buffer, put the large buffer on the buffer pool
-     * and switch back to the small one. */
-    if (t->large_outbuf) {
-      t->large_outbuf->next = bufpool;
-      bufpool = t->large_outbuf;
-      t->large_outbuf = NULL;
-      t->output = t->small_outbuf;
-    }
-    /* reset total bufspace back to that of a small buffer */
-    t->bufspace = SMALL_BUFSIZE - 1;
-    t->bufptr = 0;
-    *(t->output) = '\0';
-
-    /* If the overflow message or prompt were partially written, try to save
-     * them. There will be enough space for them if this is true.  'result'
-     * is effectively unsigned here anyway. */
-    if ((unsigned int)result < strlen(osb)) {
-      size_t savetextlen = strlen(osb + result);
-
-      strcat(t->output, osb + result);
-      t->bufptr   -= savetextlen;
-      t->bufspace += savetextlen;
+  /* The rest waits until the queue can all go at once. */
+  suffix = count;
+  if (!seg) {
+    /* if we're in the overflow state, notify the user */
+    if (t->out_overflow)
+      add_iov(iov, &count, overflow, strlen(overflow));
+
+    /* add the extra CRLF if the person isn't in compact mode */
+    if (STATE(t) == CON_PLAYING && t->character && !IS_NPC(t->character) && !PRF_FLAGGED(t->character, PRF_COMPACT))
+      if (!t->pProtocol->WriteOOB)
+        add_iov(iov, &count, crlf, 2);
+
+    if (!t->pProtocol->WriteOOB) { /* add a prompt */
+      prompt = make_prompt(t);
+      add_iov(iov, &count, prompt, strlen(prompt));
     }
+  }
 
-  } else {
-    /* Not all data in buffer sent.  result < output buffersize. */
-    strcpy(t->output, t->output + result);	/* strcpy: OK (overlap) */
-    t->bufptr   -= result;
-    t->bufspace += result;
+  /* -1 is a fatal error, and the caller cuts them off; 0 means the socket
+   * buffer is full, so try later. */
+  if ((result = write_to_client_iov(t, iov, count)) <= 0)
+    return (result);
+
+  sent = ((size_t) result > lead ? result - lead : 0);
+
+  /* Handle snooping: prepend "% " and send to snooper. */
+  if (t->snoop_by && MIN(sent, queued) > 0) {
+    write_to_output(t->snoop_by, "%% ");
+    out_share(t->snoop_by, t, out_room(t->snoop_by, MIN(sent, queued)));
+    write_to_output(t->snoop_by, "%%%%");
+  }
+
+  out_consume(t, MIN(sent, queued));
+
+  /* The common case: all saved output was handed off to the kernel buffer.
+   * If the overflow message or prompt were partially written, save the rest
+   * for next time. */
+  if (!seg && sent >= queued) {
+    t->out_overflow = FALSE;
+
+    for (extra = sent - queued, i = suffix; i < count; i++) {
+      if (extra >= iov[i].iov_len)
+        extra -= iov[i].iov_len;
+      else {
+        out_append(t, (char *) iov[i].iov_base + extra, iov[i].iov_len - extra);
+        extra = 0;
+      }
+    }
   }
 
   return (result);
@@ -1689,13 +2086,10 @@ ssize_t perform_socket_write(socket_t desc, const char *txt, size_t length)
 #define write	socketwrite
 #endif
 
-/* perform_socket_write for all Non-Windows platforms */
-static ssize_t perform_socket_write(socket_t desc, const char *txt, size_t length)
+/* What perform_socket_write and perform_socket_writev return for 'result'
+ * from write() or writev(). */
+static ssize_t socket_write_result(ssize_t result)
 {
-  ssize_t result;
-
-  result = write(desc, txt, length);
-
   if (result > 0) {
     /* Write was successful. */
     return (result);
@@ -1728,8 +2122,39 @@ static ssize_t perform_socket_write(socket_t desc, const char *txt, size_t lengt
   /* Looks like the error was fatal.  Too bad. */
   return (-1);
 }
+
+/* perform_socket_write for all Non-Windows platforms */
+static ssize_t perform_socket_write(socket_t desc, const char *txt, size_t length)
+{
+  return (socket_write_result(write(desc, txt, length)));
+}
 #endif /* CIRCLE_WINDOWS */
 
+/* perform_socket_writev: perform_socket_write for text in 'count' pieces,
+ * which go to the OS in one writev() where there is one.  Returns the same
+ * as perform_socket_write. */
+#if defined(HAVE_SYS_UIO_H) && !defined(CIRCLE_WINDOWS) && !defined(CIRCLE_ACORN)
+static ssize_t perform_socket_writev(socket_t desc, const struct iovec *iov, int count)
+{
+  return (socket_write_result(writev(desc, iov, count)));
+}
+#else
+static ssize_t perform_socket_writev(socket_t desc, const struct iovec *iov, int count)
+{
+  ssize_t result, total = 0;
+  int i;
+
+  for (i = 0; i < count; i++) {
+    if ((result = perform_socket_write(desc, iov[i].iov_base, iov[i].iov_len)) < 0)
+      return (total > 0 ? total : -1);
+    total += result;
+    if ((size_t) result < iov[i].iov_len)
+      break;
+  }
+  return (total);
+}
+#endif
+
 /* write_to_descriptor takes a descriptor, and text to write to the descriptor.
  * It keeps calling the system-level write() until all the text has been
  * delivered to the OS, or until an error is encountered. Returns:
@@ -1760,6 +2185,198 @@ int write_to_descriptor(socket_t desc, const char *txt)
   return (write_total);
 }
 
+/* MCCP v2.  Once a client agrees to compression, everything we send it goes
+ * through a deflate stream that lives as long as the connection.  Compressed
+ * bytes cannot be produced twice, so whatever the kernel will not take is
+ * held in 'buf' and must go out before we accept any more text. */
+#ifdef HAVE_ZLIB
+
+/* Run 'len' bytes of text through the stream, growing buf as needed. */
+static int compress_text(struct compr_data *c, const char *txt, size_t len, int flush)
+{
+  c->stream.next_in = (Bytef *) txt;
+  c->stream.avail_in = len;
+
+  do {
+    if (c->size - c->len < 64) {
+      c->size *= 2;
+      RECREATE(c->buf, Bytef, c->size);
+    }
+    c->stream.next_out = c->buf + c->len;
+    c->stream.avail_out = c->size - c->len;
+
+    if (deflate(&c->stream, flush) == Z_STREAM_ERROR) {
+      log("SYSERR: MCCP: deflate: %s", c->stream.msg ? c->stream.msg : "stream error");
+      return (-1);
+    }
+    c->len = c->size - c->stream.avail_out;
+  } while (c->stream.avail_in > 0 || c->stream.avail_out == 0);
+
+  return (0);
+}
+
+/* Hand as much of the compressed backlog to the kernel as it will take.
+ * Returns -1 on a fatal error, otherwise the number of bytes still waiting. */
+static ssize_t flush_compressed(struct descriptor_data *d)
+{
+  struct compr_data *c = d->comp;
+  ssize_t written;
+  size_t sent = 0;
+
+  while (sent < c->len) {
+    if ((written = perform_socket_write(d->descriptor, (const char *) c->buf + sent, c->len - sent)) < 0) {
+      perror("SYSERR: Write to socket (MCCP)");
+      return (-1);
+    } else if (written == 0)
+      break;
+    sent += written;
+  }
+
+  if (sent > 0) {
+    memmove(c->buf, c->buf + sent, c->len - sent);
+    c->len -= sent;
+  }
+  return (c->len);
+}
+
+static void free_compression(struct descriptor_data *d)
+{
+  if (!d->comp->finished)
+    deflateEnd(&d->comp->stream);
+  free(d->comp->buf);
+  free(d->comp);
+  d->comp = NULL;
+}
+
+/* Called when the client answers IAC DO COMPRESS2, and again for each
+ * compressing descriptor recovered from a copyover. */
+void start_compression(struct descriptor_data *d)
+{
+  static const char start_seq[] = { (char) IAC, (char) SB, (char) TELOPT_MCCP, (char) IAC, (char) SE };
+  struct compr_data *c;
+
+  if (d->comp)
+    return;
+
+  CREATE(c, struct compr_data, 1);
+  if (deflateInit(&c->stream, Z_DEFAULT_COMPRESSION) != Z_OK) {
+    log("SYSERR: MCCP: deflateInit: %s", c->stream.msg ? c->stream.msg : "unknown error");
+    free(c);
+    return;
+  }
+
+  /* The start sequence itself goes out uncompressed, ahead of anything else. */
+  c->size = MAX_SOCK_BUF;
+  CREATE(c->buf, Bytef, c->size);
+  memcpy(c->buf, start_seq, sizeof(start_seq));
+  c->len = sizeof(start_seq);
+  d->comp = c;
+
+  /* Errors surface on the next write, where the socket can be closed. */
+  flush_compressed(d);
+}
+
+/* Close the stream so the client sees a clean end of compressed data.  The
+ * tail stays queued until it drains; only then does plain text resume. */
+void end_compression(struct descriptor_data *d)
+{
+  struct compr_data *c = d->comp;
+
+  if (!c || c->finished)
+    return;
+
+  compress_text(c, "", 0, Z_FINISH);
+  deflateEnd(&c->stream);
+  c->finished = TRUE;
+
+  if (flush_compressed(d) == 0)
+    free_compression(d);
+}
+
+#else /* !HAVE_ZLIB */
+
+void start_compression(struct descriptor_data *d)
+{
+}
+
+void end_compression(struct descriptor_data *d)
+{
+}
+
+#endif /* HAVE_ZLIB */
+
+/* write_to_client is write_to_descriptor for a connected player: the text
+ * goes through the player's MCCP stream if one is running, and a socket that
+ * could not take everything is marked as no longer writable.  Returns the
+ * number of bytes of txt that were accepted, or -1 on a fatal error. */
+int write_to_client(struct descriptor_data *d, const char *txt)
+{
+  struct iovec iov;
+
+  iov.iov_base = (void *) txt;
+  iov.iov_len = strlen(txt);
+
+  return (write_to_client_iov(d, &iov, 1));
+}
+
+/* write_to_client for text in 'count' pieces, sent as if they were one
+ * string.  Without MCCP they go to the kernel in a single writev(). */
+static int write_to_client_iov(struct descriptor_data *d, struct iovec *iov, int count)
+{
+  ssize_t result;
+  size_t total = 0;
+  int i;
+#ifdef HAVE_ZLIB
+  ssize_t pending;
+#endif
+
+  for (i = 0; i < count; i++)
+    total += iov[i].iov_len;
+
+#ifdef HAVE_ZLIB
+  if (d->comp) {
+    if ((pending = flush_compressed(d)) < 0)
+      return (-1);
+    if (pending > 0) {
+      REMOVE_BIT(d->io_flags, IO_WRITABLE);
+      return (0);
+    }
+
+    if (d->comp->finished)
+      free_compression(d);
+    else {
+      if (total > 0) {
+        for (i = 0; i < count; i++)
+          if (compress_text(d->comp, iov[i].iov_base, iov[i].iov_len,
+                            i == count - 1 ? Z_SYNC_FLUSH : Z_NO_FLUSH) < 0)
+            return (-1);
+        if ((pending = flush_compressed(d)) < 0)
+          return (-1);
+        if (pending > 0)
+          REMOVE_BIT(d->io_flags, IO_WRITABLE);
+      }
+      return (total);
+    }
+  }
+#endif
+
+  if (total == 0)
+    return (0);
+
+  if ((result = perform_socket_writev(d->descriptor, iov, count)) < 0) {
+    /* Fatal error.  Disconnect the player. */
+    perror("SYSERR: Write to socket");
+    return (-1);
+  }
+
+  /* A short write means the kernel buffer is full; hold off until the
+   * backend reports the socket writable again. */
+  if ((size_t) result < total)
+    REMOVE_BIT(d->io_flags, IO_WRITABLE);
+
+  return (result);
+}
+
 /* Same information about perform_socket_write applies here. I like
  * standards, there are so many of them. -gg 6/30/98 */
 static ssize_t perform_socket_read(socket_t desc, char *read_point, size_t space_left)
@@ -1860,9 +2477,15 @@ static int process_input(struct descriptor_data *t)
 
     /* Since we have recieved atleast 1 byte of data from the socket, lets run it through
      * ProtocolInput() and rip out anything that is Out Of Band */ 
-    if ( bytes_read > 0 )
+    if ( bytes_read > 0 ) {
       bytes_read = ProtocolInput( t, read_buf, bytes_read, t->inbuf );
 
+      /* Nothing but negotiation; there may be more behind it, so keep reading
+       * until the socket would block rather than returning early. */
+      if ( bytes_read == 0 )
+        continue;
+    }
+
     if (bytes_read < 0)	/* Error, disconnect them. */
       return (-1);
     else if (bytes_read == 0)	/* Just blocking, no problems. */
@@ -1940,7 +2563,7 @@ static int process_input(struct descriptor_data *t)
       char buffer[MAX_INPUT_LENGTH + 64];
 
       snprintf(buffer, sizeof(buffer), "Line too long.  Truncated to:\r\n%s\r\n", tmp);
-      if (write_to_descriptor(t->descriptor, buffer) < 0)
+      if (write_to_client(t, buffer) < 0)
 	return (-1);
     }
     if (t->snoop_by)
@@ -2061,8 +2684,10 @@ void close_socket(struct descriptor_data *d)
   struct descriptor_data *temp;
 
   REMOVE_FROM_LIST(d, descriptor_list, next);
+  io_remove(d);
   CLOSE_SOCKET(d->descriptor);
   flush_queues(d);
+  out_discard(d);
 
   /* Forget snooping */
   if (d->snooping)
@@ -2076,6 +2701,7 @@ void close_socket(struct descriptor_data *d)
   if (d->character) {
     /* If we're switched, this resets the mobile taken. */
     d->character->desc = NULL;
+    update_zone_players(d->character);
 
     /* Plug memory leak, from Eric Green. */
     if (!IS_NPC(d->character) && PLR_FLAGGED(d->character, PLR_MAILING) && d->str) {
@@ -2124,6 +2750,11 @@ void close_socket(struct descriptor_data *d)
   
   /* KaVir's plugin*/
   ProtocolDestroy( d->pProtocol );
+
+#ifdef HAVE_ZLIB
+  if (d->comp)
+    free_compression(d);
+#endif
  
   /* Mud Events */
   if (d->events->iSize > 0) {
@@ -2280,11 +2911,17 @@ static RETSIGTYPE checkpointing(int sig)
 #endif
 }
 
-/* Dying anyway... */
+/* Leave the game loop the way the shutdown command does, so players are saved
+ * and the background writer drains its queue before we exit.  A second signal
+ * while that is under way kills us outright. */
 static RETSIGTYPE hupsig(int sig)
 {
+  if (circle_shutdown) {
+    log("SYSERR: Received another SIGHUP, SIGINT, or SIGTERM.  Dying now.");
+    exit(1);
+  }
   log("SYSERR: Received SIGHUP, SIGINT, or SIGTERM.  Shutting down...");
-  exit(1); /* perhaps something more elegant should substituted */
+  circle_shutdown = 1;
 }
 
 #endif	/* CIRCLE_UNIX */
@@ -2390,21 +3027,199 @@ size_t send_to_char(struct char_data *ch, const char *messg, ...)
   return 0;
 }
 
+/* Broadcasts.  Instead of formatting a message over again for every
+ * recipient, the send_to_*() functions format it once, and act() renders it
+ * once for each way its recipients see it: which of ch, obj and vict_obj they
+ * can see, for the $-codes it uses, and for TO_GMOTE whether they have
+ * colour.  ProtocolOutput() is likewise run once per protocol class, or not
+ * at all for plain text (see ProtocolOutputShared()).  A render_cache keeps
+ * the results for the length of one call.
+ *
+ * Text going to more than one recipient is also only queued once: it is
+ * copied into the shared block of the recipient's protocol class, and each
+ * queue gets a reference to it.  Someone watching a room full of fighting,
+ * who sees each line in turn, ends up with one segment covering the lot
+ * rather than a copy of every line. */
+#define RENDER_SLOTS  32
+#define RENDER_PROTO  0x1000  /* key bit: a raw slot's ProtocolOutput() */
+#define OUT_STREAMS   17      /* ProtocolOutputClass() is 1 to 16; 0 is plain */
+
+struct render_cache {
+  int count;                 /* slots in use */
+  size_t used;               /* bytes of text in use */
+  bool fanout;               /* going to several recipients: share it */
+  struct {
+    int key;                 /* view, or RENDER_PROTO | view << 5 | class */
+    output_share_t share;    /* what ProtocolOutput() does to a raw slot */
+    size_t off, len;
+    int stream;              /* out_stream[] the text was copied into... */
+    unsigned long serial;    /* ...while it had this serial, or 0 */
+    size_t boff;             /* where, in that block */
+  } slot[RENDER_SLOTS];
+  char text[MAX_STRING_LENGTH];
+};
+
+static struct render_cache broadcast;  /* for the send_to_*() functions */
+
+/* The blocks shared text is copied into.  Each holds a reference to its
+ * block, and takes a fresh one with a new serial when it fills up. */
+static struct {
+  struct out_block *block;
+  unsigned long serial;
+} out_stream[OUT_STREAMS];
+
+static void render_reset(struct render_cache *rc)
+{
+  rc->count = 0;
+  rc->used = 0;
+}
+
+static int render_find(struct render_cache *rc, int key)
+{
+  int n;
+
+  for (n = 0; n < rc->count; n++)
+    if (rc->slot[n].key == key)
+      return (n);
+  return (-1);
+}
+
+/* Make the 'len' bytes at rc->text + rc->used, NUL terminated, slot 'key'. */
+static int render_keep(struct render_cache *rc, int key, size_t len, output_share_t share)
+{
+  int n = rc->count++;
+
+  rc->slot[n].key = key;
+  rc->slot[n].share = share;
+  rc->slot[n].off = rc->used;
+  rc->slot[n].len = len;
+  rc->slot[n].serial = 0;
+  rc->used += len + 1;
+  return (n);
+}
+
+/* Queue text that has already been through ProtocolOutput() for d. */
+static void write_rendered(struct descriptor_data *d, const char *txt, size_t len)
+{
+  if (d->pProtocol->WriteOOB > 0)
+    --d->pProtocol->WriteOOB;
+
+  out_append(d, txt, out_room(d, len));
+}
+
+/* Queue slot 'n' of rc, which is ready to send, as d's protocol 'class'. */
+static void write_slot(struct descriptor_data *d, struct render_cache *rc, int n, int class)
+{
+  const char *txt = rc->text + rc->slot[n].off;
+  size_t len = rc->slot[n].len;
+  struct out_seg *tail = d->out_tail;
+  struct out_block *block;
+
+  /* Copy it after all if d is partway into a block of its own, so that
+   * private and shared lines taking turns don't cost a block each. */
+  if (!rc->fanout || len > OUT_BLOCK_SIZE || (tail && tail->len > 0 &&
+      tail->block->refs == 1 && tail->off + tail->len == tail->block->len &&
+      tail->block->len + len <= OUT_BLOCK_SIZE)) {
+    write_rendered(d, txt, len);
+    return;
+  }
+
+  if (rc->slot[n].serial == 0 || rc->slot[n].stream != class ||
+      rc->slot[n].serial != out_stream[class].serial) {
+    block = out_stream[class].block;
+    if (!block || block->len + len > OUT_BLOCK_SIZE) {
+      if (block && --block->refs == 0)
+        pool_free(out_block_pool, block);
+      block = out_stream[class].block = pool_alloc(out_block_pool);
+      block->refs = 1;
+      out_stream[class].serial++;
+    }
+    memcpy(block->text + block->len, txt, len);
+    rc->slot[n].stream = class;
+    rc->slot[n].serial = out_stream[class].serial;
+    rc->slot[n].boff = block->len;
+    block->len += len;
+  }
+
+  if (d->pProtocol->WriteOOB > 0)
+    --d->pProtocol->WriteOOB;
+
+  out_link(d, out_stream[class].block, rc->slot[n].boff, out_room(d, len));
+}
+
+/* Send raw slot 'n' of rc to d, as write_to_output(d, "%s", text) would. */
+static void write_shared(struct descriptor_data *d, struct render_cache *rc, int n)
+{
+  const char *txt = rc->text + rc->slot[n].off, *out;
+  int class, key, p, len;
+
+  if (d->out_overflow)
+    return;
+
+  if (rc->slot[n].share == eOUTPUT_EACH) {
+    write_to_output(d, "%s", txt);
+    return;
+  }
+
+  /* Plain text is the same for every class, so it all goes through the
+   * block of class 0. */
+  if (rc->slot[n].share == eOUTPUT_PLAIN) {
+    write_slot(d, rc, n, 0);
+    return;
+  }
+
+  class = ProtocolOutputClass(d);
+  key = RENDER_PROTO | (rc->slot[n].key << 5) | class;
+  if ((p = render_find(rc, key)) >= 0) {
+    write_slot(d, rc, p, class);
+    return;
+  }
+
+  len = rc->slot[n].len;
+  out = ProtocolOutput(d, txt, &len);
+  if (rc->count < RENDER_SLOTS && rc->used + len < sizeof(rc->text)) {
+    memcpy(rc->text + rc->used, out, len + 1);
+    write_slot(d, rc, render_keep(rc, key, len, eOUTPUT_PLAIN), class);
+  } else
+    write_rendered(d, out, len);
+}
+
+/* Format a send_to_*() message into the broadcast cache; returns its slot. */
+static int broadcast_format(const char *format, va_list args)
+{
+  const char *text_overflow = "\r\nOVERFLOW\r\n";
+  int size;
+
+  render_reset(&broadcast);
+  broadcast.fanout = TRUE;
+  size = vsnprintf(broadcast.text, sizeof(broadcast.text), format, args);
+
+  if (size < 0 || size >= (int) sizeof(broadcast.text)) {
+    size = sizeof(broadcast.text) - 1;
+    strcpy(broadcast.text + size - strlen(text_overflow), text_overflow);	/* strcpy: OK */
+  }
+
+  return (render_keep(&broadcast, 0, size, ProtocolOutputShared(broadcast.text)));
+}
+
 void send_to_all(const char *messg, ...)
 {
   struct descriptor_data *i;
   va_list args;
+  int n;
 
   if (messg == NULL)
     return;
 
+  va_start(args, messg);
+  n = broadcast_format(messg, args);
+  va_end(args);
+
   for (i = descriptor_list; i; i = i->next) {
     if (STATE(i) != CON_PLAYING)
       continue;
 
-    va_start(args, messg);
-    vwrite_to_output(i, messg, args);
-    va_end(args);
+    write_shared(i, &broadcast, n);
   }
 }
 
@@ -2412,10 +3227,15 @@ void send_to_outdoor(const char *messg, ...)
 {
   struct descriptor_data *i;
   va_list args;
+  int n;
 
   if (!messg || !*messg)
     return;
 
+  va_start(args, messg);
+  n = broadcast_format(messg, args);
+  va_end(args);
+
   for (i = descriptor_list; i; i = i->next) {
 
     if (STATE(i) != CON_PLAYING || i->character == NULL)
@@ -2423,9 +3243,7 @@ void send_to_outdoor(const char *messg, ...)
     if (!AWAKE(i->character) || !OUTSIDE(i->character))
       continue;
 
-    va_start(args, messg);
-    vwrite_to_output(i, messg, args);
-    va_end(args);
+    write_shared(i, &broadcast, n);
   }
 }
 
@@ -2433,17 +3251,20 @@ void send_to_room(room_rnum room, const char *messg, ...)
 {
   struct char_data *i;
   va_list args;
+  int n;
 
   if (messg == NULL)
     return;
 
+  va_start(args, messg);
+  n = broadcast_format(messg, args);
+  va_end(args);
+
   for (i = world[room].people; i; i = i->next_in_room) {
     if (!i->desc)
       continue;
 
-    va_start(args, messg);
-    vwrite_to_output(i->desc, messg, args);
-    va_end(args);
+    write_shared(i->desc, &broadcast, n);
   }
 }
 
@@ -2454,17 +3275,20 @@ void send_to_group(struct char_data *ch, struct group_data *group, const char *
 {
 	struct char_data *tch;
   va_list args;
+  int n;
 
   if (msg == NULL)
     return;
-    	
+
+  va_start(args, msg);
+  n = broadcast_format(msg, args);
+  va_end(args);
+
   while ((tch = simple_list(group->members)) != NULL) {
     if (tch != ch && !IS_NPC(tch) && tch->desc && STATE(tch->desc) == CON_PLAYING) {
       write_to_output(tch->desc, "%s[%sGroup%s]%s ", 
       CCGRN(tch, C_NRM), CBGRN(tch, C_NRM), CCGRN(tch, C_NRM), CCNRM(tch, C_NRM));
-      va_start(args, msg);
-      vwrite_to_output(tch->desc, msg, args);
-      va_end(args);
+      write_shared(tch->desc, &broadcast, n);
     }
   }
 }
@@ -2475,7 +3299,7 @@ void send_to_range(room_vnum start, room_vnum finish, const char *messg, ...)
 {
   struct char_data *i;
   va_list args;
-  int j;
+  int j, n;
 
   if (start > finish) {
     log("send_to_range passed start room value greater then finish.");
@@ -2484,91 +3308,168 @@ void send_to_range(room_vnum start, room_vnum finish, const char *messg, ...)
   if (messg == NULL)
     return;
 
+  va_start(args, messg);
+  n = broadcast_format(messg, args);
+  va_end(args);
+
   for (j = 0; j < top_of_world; j++) {
     if (GET_ROOM_VNUM(j) >= start && GET_ROOM_VNUM(j) <= finish) {
       for (i = world[j].people; i; i = i->next_in_room) {
         if (!i->desc)
           continue;
 
-        va_start(args, messg);
-        vwrite_to_output(i->desc, messg, args);
-        va_end(args);
+        write_shared(i->desc, &broadcast, n);
       }
     }
   }
 }
 
-static const char *ACTNULL = "<NULL>";
-#define CHECK_NULL(pointer, expression) \
-  if ((pointer) == NULL) i = ACTNULL; else i = (expression);
 /* higher-level communication: the act() function */
-void perform_act(const char *orig, struct char_data *ch, struct obj_data *obj,
-    void *vict_obj, struct char_data *to)
+
+/* What a recipient of an act() message sees depends only on these. */
+#define ACT_SEE_CH    (1 << 0)  /**< can see ch, for $n */
+#define ACT_SEE_VICT  (1 << 1)  /**< can see vict_obj, for $N */
+#define ACT_SEE_OBJ   (1 << 2)  /**< can see obj, for $o and $p */
+#define ACT_SEE_VOBJ  (1 << 3)  /**< can see vict_obj, for $O and $P */
+#define ACT_COLOUR    (1 << 4)  /**< has colour, for TO_GMOTE */
+
+struct act_data {
+  const char *orig[2];       /* the message; [1] is its ACT_COLOUR version */
+  struct char_data *ch;
+  struct obj_data *obj;
+  void *vict_obj;
+  int uses;                  /* ACT_ bits that matter to this message */
+  struct char_data *dg_victim;  /* for act_mtrigger() */
+  struct obj_data *dg_target;
+  char *dg_arg;
+};
+
+static void act_setup(struct act_data *a, const char *orig, struct char_data *ch,
+    struct obj_data *obj, void *vict_obj)
 {
-  const char *i = NULL;
-  char lbuf[MAX_STRING_LENGTH], *buf, *j;
-  bool uppercasenext = FALSE;
-  struct char_data *dg_victim = NULL;
-  struct obj_data *dg_target = NULL;
-  char *dg_arg = NULL;
+  const char *p;
+
+  a->orig[0] = a->orig[1] = orig;
+  a->ch = ch;
+  a->obj = obj;
+  a->vict_obj = vict_obj;
+  a->uses = 0;
+  a->dg_victim = NULL;
+  a->dg_target = NULL;
+  a->dg_arg = NULL;
+
+  for (p = orig; (p = strchr(p, '$')) != NULL && *(++p); p++) {
+    switch (*p) {
+    case 'n':
+      a->uses |= ACT_SEE_CH;
+      break;
+    case 'N':
+      a->uses |= ACT_SEE_VICT;
+      /* fall through */
+    case 'M': case 'S': case 'E':
+      a->dg_victim = (struct char_data *) vict_obj;
+      break;
+    case 'o': case 'p':
+      a->uses |= ACT_SEE_OBJ;
+      break;
+    case 'O': case 'P':
+      a->uses |= ACT_SEE_VOBJ;
+      /* fall through */
+    case 'A':
+      a->dg_target = (struct obj_data *) vict_obj;
+      break;
+    case 'T':
+      a->dg_arg = (char *) vict_obj;
+      break;
+    }
+  }
+}
+
+static int act_view(struct act_data *a, struct char_data *to)
+{
+  struct char_data *vict = a->vict_obj;
+  struct obj_data *vobj = a->vict_obj;
+  int view = 0;
 
-  buf = lbuf;
+  if ((a->uses & ACT_SEE_CH) && CAN_SEE(to, a->ch))
+    view |= ACT_SEE_CH;
+  if ((a->uses & ACT_SEE_VICT) && vict && CAN_SEE(to, vict))
+    view |= ACT_SEE_VICT;
+  if ((a->uses & ACT_SEE_OBJ) && a->obj && CAN_SEE_OBJ(to, a->obj))
+    view |= ACT_SEE_OBJ;
+  if ((a->uses & ACT_SEE_VOBJ) && vobj && CAN_SEE_OBJ(to, vobj))
+    view |= ACT_SEE_VOBJ;
+  if ((a->uses & ACT_COLOUR) && clr(to, C_NRM))
+    view |= ACT_COLOUR;
 
-  for (;;) {
+  return (view);
+}
+
+static const char *ACTNULL = "<NULL>";
+#define CHECK_NULL(pointer, expression) \
+  if ((pointer) == NULL) i = ACTNULL; else i = (expression);
+#define ACT_PERS(c, seen)  ((seen) ? GET_NAME(c) : (GET_LEVEL(c) > LVL_IMMORT ? "an immortal" : "someone"))
+#define ACT_OBJS(o, seen)  ((seen) ? (o)->short_description : "something")
+#define ACT_OBJN(o, seen)  ((seen) ? fname((o)->name) : "something")
+
+/* Expand the message as seen with 'view' into 'lbuf', ending it with \r\n.
+ * Returns FALSE if it had to be cut short to fit in 'size'. */
+static bool act_render(struct act_data *a, int view, char *lbuf, size_t size, size_t *len)
+{
+  const char *orig = a->orig[(view & ACT_COLOUR) ? 1 : 0], *i = NULL;
+  struct char_data *ch = a->ch;
+  struct obj_data *obj = a->obj;
+  void *vict_obj = a->vict_obj;
+  char *buf = lbuf, *end = lbuf + size - 3, *j;
+  bool uppercasenext = FALSE, fits;
+
+  while (*orig && buf < end) {
     if (*orig == '$') {
       switch (*(++orig)) {
       case 'n':
-	i = PERS(ch, to);
+	i = ACT_PERS(ch, view & ACT_SEE_CH);
 	break;
       case 'N':
-	CHECK_NULL(vict_obj, PERS((const struct char_data *) vict_obj, to));
-	dg_victim = (struct char_data *) vict_obj;
+	CHECK_NULL(vict_obj, ACT_PERS((struct char_data *) vict_obj, view & ACT_SEE_VICT));
 	break;
       case 'm':
 	i = HMHR(ch);
 	break;
       case 'M':
 	CHECK_NULL(vict_obj, HMHR((const struct char_data *) vict_obj));
-	dg_victim = (struct char_data *) vict_obj;
 	break;
       case 's':
 	i = HSHR(ch);
 	break;
       case 'S':
 	CHECK_NULL(vict_obj, HSHR((const struct char_data *) vict_obj));
-	dg_victim = (struct char_data *) vict_obj;
 	break;
       case 'e':
 	i = HSSH(ch);
 	break;
       case 'E':
 	CHECK_NULL(vict_obj, HSSH((const struct char_data *) vict_obj));
-	dg_victim = (struct char_data *) vict_obj;
 	break;
       case 'o':
-	CHECK_NULL(obj, OBJN(obj, to));
+	CHECK_NULL(obj, ACT_OBJN(obj, view & ACT_SEE_OBJ));
 	break;
       case 'O':
-	CHECK_NULL(vict_obj, OBJN((const struct obj_data *) vict_obj, to));
-	dg_target = (struct obj_data *) vict_obj;
+	CHECK_NULL(vict_obj, ACT_OBJN((struct obj_data *) vict_obj, view & ACT_SEE_VOBJ));
 	break;
       case 'p':
-	CHECK_NULL(obj, OBJS(obj, to));
+	CHECK_NULL(obj, ACT_OBJS(obj, view & ACT_SEE_OBJ));
 	break;
       case 'P':
-	CHECK_NULL(vict_obj, OBJS((const struct obj_data *) vict_obj, to));
-	dg_target = (struct obj_data *) vict_obj;
+	CHECK_NULL(vict_obj, ACT_OBJS((struct obj_data *) vict_obj, view & ACT_SEE_VOBJ));
 	break;
       case 'a':
 	CHECK_NULL(obj, SANA(obj));
 	break;
       case 'A':
 	CHECK_NULL(vict_obj, SANA((const struct obj_data *) vict_obj));
-	dg_target = (struct obj_data *) vict_obj;
 	break;
        case 'T':
  	CHECK_NULL(vict_obj, (const char *) vict_obj);
- 	dg_arg = (char *) vict_obj;
 	break;
       case 't':
  	CHECK_NULL(obj, (char *) obj);
@@ -2595,46 +3496,109 @@ void perform_act(const char *orig, struct char_data *ch, struct obj_data *obj,
 	log("SYSERR: Illegal $-code to act(): %c", *orig);
 	log("SYSERR: %s", orig);
 	i = "";
+	if (!*orig)	/* a '$' at the very end */
+	  orig--;
 	break;
       }
-      while ((*buf = *(i++)))
-        {
-        if (uppercasenext && !isspace((int) *buf))
-          {
-          *buf = UPPER(*buf);
-          uppercasenext = FALSE;
-          }
-	buf++;
-        }
       orig++;
-    } else if (!(*(buf++) = *(orig++))) {
-      break;
-    } else if (uppercasenext && !isspace((int) *(buf-1))) {
-      *(buf-1) = UPPER(*(buf-1));
-      uppercasenext = FALSE;
-    }
+    } else
+      i = NULL;
+
+    /* Copy the expansion, or else the next character of the message. */
+    do {
+      *buf = (i ? *i : *orig);
+      if (!*buf)
+        break;
+      if (uppercasenext && !isspace((int) *buf)) {
+        *buf = UPPER(*buf);
+        uppercasenext = FALSE;
+      }
+      buf++;
+    } while (i && *(++i) && buf < end);
+
+    if (!i)
+      orig++;
   }
+  fits = (buf < end);
+
+  *(buf++) = '\r';
+  *(buf++) = '\n';
+  *buf = '\0';
 
-  *(--buf) = '\r';
-  *(++buf) = '\n';
-  *(++buf) = '\0';
+  CAP(lbuf);
+  *len = buf - lbuf;
+
+  return (fits);
+}
+
+/* The slot in rc holding the message as seen with 'view', rendering it if
+ * it is not there yet. */
+static int act_text(struct act_data *a, struct render_cache *rc, int view)
+{
+  size_t len;
+  int n;
+
+  if ((n = render_find(rc, view)) >= 0)
+    return (n);
+
+  /* Out of room: start the cache over, which always leaves enough. */
+  if (rc->count == RENDER_SLOTS || rc->used + MAX_INPUT_LENGTH > sizeof(rc->text) ||
+      !act_render(a, view, rc->text + rc->used, sizeof(rc->text) - rc->used, &len)) {
+    render_reset(rc);
+    act_render(a, view, rc->text, sizeof(rc->text), &len);
+  }
+
+  return (render_keep(rc, view, len, ProtocolOutputShared(rc->text + rc->used)));
+}
+
+/* Deliver the message to one recipient; returns the view it saw. */
+static int act_send(struct act_data *a, struct render_cache *rc, struct char_data *to)
+{
+  int view = act_view(a, to), n = act_text(a, rc, view);
 
   if (to->desc)
-    write_to_output(to->desc, "%s", CAP(lbuf));
+    write_shared(to->desc, rc, n);
+
+  if ((IS_NPC(to) && dg_act_check) && (to != a->ch) && SCRIPT_CHECK(to, MTRIG_ACT)) {
+    act_mtrigger(to, rc->text + rc->slot[n].off, a->ch, a->dg_victim, a->obj, a->dg_target, a->dg_arg);
+    /* The script may have changed what the rest of the room can see. */
+    render_reset(rc);
+  }
+
+  return (view);
+}
 
-  if ((IS_NPC(to) && dg_act_check) && (to != ch))
-    act_mtrigger(to, lbuf, ch, dg_victim, obj, dg_target, dg_arg);
+/* Remember the message as seen with 'view', for act()'s return value. */
+static char *act_last(struct act_data *a, struct render_cache *rc, int view)
+{
+  int n = act_text(a, rc, view);
 
   if (last_act_message)
     free(last_act_message);
-  last_act_message = strdup(lbuf);
+  last_act_message = strdup(rc->text + rc->slot[n].off);
+
+  return (last_act_message);
+}
+
+void perform_act(const char *orig, struct char_data *ch, struct obj_data *obj,
+    void *vict_obj, struct char_data *to)
+{
+  struct render_cache rc;
+  struct act_data a;
+
+  act_setup(&a, orig, ch, obj, vict_obj);
+  render_reset(&rc);
+  rc.fanout = FALSE;
+  act_last(&a, &rc, act_send(&a, &rc, to));
 }
 
 char *act(const char *str, int hide_invisible, struct char_data *ch,
 	 struct obj_data *obj, void *vict_obj, int type)
 {
+  struct render_cache rc;
+  struct act_data a;
   struct char_data *to;
-  int to_sleeping;
+  int to_sleeping, view = -1;
 
   if (!str || !*str)
     return NULL;
@@ -2656,19 +3620,19 @@ char *act(const char *str, int hide_invisible, struct char_data *ch,
   if (!(dg_act_check = !IS_SET(type, DG_NO_TRIG)))
     REMOVE_BIT(type, DG_NO_TRIG);
 
+  act_setup(&a, str, ch, obj, vict_obj);
+  render_reset(&rc);
+  rc.fanout = (type != TO_CHAR && type != TO_VICT);
+
   if (type == TO_CHAR) {
-    if (ch && SENDOK(ch)) {
-      perform_act(str, ch, obj, vict_obj, ch);
-      return last_act_message;
-    }
+    if (ch && SENDOK(ch))
+      return act_last(&a, &rc, act_send(&a, &rc, ch));
     return NULL;
   }
 
   if (type == TO_VICT) {
-    if ((to = vict_obj) != NULL && SENDOK(to)) {
-      perform_act(str, ch, obj, vict_obj, to);
-      return last_act_message;
-    }
+    if ((to = vict_obj) != NULL && SENDOK(to))
+      return act_last(&a, &rc, act_send(&a, &rc, to));
     return NULL;
   }
 
@@ -2676,17 +3640,21 @@ char *act(const char *str, int hide_invisible, struct char_data *ch,
     struct descriptor_data *i;
     char buf[MAX_STRING_LENGTH];
 
+    /* Those with colour see it in yellow. */
+    snprintf(buf, sizeof(buf), "%s%s%s", KYEL, str, KNRM);
+    a.orig[1] = buf;
+    a.uses |= ACT_COLOUR;
+
     for (i = descriptor_list; i; i = i->next) {
       if (!i->connected && i->character &&
           !PRF_FLAGGED(i->character, PRF_NOGOSS) &&
           !PLR_FLAGGED(i->character, PLR_WRITING) &&
           !ROOM_FLAGGED(IN_ROOM(i->character), ROOM_SOUNDPROOF)) {
 
-        sprintf(buf, "%s%s%s", CCYEL(i->character, C_NRM), str, CCNRM(i->character, C_NRM));
-        perform_act(buf, ch, obj, vict_obj, i->character);
+        view = act_send(&a, &rc, i->character);
       }
     }
-    return last_act_message;
+    return (view < 0 ? last_act_message : act_last(&a, &rc, view));
   }
   /* ASSUMPTION: at this point we know type must be TO_NOTVICT or TO_ROOM */
 
@@ -2706,9 +3674,9 @@ char *act(const char *str, int hide_invisible, struct char_data *ch,
       continue;
     if (type != TO_ROOM && to == vict_obj)
       continue;
-    perform_act(str, ch, obj, vict_obj, to);
+    view = act_send(&a, &rc, to);
   }
-  return last_act_message;
+  return (view < 0 ? last_act_message : act_last(&a, &rc, view));
 }
 
 /* Prefer the file over the descriptor. */
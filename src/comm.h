@@ -16,6 +16,11 @@
 #define NUM_RESERVED_DESCS	8
 #define COPYOVER_FILE "copyover.dat"
 
+/* Descriptor readiness as reported by the I/O backend (d->io_flags). */
+#define IO_READABLE  (1 << 0) /**< socket has input (or EOF) waiting */
+#define IO_WRITABLE  (1 << 1) /**< kernel send buffer has room */
+#define IO_ERROR     (1 << 2) /**< socket has an exception pending */
+
 /* comm.c */
 void close_socket(struct descriptor_data *d);
 void game_info(const char *messg, ...) __attribute__ ((format (printf, 1, 2)));
@@ -49,6 +54,7 @@ char * act(const char *str, int hide_invisible, struct char_data *ch, struct obj
 /* I/O functions */
 void	write_to_q(const char *txt, struct txt_q *queue, int aliased);
 int	write_to_descriptor(socket_t desc, const char *txt);
+int	write_to_client(struct descriptor_data *d, const char *txt);
 size_t	write_to_output(struct descriptor_data *d, const char *txt, ...) __attribute__ ((format (printf, 2, 3)));
 size_t	vwrite_to_output(struct descriptor_data *d, const char *format, va_list args);
 
@@ -59,14 +65,15 @@ void echo_on(struct descriptor_data *d);
 void game_loop(socket_t mother_desc);
 void heartbeat(int heart_pulse);
 void copyover_recover(void);
+const char *io_backend_name(void);
+void start_compression(struct descriptor_data *d);
+void end_compression(struct descriptor_data *d);
 
 /** webster dictionary lookup */
 extern long last_webster_teller;
 
 extern struct descriptor_data *descriptor_list;
-extern int buf_largecount;
 extern int buf_overflows;
-extern int buf_switches;
 extern int circle_shutdown;
 extern int circle_reboot;
 extern int no_specials;
@@ -38,6 +38,10 @@
 #include "mud_event.h"
 #include "msgedit.h"
 #include "screen.h"
+#include "worldimg.h"
+#include "bootpool.h"
+#include "mempool.h"
+#include "keyword.h"
 #include <sys/stat.h>
 
 /*  declarations of most of the 'global' variables */
@@ -83,6 +87,7 @@ int top_shop = -1;              /* top of shop table             */
 int no_mail = 0;                /* mail disabled?		 */
 int mini_mud = 0;               /* mini-mud mode?		 */
 int no_rent_check = 0;          /* skip rent check on boot?	 */
+int no_world_image = 0;         /* always parse the room files?	 */
 time_t boot_time = 0;           /* time of mud boot		 */
 int circle_restrict = 0;        /* level of game restriction	 */
 room_rnum r_mortal_start_room;	/* rnum of mortal start room	 */
@@ -125,6 +130,17 @@ struct happyhour happy_data = {0,0,0,0};
 /* declaration of local (file scope) variables */
 static int converting = FALSE;
 
+/* The room files named in the index, while they are parsed by boot_rooms().
+ * Each gets the rooms it holds in a staging array, which the game thread
+ * copies into world[] in index order. */
+struct room_file {
+  char *path;
+  struct room_data *rooms;
+  int count, size;
+};
+static struct room_file *room_files = NULL;
+static int num_room_files = 0;
+
 /* Local (file scope) utility functions */
 static int check_bitvector_names(bitvector_t bits, size_t namecount, const char *whatami, const char *whatbits);
 static int check_object_spell_number(struct obj_data *obj, int val);
@@ -149,6 +165,9 @@ static void load_default_config( void );
 static void free_extra_descriptions(struct extra_descr_data *edesc);
 static bitvector_t asciiflag_conv_aff(char *flag);
 static int hsort(const void *a, const void *b);
+static void boot_rooms(void);
+static void parse_room_file(int job);
+static void replay_room_file(int job, struct boot_event *ev);
 
 /* routines for booting the system */
 char *fread_action(FILE *fl, int nr)
@@ -451,10 +470,15 @@ void boot_world(void)
   index_boot(DB_BOOT_TRG);
 
   log("Loading rooms.");
-  index_boot(DB_BOOT_WLD);
+  if (!wldimg_load()) {
+    index_boot(DB_BOOT_WLD);
+    if (!converting)
+      wldimg_save();
+  }
 
   log("Renumbering rooms.");
   renum_world();
+  relist_random_rooms();
 
   log("Checking start rooms.");
   check_start_rooms();
@@ -1082,12 +1106,17 @@ void index_boot(int mode)
       break;
 
     snprintf(buf2, sizeof(buf2), "%s%s", prefix, buf1);
+    if (mode == DB_BOOT_WLD) {  /* opened and parsed by boot_rooms() */
+      RECREATE(room_files, struct room_file, num_room_files + 1);
+      memset(&room_files[num_room_files], 0, sizeof(struct room_file));
+      room_files[num_room_files++].path = strdup(buf2);
+      continue;
+    }
     if (!(db_file = fopen(buf2, "r"))) {
       log("SYSERR: %s: %s", buf2, strerror(errno));
       exit(1);
     }
     switch (mode) {
-    case DB_BOOT_WLD:
     case DB_BOOT_OBJ:
     case DB_BOOT_MOB:
     case DB_BOOT_TRG:
@@ -1109,6 +1138,9 @@ void index_boot(int mode)
   }
   fclose(db_index);
 
+  if (mode == DB_BOOT_WLD)
+    boot_rooms();
+
   /* Sort the help index. */
   if (mode == DB_BOOT_HLP) {
     qsort(help_table, top_of_helpt, sizeof(struct help_index_element), hsort);
@@ -1136,7 +1168,7 @@ void discrete_load(FILE *fl, int mode, char *filename)
 	      "(maybe the file is not terminated with '$'?)", filename,
 	      modes[mode], nr, modes[mode]);
 	}
-	exit(1);
+	bootpool_fail();
       }
     if (*line == '$')
       return;
@@ -1145,7 +1177,7 @@ void discrete_load(FILE *fl, int mode, char *filename)
       last = nr;
       if (sscanf(line, "#%d", &nr) != 1) {
 	log("SYSERR: Format error after %s #%d", modes[mode], last);
-	exit(1);
+	bootpool_fail();
       }
       if (nr >= 99999)
 	return;
@@ -1171,7 +1203,7 @@ void discrete_load(FILE *fl, int mode, char *filename)
       log("SYSERR: Format error in %s file %s near %s #%d", modes[mode],
 	  filename, modes[mode], nr);
       log("SYSERR: ... offending line: '%s'", line);
-      exit(1);
+      bootpool_fail();
     }
   }
 }
@@ -1231,108 +1263,179 @@ static bitvector_t asciiflag_conv_aff(char *flag)
   return (flags);
 }
 
+/* Parses every room file on the boot workers and builds world[] from what
+ * they staged.  Called by index_boot() once the files are listed. */
+static void boot_rooms(void)
+{
+  int i, rooms = 0;
+
+  bootpool_run(num_room_files, parse_room_file, replay_room_file);
+
+  for (i = 0; i < num_room_files; i++) {
+    rooms += room_files[i].count;
+    free(room_files[i].path);
+    if (room_files[i].rooms)
+      free(room_files[i].rooms);
+  }
+  free(room_files);
+  room_files = NULL;
+  num_room_files = 0;
+
+  top_of_world = MAX(rooms - 1, 0);
+}
+
+/* Runs on a boot worker: everything but the parse itself is deferred. */
+static void parse_room_file(int job)
+{
+  FILE *fl;
+
+  if (!(fl = fopen(room_files[job].path, "r"))) {
+    log("SYSERR: %s: %s", room_files[job].path, strerror(errno));
+    bootpool_fail();
+  }
+  discrete_load(fl, DB_BOOT_WLD, room_files[job].path);
+  fclose(fl);
+}
+
+/* Runs on the game thread, in index order: moves one staged room into
+ * world[], or finishes with the room last moved. */
+static void replay_room_file(int job, struct boot_event *ev)
+{
+  static int room_nr = 0, zone = 0;
+  struct room_data *room;
+
+  switch (ev->kind) {
+  case BOOT_EVENT_ROOM:
+    room = &room_files[job].rooms[ev->num];
+
+    if (room->number < zone_table[zone].bot) {
+      log("SYSERR: Room #%d is below zone %d (bot=%d, top=%d).", room->number, zone_table[zone].number, zone_table[zone].bot, zone_table[zone].top);
+      exit(1);
+    }
+    while (room->number > zone_table[zone].top)
+      if (++zone > top_of_zone_table) {
+        log("SYSERR: Room %d is outside of any zone.", room->number);
+        exit(1);
+      }
+    room->zone = zone;
+
+    if (room_nr)	/* the one before is complete */
+      top_of_world = room_nr - 1;
+    world[room_nr] = *room;
+    vnum_index_set(DB_BOOT_WLD, room->number, room_nr++);
+    break;
+  case BOOT_EVENT_TRIGGER:
+    dg_attach_trigger(&world[room_nr - 1], WLD_TRIGGER, ev->num);
+    break;
+  case BOOT_EVENT_SAVE:
+    add_to_save_list(ev->num, SL_WLD);
+    converting = TRUE;
+    break;
+  }
+}
+
 /* load the rooms */
 void parse_room(FILE *fl, int virtual_nr)
 {
-  static int room_nr = 0, zone = 0;
+  struct room_file *rf = &room_files[bootpool_job()];
+  struct room_data *room;
   int t[10], i, retval;
   char line[READ_SIZE], flags[128], flags2[128], flags3[128];
   char flags4[128], buf2[MAX_STRING_LENGTH], buf[128];
   struct extra_descr_data *new_descr;
   char letter;
 
+  if (rf->count == rf->size) {
+    rf->size = rf->size ? rf->size * 2 : 64;
+    RECREATE(rf->rooms, struct room_data, rf->size);
+  }
+  room = &rf->rooms[rf->count];
+  memset(room, 0, sizeof(struct room_data));
+
+  /* Placed in world[] before anything it logs, which is where the zone is
+   * checked, too. */
+  bootpool_defer(BOOT_EVENT_ROOM, rf->count);
+
   /* This really had better fit or there are other problems. */
   snprintf(buf2, sizeof(buf2), "room #%d", virtual_nr);
 
-  if (virtual_nr < zone_table[zone].bot) {
-    log("SYSERR: Room #%d is below zone %d (bot=%d, top=%d).", virtual_nr, zone_table[zone].number, zone_table[zone].bot, zone_table[zone].top);
-    exit(1);
-  }
-  while (virtual_nr > zone_table[zone].top)
-    if (++zone > top_of_zone_table) {
-      log("SYSERR: Room %d is outside of any zone.", virtual_nr);
-      exit(1);
-    }
-  world[room_nr].zone = zone;
-  world[room_nr].number = virtual_nr;
-  world[room_nr].name = fread_string(fl, buf2);
-  world[room_nr].description = fread_string(fl, buf2);
+  room->number = virtual_nr;
+  room->name = fread_string(fl, buf2);
+  room->description = fread_string(fl, buf2);
 
   if (!get_line(fl, line)) {
     log("SYSERR: Expecting roomflags/sector type of room #%d but file ended!",
 	virtual_nr);
-    exit(1);
+    bootpool_fail();
   }
 
   if (((retval = sscanf(line, " %d %s %s %s %s %d ", t, flags, flags2, flags3, flags4, t + 2)) == 3) && (bitwarning == TRUE)) {
     log("WARNING: Conventional world files detected. See config.c.");
-    exit(1);
+    bootpool_fail();
   } else if ((retval == 3) && (bitwarning == FALSE)) {
     /* Looks like the implementor is ready, so let's load the world files. We
      * load the extra three flags as 0, since they won't be anything anyway. We
      * will save the entire world later on, when every room, mobile, and object
      * is converted. */
     log("Converting room #%d to 128bits..", virtual_nr);
-    world[room_nr].room_flags[0] = asciiflag_conv(flags);
-    world[room_nr].room_flags[1] = 0;
-    world[room_nr].room_flags[2] = 0;
-    world[room_nr].room_flags[3] = 0;
+    room->room_flags[0] = asciiflag_conv(flags);
+    room->room_flags[1] = 0;
+    room->room_flags[2] = 0;
+    room->room_flags[3] = 0;
 
     /* In the old-style files, the 3rd item was the sector-type */
-    world[room_nr].sector_type = atoi(flags2);
+    room->sector_type = atoi(flags2);
 
    sprintf(flags, "room #%d", virtual_nr);	/* sprintf: OK (until 399-bit integers) */
 
     /* No need to scan the other three sections; they're 0 anyway. */
-    check_bitvector_names(world[room_nr].room_flags[0], room_bits_count, flags, "room");
+    check_bitvector_names(room->room_flags[0], room_bits_count, flags, "room");
 
-    if(bitsavetodisk) { /* Maybe the implementor just wants to look at the 128bit files */
-      add_to_save_list(zone_table[real_zone_by_thing(virtual_nr)].number, 3);
-      converting = TRUE;
-    }
+    if(bitsavetodisk) /* Maybe the implementor just wants to look at the 128bit files */
+      bootpool_defer(BOOT_EVENT_SAVE, zone_table[real_zone_by_thing(virtual_nr)].number);
 
   log("   done.");
   } else if (retval == 6) {
     int taeller;
 
-    world[room_nr].room_flags[0] = asciiflag_conv(flags);
-    world[room_nr].room_flags[1] = asciiflag_conv(flags2);
-    world[room_nr].room_flags[2] = asciiflag_conv(flags3);
-    world[room_nr].room_flags[3] = asciiflag_conv(flags4);
+    room->room_flags[0] = asciiflag_conv(flags);
+    room->room_flags[1] = asciiflag_conv(flags2);
+    room->room_flags[2] = asciiflag_conv(flags3);
+    room->room_flags[3] = asciiflag_conv(flags4);
 
     sprintf(flags, "object #%d", virtual_nr);	/* sprintf: OK (until 399-bit integers) */
     for(taeller=0; taeller < AF_ARRAY_MAX; taeller++)
-      check_bitvector_names(world[room_nr].room_flags[taeller], room_bits_count, flags, "room");
+      check_bitvector_names(room->room_flags[taeller], room_bits_count, flags, "room");
 
     /* Added Sanity check */
     if (t[2] > NUM_ROOM_SECTORS) t[2] = SECT_INSIDE;
 
-    world[room_nr].sector_type = t[2];
+    room->sector_type = t[2];
     } else {
       log("SYSERR: Format error in roomflags/sector type of room #%d", virtual_nr);
-    exit(1);
+    bootpool_fail();
   }
 
-  world[room_nr].func = NULL;
-  world[room_nr].contents = NULL;
-  world[room_nr].people = NULL;
-  world[room_nr].light = 0;	/* Zero light sources */
+  room->func = NULL;
+  room->contents = NULL;
+  room->people = NULL;
+  room->light = 0;	/* Zero light sources */
 
   for (i = 0; i < NUM_OF_DIRS; i++) /* NUM_OF_DIRS here, not DIR_COUNT */
-    world[room_nr].dir_option[i] = NULL;
+    room->dir_option[i] = NULL;
 
-  world[room_nr].ex_description = NULL;
+  room->ex_description = NULL;
 
   snprintf(buf, sizeof(buf), "SYSERR: Format error in room #%d (expecting D/E/S)", virtual_nr);
 
   for (;;) {
     if (!get_line(fl, line)) {
       log("%s", buf);
-      exit(1);
+      bootpool_fail();
     }
     switch (*line) {
     case 'D':
-      setup_dir(fl, room_nr, atoi(line + 1));
+      setup_dir(fl, room, atoi(line + 1));
       break;
     case 'E':
       CREATE(new_descr, struct extra_descr_data, 1);
@@ -1349,65 +1452,65 @@ void parse_room(FILE *fl, int virtual_nr)
       	  new_descr->description = end;
       	}
       }
-      new_descr->next = world[room_nr].ex_description;
-      world[room_nr].ex_description = new_descr;
+      new_descr->next = room->ex_description;
+      room->ex_description = new_descr;
       break;
     case 'S':			/* end of room */
       /* DG triggers -- script is defined after the end of the room */
       letter = fread_letter(fl);
       ungetc(letter, fl);
       while (letter=='T') {
-        dg_read_trigger(fl, &world[room_nr], WLD_TRIGGER);
+        dg_read_trigger(fl, room, WLD_TRIGGER);
         letter = fread_letter(fl);
         ungetc(letter, fl);
       }
-      top_of_world = room_nr++;
+      rf->count++;
       return;
     default:
       log("%s", buf);
-      exit(1);
+      bootpool_fail();
     }
   }
 }
 
 /* read direction data */
-void setup_dir(FILE *fl, int room, int dir)
+void setup_dir(FILE *fl, struct room_data *room, int dir)
 {
   int t[5];
   char line[READ_SIZE], buf2[128];
 
-  snprintf(buf2, sizeof(buf2), "room #%d, direction D%d", GET_ROOM_VNUM(room)+1, dir);
+  snprintf(buf2, sizeof(buf2), "room #%d, direction D%d", room->number, dir);
 
   if (!CONFIG_DIAGONAL_DIRS && IS_DIAGONAL(dir)) {
     log("Warning: Diagonal direction disabled: %s", buf2);
     return;
   }
 
-  CREATE(world[room].dir_option[dir], struct room_direction_data, 1);
-  world[room].dir_option[dir]->general_description = fread_string(fl, buf2);
-  world[room].dir_option[dir]->keyword = fread_string(fl, buf2);
+  CREATE(room->dir_option[dir], struct room_direction_data, 1);
+  room->dir_option[dir]->general_description = fread_string(fl, buf2);
+  room->dir_option[dir]->keyword = fread_string(fl, buf2);
 
   if (!get_line(fl, line)) {
     log("SYSERR: Format error, %s", buf2);
-    exit(1);
+    bootpool_fail();
   }
   if (sscanf(line, " %d %d %d ", t, t + 1, t + 2) != 3) {
     log("SYSERR: Format error, %s", buf2);
-    exit(1);
+    bootpool_fail();
   }
   if (t[0] == 1)
-    world[room].dir_option[dir]->exit_info = EX_ISDOOR;
+    room->dir_option[dir]->exit_info = EX_ISDOOR;
   else if (t[0] == 2)
-    world[room].dir_option[dir]->exit_info = EX_ISDOOR | EX_PICKPROOF;
+    room->dir_option[dir]->exit_info = EX_ISDOOR | EX_PICKPROOF;
   else if (t[0] == 3)
-    world[room].dir_option[dir]->exit_info = EX_ISDOOR | EX_HIDDEN;
+    room->dir_option[dir]->exit_info = EX_ISDOOR | EX_HIDDEN;
   else if (t[0] == 4)
-    world[room].dir_option[dir]->exit_info = EX_ISDOOR | EX_PICKPROOF | EX_HIDDEN;
+    room->dir_option[dir]->exit_info = EX_ISDOOR | EX_PICKPROOF | EX_HIDDEN;
   else
-    world[room].dir_option[dir]->exit_info = 0;
+    room->dir_option[dir]->exit_info = 0;
 
-  world[room].dir_option[dir]->key = ((t[1] == -1 || t[1] == 65535) ? NOTHING : t[1]);
-  world[room].dir_option[dir]->to_room = ((t[2] == -1  || t[2] == 0) ? NOWHERE : t[2]);
+  room->dir_option[dir]->key = ((t[1] == -1 || t[1] == 65535) ? NOTHING : t[1]);
+  room->dir_option[dir]->to_room = ((t[2] == -1  || t[2] == 0) ? NOWHERE : t[2]);
 }
 
 /* make sure the start rooms exist & resolve their vnums to rnums */
@@ -1871,6 +1974,7 @@ void parse_mobile(FILE *mob_f, int nr)
   mob_proto[i].nr = i;
   mob_proto[i].desc = NULL;
 
+  vnum_index_set(DB_BOOT_MOB, nr, i);
   top_of_mobt = i++;
 }
 
@@ -2064,6 +2168,7 @@ char *parse_object(FILE *obj_f, int nr)
       break;
     case '$':
     case '#':
+      vnum_index_set(DB_BOOT_OBJ, nr, i);
       top_of_objt = i;
       check_object(obj_proto + i);
       i++;
@@ -2227,6 +2332,7 @@ static void load_zones(FILE *fl, char *zonename)
     exit(1);
   }
 
+  vnum_index_set(DB_BOOT_ZON, Z.number, zone);
   top_of_zone_table = zone++;
 }
 #undef Z
@@ -2339,51 +2445,66 @@ static int hsort(const void *a, const void *b)
   return (str_cmp(a1->keywords, b1->keywords));
 }
 
+/* The vnum_*() functions check only the prototypes the keyword index
+ * offers. */
 int vnum_mobile(char *searchname, struct char_data *ch)
 {
-  int nr, found = 0;
+  int nr, i, n, *rnums, found = 0;
 
-  for (nr = 0; nr <= top_of_mobt; nr++)
+  n = keyword_protos(KW_MOBILES, searchname, &rnums);
+  for (i = 0; i < n; i++) {
+    nr = rnums[i];
     if (isname(searchname, mob_proto[nr].player.name))
       send_to_char(ch, "%3d. [%5d] %-40s %s\r\n",
                    ++found, mob_index[nr].vnum, mob_proto[nr].player.short_descr,
                    mob_proto[nr].proto_script ? "[TRIG]" : "" );
+  }
 
   return (found);
 }
 
 int vnum_object(char *searchname, struct char_data *ch)
 {
-  int nr, found = 0;
+  int nr, i, n, *rnums, found = 0;
 
-  for (nr = 0; nr <= top_of_objt; nr++)
+  n = keyword_protos(KW_OBJECTS, searchname, &rnums);
+  for (i = 0; i < n; i++) {
+    nr = rnums[i];
     if (isname(searchname, obj_proto[nr].name))
       send_to_char(ch, "%3d. [%5d] %-40s %s\r\n",
                    ++found, obj_index[nr].vnum, obj_proto[nr].short_description,
                    obj_proto[nr].proto_script ? "[TRIG]" : "" );
+  }
 
   return (found);
 }
 
 int vnum_room(char *searchname, struct char_data *ch)
 {
- int nr, found = 0;
+ int nr, i, n, *rnums, found = 0;
 
- for (nr = 0; nr <= top_of_world; nr++)
+ n = keyword_protos(KW_ROOMS, searchname, &rnums);
+ for (i = 0; i < n; i++) {
+   nr = rnums[i];
    if (isname(searchname, world[nr].name))
    send_to_char(ch, "%3d. [%5d] %-40s %s\r\n",
    ++found, world[nr].number, world[nr].name,
   world[nr].proto_script ? "[TRIG]" : "" );
+ }
   return (found);
 }
 
 int vnum_trig(char *searchname, struct char_data *ch)
 {
- int nr, found = 0;
-  for (nr = 0; nr < top_of_trigt; nr++)
+ int nr, i, n, *rnums, found = 0;
+
+  n = keyword_protos(KW_TRIGGERS, searchname, &rnums);
+  for (i = 0; i < n; i++) {
+    nr = rnums[i];
     if (isname(searchname, trig_index[nr]->proto->name))
     send_to_char(ch, "%3d. [%5d] %-40s\r\n",
     ++found, trig_index[nr]->vnum, trig_index[nr]->proto->name);
+  }
   return (found);
 }
 
@@ -2392,13 +2513,14 @@ struct char_data *create_char(void)
 {
   struct char_data *ch;
 
-  CREATE(ch, struct char_data, 1);
+  ch = pool_alloc(char_pool);
   clear_char(ch);
   
   new_mobile_data(ch);
   
   ch->next = character_list;
   character_list = ch;
+  keyword_char_add(ch);
 
   ch->script_id = 0;	// set later by char_script_id
 
@@ -2426,12 +2548,13 @@ struct char_data *read_mobile(mob_vnum nr, int type) /* and mob_rnum */
   } else
     i = nr;
 
-  CREATE(mob, struct char_data, 1);
+  mob = pool_alloc(char_pool);
   clear_char(mob);
  
   *mob = mob_proto[i];
   mob->next = character_list;
   character_list = mob;
+  keyword_char_add(mob);
   
   new_mobile_data(mob);  
   
@@ -2464,10 +2587,11 @@ struct obj_data *create_obj(void)
 {
   struct obj_data *obj;
 
-  CREATE(obj, struct obj_data, 1);
+  obj = pool_alloc(obj_pool);
   clear_object(obj);
   obj->next = object_list;
   object_list = obj;
+  keyword_obj_add(obj);
   
   obj->events = NULL;
 
@@ -2487,11 +2611,12 @@ struct obj_data *read_object(obj_vnum nr, int type) /* and obj_rnum */
     return (NULL);
   }
 
-  CREATE(obj, struct obj_data, 1);
+  obj = pool_alloc(obj_pool);
   clear_object(obj);
   *obj = obj_proto[i];
   obj->next = object_list;
   object_list = obj;
+  keyword_obj_add(obj);
   
   obj->events = NULL;
 
@@ -2757,11 +2882,13 @@ void reset_zone(zone_rnum zone)
         if (!SCRIPT(tmob))
           CREATE(SCRIPT(tmob), struct script_data, 1);
         add_trigger(SCRIPT(tmob), read_trigger(ZCMD.arg2), -1);
+        list_random_script(tmob, MOB_TRIGGER);
         last_cmd = 1;
       } else if (ZCMD.arg1==OBJ_TRIGGER && tobj) {
         if (!SCRIPT(tobj))
           CREATE(SCRIPT(tobj), struct script_data, 1);
         add_trigger(SCRIPT(tobj), read_trigger(ZCMD.arg2), -1);
+        list_random_script(tobj, OBJ_TRIGGER);
         last_cmd = 1;
       } else if (ZCMD.arg1==WLD_TRIGGER) {
         if (ZCMD.arg3 == NOWHERE || ZCMD.arg3>top_of_world) {
@@ -2770,6 +2897,7 @@ void reset_zone(zone_rnum zone)
         if (!world[ZCMD.arg3].script)
           CREATE(world[ZCMD.arg3].script, struct script_data, 1);
         add_trigger(world[ZCMD.arg3].script, read_trigger(ZCMD.arg2), -1);
+        list_random_script(&world[ZCMD.arg3], WLD_TRIGGER);
         last_cmd = 1;
       }
 
@@ -2827,6 +2955,10 @@ int is_empty(zone_rnum zone_nr)
 {
   struct descriptor_data *i;
 
+  /* Nobody who could count below is in the zone at all. */
+  if (!zone_table[zone_nr].players)
+    return (1);
+
   for (i = descriptor_list; i; i = i->next) {
     if (STATE(i) != CON_PLAYING)
       continue;
@@ -2858,7 +2990,7 @@ char *fread_string(FILE *fl, const char *error)
   do {
     if (!fgets(tmp, 512, fl)) {
       log("SYSERR: fread_string: format error at or near %s", error);
-      exit(1);
+      bootpool_fail();
     }
     /* If there is a '~', end the string; else put an "\r\n" over the '\n'. */
     /* now only removes trailing ~'s -- Welcor */
@@ -2878,7 +3010,7 @@ char *fread_string(FILE *fl, const char *error)
     if (length + templength >= MAX_STRING_LENGTH) {
       log("SYSERR: fread_string: string too large (db.c)");
       log("%s", error);
-      exit(1);
+      bootpool_fail();
     } else {
       strcat(buf + length, tmp);	/* strcat: OK (size checked above) */
       length += templength;
@@ -3217,6 +3349,8 @@ void free_char(struct char_data *ch)
   int i;
   struct alias_data *a;
 
+  keyword_char_remove(ch);
+
   if (ch->player_specials != NULL && ch->player_specials != &dummy_mob) {
     while ((a = GET_ALIASES(ch)) != NULL) {
       GET_ALIASES(ch) = (GET_ALIASES(ch))->next;
@@ -3228,6 +3362,8 @@ void free_char(struct char_data *ch)
       free(ch->player_specials->poofout);
     if (ch->player_specials->saved.completed_quests)
       free(ch->player_specials->saved.completed_quests);
+    if (ch->player_specials->quests_done)
+      free(ch->player_specials->quests_done);
     if (GET_HOST(ch))
       free(GET_HOST(ch));
     if (IS_NPC(ch))
@@ -3302,12 +3438,14 @@ void free_char(struct char_data *ch)
     remove_from_lookup_table(ch->script_id);
   }
 
-  free(ch);
+  pool_free(char_pool, ch);
 }
 
 /* release memory allocated for an obj struct */
 void free_obj(struct obj_data *obj)
 {
+  keyword_obj_remove(obj);
+
   if (GET_OBJ_RNUM(obj) == NOWHERE) {
     free_object_strings(obj);
     /* free script proto list */
@@ -3327,7 +3465,7 @@ void free_obj(struct obj_data *obj)
     remove_from_lookup_table(obj->script_id);
   }
 
-  free(obj);
+  pool_free(obj_pool, obj);
 }
 
 /* Steps: 1: Read contents of a text file. 2: Make sure no one is using the
@@ -3531,7 +3669,7 @@ void init_char(struct char_data *ch)
   }
 
   if ((i = get_ptable_by_name(GET_NAME(ch))) != -1)
-    player_table[i].id = GET_IDNUM(ch) = ++top_idnum;
+    set_player_index_id(i, GET_IDNUM(ch) = ++top_idnum);
   else
     log("SYSERR: init_char: Character '%s' not found in player table.", GET_NAME(ch));
 
@@ -3577,106 +3715,50 @@ void init_char(struct char_data *ch)
   SET_BIT_AR(PRF_FLAGS(ch), PRF_DISPMOVE);
 }
 
-/* returns the real number of the room with given virtual number */
-room_rnum real_room(room_vnum vnum)
+/* Direct-mapped vnum -> rnum indexes for the world, mobile, object and zone
+ * tables, one slot per possible vnum (IDXTYPE is 16 bits wide).  A slot
+ * holds rnum + 1, so the zero-filled array starts out empty and an empty
+ * slot reads back as NOWHERE/NOBODY/NOTHING.  The tables themselves are
+ * still kept sorted by vnum; the OLC add and delete functions re-point the
+ * slots of every entry they shift. */
+#define VNUM_SLOTS ((long) IDXTYPE_MAX - IDXTYPE_MIN + 1)
+static IDXTYPE vnum_index[DB_BOOT_ZON + 1][VNUM_SLOTS];
+
+/* Record that 'vnum' lives at 'rnum' in the table loaded by 'mode', one of
+ * DB_BOOT_WLD, DB_BOOT_MOB, DB_BOOT_OBJ or DB_BOOT_ZON.  An rnum of NOWHERE
+ * removes the vnum from the index. */
+void vnum_index_set(int mode, IDXTYPE vnum, IDXTYPE rnum)
 {
-  room_rnum bot, top, mid;
-
-  bot = 0;
-  top = top_of_world;
-
-  if (world[bot].number > vnum || world[top].number < vnum)
-    return (NOWHERE);
+  vnum_index[mode][(long) vnum - IDXTYPE_MIN] = (IDXTYPE) (rnum + 1);
+}
 
-  /* perform binary search on world-table */
-  while (bot<= top) {
-    mid = (bot + top) / 2;
+static IDXTYPE vnum_index_get(int mode, IDXTYPE vnum)
+{
+  return ((IDXTYPE) (vnum_index[mode][(long) vnum - IDXTYPE_MIN] - 1));
+}
 
-    if ((world + mid)->number == vnum)
-      return (mid);
-    if ((world + mid)->number > vnum)
-      top = mid - 1;
-    else
-      bot = mid + 1;
-  }
-  return (NOWHERE);
+/* returns the real number of the room with given virtual number */
+room_rnum real_room(room_vnum vnum)
+{
+  return (vnum_index_get(DB_BOOT_WLD, vnum));
 }
 
 /* returns the real number of the monster with given virtual number */
 mob_rnum real_mobile(mob_vnum vnum)
 {
-  mob_rnum bot, top, mid;
-
-  bot = 0;
-  top = top_of_mobt;
-
-  /* quickly reject out-of-range vnums */
-  if (mob_index[bot].vnum > vnum || mob_index[top].vnum < vnum)
-    return (NOBODY);
-
-  /* perform binary search on mob-table */
-  while (bot <= top) {
-    mid = (bot + top) / 2;
-
-    if ((mob_index + mid)->vnum == vnum)
-      return (mid);
-    if ((mob_index + mid)->vnum > vnum)
-      top = mid - 1;
-    else
-      bot = mid + 1;
-  }
-  return (NOBODY);
+  return (vnum_index_get(DB_BOOT_MOB, vnum));
 }
 
 /* returns the real number of the object with given virtual number */
 obj_rnum real_object(obj_vnum vnum)
 {
-  obj_rnum bot, top, mid;
-
-  bot = 0;
-  top = top_of_objt;
-
-  /* quickly reject out-of-range vnums */
-  if (obj_index[bot].vnum > vnum || obj_index[top].vnum < vnum)
-    return (NOTHING);
-
-  /* perform binary search on obj-table */
-  while (bot <= top) {
-    mid = (bot + top) / 2;
-
-    if ((obj_index + mid)->vnum == vnum)
-      return (mid);
-    if ((obj_index + mid)->vnum > vnum)
-      top = mid - 1;
-    else
-      bot = mid + 1;
-  }
-  return (NOTHING);
+  return (vnum_index_get(DB_BOOT_OBJ, vnum));
 }
 
 /* returns the real number of the zone with given virtual number */
 zone_rnum real_zone(zone_vnum vnum)
 {
-  zone_rnum bot, top, mid;
-
-  bot = 0;
-  top = top_of_zone_table;
-
-  if (zone_table[bot].number > vnum || zone_table[top].number < vnum)
-    return (NOWHERE);
-
-  /* perform binary search on zone-table */
-  while (bot <= top) {
-    mid = (bot + top) / 2;
-
-    if ((zone_table + mid)->number == vnum)
-      return (mid);
-    if ((zone_table + mid)->number > vnum)
-      top = mid - 1;
-    else
-      bot = mid + 1;
-  }
-  return (NOWHERE);
+  return (vnum_index_get(DB_BOOT_ZON, vnum));
 }
 
 /* Extend later to include more checks and add checks for unknown bitvectors. */
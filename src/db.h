@@ -84,6 +84,7 @@
 #define TRG_PREFIX  LIB_WORLD"trg"SLASH	/* trigger files	*/
 #define HLP_PREFIX  LIB_TEXT"help"SLASH /* Help files           */
 #define QST_PREFIX  LIB_WORLD"qst"SLASH /* quest files          */
+#define WLD_IMAGE_FILE LIB_WORLD"wld.img" /* compiled rooms, see worldimg.c */
 
 #define CREDITS_FILE	LIB_TEXT"credits" /* for the 'credits' command	*/
 #define NEWS_FILE	LIB_TEXT"news"	/* for the 'news' command	*/
@@ -103,6 +104,7 @@
 #define IDEAS_FILE	LIB_MISC"ideas"	   /* for the 'idea'-command	*/
 #define TYPOS_FILE	LIB_MISC"typos"	   /*         'typo'		*/
 #define BUGS_FILE	LIB_MISC"bugs"	   /*         'bug'		*/
+#define PROFILE_FILE	LIB_MISC"profile"  /* 'profile dump' output	*/
 #define MESS_FILE	LIB_MISC"messages" /* damage messages		*/
 #define SOCMESS_FILE	LIB_MISC"socials"  /* messages for social acts	*/
 #define SOCMESS_FILE_NEW LIB_MISC"socials.new"  /* messages for social acts with aedit patch*/
@@ -133,6 +135,7 @@
 #define PLAYER_FILE	LIB_ETC"players"   /* the player database	*/
 #define MAIL_FILE	LIB_ETC"plrmail"   /* for the mudmail system	*/
 #define MAIL_FILE_TMP	LIB_ETC"plrmail_tmp"   /* for the mudmail system	*/
+#define MAIL_JOURNAL	LIB_ETC"plrmail.jnl"   /* changes since MAIL_FILE	*/
 #define BAN_FILE	LIB_ETC"badsites"  /* for the siteban system	*/
 #define HCONTROL_FILE	LIB_ETC"hcontrol"  /* for the house system	*/
 #define TIME_FILE	LIB_ETC"time"	   /* for calendar system	*/
@@ -189,6 +192,8 @@ struct zone_data {
    zone_vnum number;	    /* virtual number of this zone	  */
    struct reset_com *cmd;   /* command table for reset	          */
 
+   int	players;            /* players in the zone, see char_to_room() */
+
    /* Reset mode:
     *   0: Don't reset, and don't update age.
     *   1: Reset if no PC's are located in zone.
@@ -241,6 +246,8 @@ void  boot_db(void);
 void  destroy_db(void);
 char *fread_action(FILE *fl, int nr);
 int   create_entry(char *name);
+void  set_player_index_id(int pos, long id);
+void  set_player_index_name(int pos, const char *name);
 void  zone_update(void);
 char  *fread_string(FILE *fl, const char *error);
 char  *fread_clean_string(FILE *fl, const char *error);
@@ -258,6 +265,7 @@ void  free_player_index(void);
 void  load_help(FILE *fl, char *name);
 void  new_mobile_data(struct char_data *ch);
 
+void  vnum_index_set(int mode, IDXTYPE vnum, IDXTYPE rnum);
 zone_rnum real_zone(zone_vnum vnum);
 room_rnum real_room(room_vnum vnum);
 mob_rnum real_mobile(mob_vnum vnum);
@@ -305,7 +313,7 @@ int    vnum_object(char *searchname, struct char_data *ch);
 int    vnum_room(char *, struct char_data *);
 int    vnum_trig(char *, struct char_data *);
 
-void setup_dir(FILE *fl, int room, int dir);
+void setup_dir(FILE *fl, struct room_data *room, int dir);
 void index_boot(int mode);
 void discrete_load(FILE *fl, int mode, char *filename);
 void parse_room(FILE *fl, int virtual_nr);
@@ -346,6 +354,7 @@ extern struct help_index_element *help_table;
 /* Mud configurable variables */
 extern int no_mail;
 extern int mini_mud;
+extern int no_world_image;
 extern int no_rent_check;
 extern time_t boot_time;
 extern int circle_restrict;
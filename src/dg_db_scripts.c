@@ -23,6 +23,7 @@
 #include "comm.h"
 #include "constants.h"
 #include "interpreter.h" /* For half_chop */
+#include "bootpool.h"
 
 /* local functions */
 static void trig_data_init(trig_data *this_data);
@@ -71,6 +72,8 @@ void parse_trigger(FILE *trig_f, int nr)
     free(cmds);
 
     trig_index[top_of_trigt++] = t_index;
+
+    compile_trigger(trig);
 }
 
 /* Create a new trigger from a prototype. nr is the real number of the trigger. */
@@ -104,7 +107,7 @@ static void trig_data_init(trig_data *this_data)
     this_data->depth = 0;
     this_data->wait_event = NULL;
     this_data->purged = FALSE;
-    this_data->var_list = NULL;
+    memset(&this_data->var_list, 0, sizeof(this_data->var_list));
 
     this_data->next = NULL;
 }
@@ -133,10 +136,7 @@ void dg_read_trigger(FILE *fp, void *proto, int type)
 {
   char line[READ_SIZE];
   char junk[8];
-  int vnum, rnum, count;
-  char_data *mob;
-  room_data *room;
-  struct trig_proto_list *trg_proto, *new_trg;
+  int vnum, count;
 
   get_line(fp, line);
   count = sscanf(line,"%7s %d",junk,&vnum);
@@ -147,6 +147,23 @@ void dg_read_trigger(FILE *fp, void *proto, int type)
     return;
   }
 
+  /* A room being parsed on a boot worker; it is attached once the room is
+   * in world[]. */
+  if (type == WLD_TRIGGER && bootpool_defer(BOOT_EVENT_TRIGGER, vnum))
+    return;
+
+  dg_attach_trigger(proto, type, vnum);
+}
+
+/* Add trigger 'vnum' to the prototype list of a mob or room being loaded,
+ * and for a room, to its script as well. */
+void dg_attach_trigger(void *proto, int type, int vnum)
+{
+  int rnum;
+  char_data *mob;
+  room_data *room;
+  struct trig_proto_list *trg_proto, *new_trg;
+
   rnum = real_trigger(vnum);
   if (rnum == NOTHING) {
     switch(type) {
@@ -312,6 +329,8 @@ void assign_triggers(void *i, int type)
     default:
       mudlog(BRF, LVL_BUILDER, TRUE,
              "SYSERR: unknown type for assign_triggers()");
-      break;
+      return;
   }
+
+  list_random_script(i, type);
 }
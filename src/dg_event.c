@@ -25,6 +25,7 @@
 #include "constants.h"
 #include "comm.h"  /* For access to the game pulse */
 #include "mud_event.h"
+#include "mempool.h"
 
 /***************************************************************************
  * Begin mud specific event queue functions
@@ -32,6 +33,13 @@
 /* file scope variables */
 /** The mud specific queue of events. */
 static struct dg_queue *event_q;
+/** Finished events go back to event_pool for reuse. */
+static void event_release(struct event *event)
+{
+  event->event_obj = NULL;
+  event->q_el = NULL;
+  pool_free(event_pool, event);
+}
 
 
 /** Initializes the main event queue event_q.
@@ -61,7 +69,7 @@ struct event *event_create(EVENTFUNC(*func), void *event_obj, long when)
   if (when < 1) /* make sure its in the future */
     when = 1;
 
-  CREATE(new_event, struct event, 1);
+  new_event = pool_alloc(event_pool);
   new_event->func = func;
   new_event->event_obj = event_obj;
   new_event->q_el = queue_enq(event_q, new_event, when + pulse);
@@ -88,7 +96,7 @@ void event_cancel(struct event *event)
   if (event->event_obj)
       cleanup_event_obj(event);
 
-  free(event);
+  event_release(event);
 }
 
 /* The memory freeing routine tied into the mud event system */
@@ -130,7 +138,7 @@ void event_process(void)
       if (the_event->isMudEvent && the_event->event_obj != NULL)
         free_mud_event((struct mud_event_data *) the_event->event_obj);
       /* It is assumed that the_event will already have freed ->event_obj. */
-      free(the_event);
+      event_release(the_event);
     }
       
   }
@@ -172,6 +180,133 @@ int event_is_queued(struct event *event)
 /***************************************************************************
  * Begin generic (abstract) priority queue functions
  **************************************************************************/
+/* Unused q_elements, kept for reuse rather than returned to the heap. */
+static struct q_element *q_element_pool = NULL;
+
+static struct q_element *q_element_alloc(void)
+{
+  struct q_element *qe;
+
+  if ((qe = q_element_pool) != NULL)
+    q_element_pool = qe->next;
+  else
+    CREATE(qe, struct q_element, 1);
+
+  return qe;
+}
+
+static void q_element_release(struct q_element *qe)
+{
+  qe->data = NULL;
+  qe->slot = NULL;
+  qe->prev = NULL;
+  qe->next = q_element_pool;
+  q_element_pool = qe;
+}
+
+static void slot_append(struct q_slot *slot, struct q_element *qe)
+{
+  qe->slot = slot;
+  qe->next = NULL;
+  qe->prev = slot->tail;
+
+  if (slot->tail)
+    slot->tail->next = qe;
+  else
+    slot->head = qe;
+  slot->tail = qe;
+}
+
+static void slot_remove(struct q_element *qe)
+{
+  struct q_slot *slot = qe->slot;
+
+  if (qe->prev == NULL)
+    slot->head = qe->next;
+  else
+    qe->prev->next = qe->next;
+
+  if (qe->next == NULL)
+    slot->tail = qe->prev;
+  else
+    qe->next->prev = qe->prev;
+
+  qe->slot = NULL;
+}
+
+/** Files qe in the slot that covers its key, relative to q->now. */
+static void queue_place(struct dg_queue *q, struct q_element *qe)
+{
+  long delta = qe->key - q->now;
+  int level, shift;
+
+  if (delta <= 0) {
+    slot_append(&q->due, qe);
+    return;
+  }
+
+  if (delta < WHEEL_SLOTS_0) {
+    slot_append(&q->level0[qe->key & (WHEEL_SLOTS_0 - 1)], qe);
+    return;
+  }
+
+  for (level = 1; level < WHEEL_LEVELS; level++) {
+    shift = WHEEL_BITS_0 + (level - 1) * WHEEL_BITS_N;
+    if (delta < (1L << (shift + WHEEL_BITS_N))) {
+      slot_append(&q->levels[level - 1][(qe->key >> shift) & (WHEEL_SLOTS_N - 1)], qe);
+      return;
+    }
+  }
+
+  slot_append(&q->overflow, qe);
+}
+
+/** Empties slot and files everything that was on it again. */
+static void queue_cascade(struct dg_queue *q, struct q_slot *slot)
+{
+  struct q_element *qe, *next_qe;
+
+  qe = slot->head;
+  slot->head = slot->tail = NULL;
+
+  for (; qe; qe = next_qe) {
+    next_qe = qe->next;
+    queue_place(q, qe);
+  }
+}
+
+/** Turns the wheel one pulse at a time up to the current pulse, moving
+ * elements down from coarser levels as their turn approaches and onto the
+ * due list when their key is reached. */
+static void queue_advance(struct dg_queue *q)
+{
+  struct q_slot *slot;
+  int level, shift;
+
+  while (q->now < (long) pulse) {
+    q->now++;
+
+    /* Cascade from the top down, so that an element can fall more than one
+     * level in a single step. */
+    if (!(q->now & (WHEEL_SLOTS_0 - 1))) {
+      shift = WHEEL_BITS_0 + (WHEEL_LEVELS - 1) * WHEEL_BITS_N;
+      if (!(q->now & ((1L << shift) - 1)))
+        queue_cascade(q, &q->overflow);
+
+      for (level = WHEEL_LEVELS - 1; level > 0; level--) {
+        shift = WHEEL_BITS_0 + (level - 1) * WHEEL_BITS_N;
+        if (!(q->now & ((1L << shift) - 1)))
+          queue_cascade(q, &q->levels[level - 1][(q->now >> shift) & (WHEEL_SLOTS_N - 1)]);
+      }
+    }
+
+    /* Every element in a level 0 slot shares the same key: this one. */
+    slot = &q->level0[q->now & (WHEEL_SLOTS_0 - 1)];
+    if (slot->head)
+      queue_cascade(q, slot);
+  }
+}
+
 /** Create a new, empty, priority queue and return it.
  * @retval dg_queue * Pointer to the newly created queue structure. */
 struct dg_queue *queue_init(void)
@@ -179,6 +314,7 @@ struct dg_queue *queue_init(void)
   struct dg_queue *q;
 
   CREATE(q, struct dg_queue, 1);
+  q->now = pulse;
 
   return q;
 }
@@ -195,77 +331,34 @@ struct dg_queue *queue_init(void)
  * the data. */
 struct q_element *queue_enq(struct dg_queue *q, void *data, long key)
 {
-  struct q_element *qe, *i;
-  int bucket;
+  struct q_element *qe;
 
-  CREATE(qe, struct q_element, 1);
+  qe = q_element_alloc();
   qe->data = data;
   qe->key = key;
 
-  bucket = key % NUM_EVENT_QUEUES;   /* which queue does this go in */
-
-  if (!q->head[bucket]) { /* queue is empty */
-    q->head[bucket] = qe;
-    q->tail[bucket] = qe;
-  }
-
-  else {
-    for (i = q->tail[bucket]; i; i = i->prev) {
-
-      if (i->key < key) { /* found insertion point */
-	if (i == q->tail[bucket])
-	  q->tail[bucket] = qe;
-	else {
-	  qe->next = i->next;
-	  i->next->prev = qe;
-	}
-
-	qe->prev = i;
-	i->next = qe;
-	break;
-      }
-    }
-
-    if (i == NULL) { /* insertion point is front of list */
-      qe->next = q->head[bucket];
-      q->head[bucket] = qe;
-      qe->next->prev = qe;
-    }
-  }
+  queue_place(q, qe);
 
   return qe;
 }
 
 /** Remove queue element qe from the priority queue q.
  * @pre qe->data has been dealt with in some way.
- * @post qe has been freed. 
+ * @post qe has been returned to the element pool. 
  * @param q Pointer to the queue containing qe.
  * @param qe Pointer to the q_element to remove from q.
  */
 void queue_deq(struct dg_queue *q, struct q_element *qe)
 {
-  int i;
-
   assert(qe);
 
-  i = qe->key % NUM_EVENT_QUEUES;
-
-  if (qe->prev == NULL)
-    q->head[i] = qe->next;
-  else
-    qe->prev->next = qe->next;
-
-  if (qe->next == NULL)
-    q->tail[i] = qe->prev;
-  else
-    qe->next->prev = qe->prev;
-
-  free(qe);
+  slot_remove(qe);
+  q_element_release(qe);
 }
 
 /** Removes and returns the data of the first element of the priority queue q. 
- * @pre pulse must be defined. This is a multi-headed queue, the current
- * head is determined by the current pulse.
+ * @pre pulse must be defined. The wheel is turned up to the current pulse
+ * before the head is chosen.
  * @post the q->head is dequeued. 
  * @param q The queue to return the head of.
  * @retval void * NULL if there is not a currently available head, pointer
@@ -273,32 +366,29 @@ void queue_deq(struct dg_queue *q, struct q_element *qe)
 void *queue_head(struct dg_queue *q)
 {
   void *dg_data;
-  int i;
 
-  i = pulse % NUM_EVENT_QUEUES;
+  queue_advance(q);
 
-  if (!q->head[i])
+  if (!q->due.head)
     return NULL;
 
-  dg_data = q->head[i]->data;
-  queue_deq(q, q->head[i]);
+  dg_data = q->due.head->data;
+  queue_deq(q, q->due.head);
   return dg_data;
 }
 
 /** Returns the key of the head element of the priority queue.
- * @pre pulse must be defined. This is a multi-headed queue, the current
- * head is determined by the current pulse. 
+ * @pre pulse must be defined. The wheel is turned up to the current pulse
+ * before the head is chosen.
  * @param q Queue to check for.
  * @retval long Return the key element of the head q_element. If no head
  * q_element is available, return LONG_MAX. */
 long queue_key(struct dg_queue *q)
 {
-  int i;
+  queue_advance(q);
 
-  i = pulse % NUM_EVENT_QUEUES;
-
-  if (q->head[i])
-    return q->head[i]->key;
+  if (q->due.head)
+    return q->due.head->key;
   else
     return LONG_MAX;
 }
@@ -311,6 +401,25 @@ long queue_elmt_key(struct q_element *qe)
   return qe->key;
 }
 
+/** Frees every element on one list of q, along with the events they hold. */
+static void queue_free_slot(struct q_slot *slot)
+{
+  struct q_element *qe, *next_qe;
+  struct event *event;
+
+  for (qe = slot->head; qe; qe = next_qe) {
+    next_qe = qe->next;
+    if ((event = (struct event *) qe->data) != NULL) {
+      if (event->event_obj)
+        cleanup_event_obj(event);
+
+      pool_free(event_pool, event);
+    }
+    free(qe);
+  }
+  slot->head = slot->tail = NULL;
+}
+
 /** Free q and all contents.
  * @pre Function requires definition of struct event.
  * @post All items associeated qith q, including non-abstract data, are freed.
@@ -318,26 +427,23 @@ long queue_elmt_key(struct q_element *qe)
  */
 void queue_free(struct dg_queue *q)
 {
-  int i;
-  struct q_element *qe, *next_qe;
-  struct event *event;
+  struct q_element *qe;
+  int i, level;
 
-  for (i = 0; i < NUM_EVENT_QUEUES; i++)
-  {
-    for (qe = q->head[i]; qe; qe = next_qe) 
-    {
-      next_qe = qe->next;
-      if ((event = (struct event *) qe->data) != NULL) 
-      {
-        if (event->event_obj)
-          cleanup_event_obj(event);
+  for (i = 0; i < WHEEL_SLOTS_0; i++)
+    queue_free_slot(&q->level0[i]);
 
-        free(event);
-      }
-      free(qe);
-    }
+  for (level = 0; level < WHEEL_LEVELS - 1; level++)
+    for (i = 0; i < WHEEL_SLOTS_N; i++)
+      queue_free_slot(&q->levels[level][i]);
+
+  queue_free_slot(&q->overflow);
+  queue_free_slot(&q->due);
+
+  while ((qe = q_element_pool) != NULL) {
+    q_element_pool = qe->next;
+    free(qe);
   }
 
   free(q);
 }
-
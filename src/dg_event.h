@@ -42,19 +42,40 @@ struct event {
 /**************************************************************************
  * Begin priority queue structures and defines.
  **************************************************************************/
-/** Number of buckets available in each queue. Reduces enqueue cost. */
-#define NUM_EVENT_QUEUES    10
+/* The queue is a hierarchical timing wheel.  Level 0 has one slot per pulse;
+ * each higher level has one slot per full turn of the level beneath it.
+ * Anything further out than the top level can reach waits on an overflow
+ * list.  Enqueue and dequeue are O(1); elements move down a level at most
+ * WHEEL_LEVELS times before they fire. */
+/** Bits of the key indexed by level 0. */
+#define WHEEL_BITS_0        8
+/** Bits of the key indexed by each higher level. */
+#define WHEEL_BITS_N        6
+/** Number of levels, including level 0. With the above: 2^26 pulses. */
+#define WHEEL_LEVELS        4
+#define WHEEL_SLOTS_0       (1 << WHEEL_BITS_0)
+#define WHEEL_SLOTS_N       (1 << WHEEL_BITS_N)
+
+/** A FIFO list of queued elements. */
+struct q_slot {
+  struct q_element *head; /**< Front of the list. */
+  struct q_element *tail; /**< Rear of the list. */
+};
 
 /** The priority queue. */
 struct dg_queue {
-  struct q_element *head[NUM_EVENT_QUEUES]; /**< Front of each queue bucket. */
-  struct q_element *tail[NUM_EVENT_QUEUES]; /**< Rear of each queue bucket. */
+  struct q_slot level0[WHEEL_SLOTS_0];  /**< One slot per pulse. */
+  struct q_slot levels[WHEEL_LEVELS - 1][WHEEL_SLOTS_N]; /**< Coarser slots. */
+  struct q_slot overflow; /**< Beyond the reach of the top level. */
+  struct q_slot due;      /**< Elements whose key has been reached. */
+  long now;               /**< The pulse the wheel has been turned to. */
 };
 
 /** Queued elements. */
 struct q_element {
   void *data;  /**< The event to be handled. */
   long key;    /**< When the event should be handled. */
+  struct q_slot *slot;           /**< The list this element is on. */
   struct q_element *prev, *next; /**< Points to other q_elements in line. */
 };
 /**************************************************************************
@@ -35,38 +35,53 @@ void free_var_el(struct trig_var_data *var)
 }
 
 /* release memory allocated for a variable list */
-void free_varlist(struct trig_var_data *vd)
+void free_varlist(struct trig_var_scope *scope)
 {
     struct trig_var_data *i, *j;
 
-    for (i = vd; i;) {
+    for (i = scope->list; i;) {
 	j = i;
 	i = i->next;
 	free_var_el(j);
     }
+    if (scope->index)
+      free(scope->index);
+    memset(scope, 0, sizeof(*scope));
+}
+
+/* Unlinks vd from scope without freeing it. */
+void delete_var(struct trig_var_scope *scope, struct trig_var_data *vd)
+{
+  struct trig_var_data **link;
+
+  if (vd->prev)
+    vd->prev->next = vd->next;
+  else
+    scope->list = vd->next;
+  if (vd->next)
+    vd->next->prev = vd->prev;
+
+  if (scope->index) {
+    for (link = &scope->index[vd->hash & (scope->index_size - 1)]; *link != vd;
+         link = &(*link)->next_hash);
+    *link = vd->next_hash;
+  }
+
+  vd->next = vd->prev = vd->next_hash = NULL;
+  scope->count--;
 }
 
 /* Remove var name from var_list. Returns 1 if found, else 0. */
-int remove_var(struct trig_var_data **var_list, char *name)
+int remove_var(struct trig_var_scope *scope, char *name)
 {
-  struct trig_var_data *i, *j;
-
-  for (j = NULL, i = *var_list; i && str_cmp(name, i->name);
-       j = i, i = i->next);
-
-  if (i) {
-    if (j) {
-      j->next = i->next;
-      free_var_el(i);
-    } else {
-      *var_list = i->next;
-      free_var_el(i);
-    }
+  struct trig_var_data *vd;
 
-    return 1;
-  }
+  if (!(vd = find_var(scope, name)))
+    return 0;
 
-  return 0;
+  delete_var(scope, vd);
+  free_var_el(vd);
+  return 1;
 }
 
 /* Return memory used by a trigger. The command list is free'd when changed and
@@ -80,10 +95,7 @@ void free_trigger(struct trig_data *trig)
       free(trig->arglist);
       trig->arglist = NULL;
     }
-    if (trig->var_list) {
-      free_varlist(trig->var_list);
-      trig->var_list = NULL;
-    }
+    free_varlist(&trig->var_list);
     if (GET_TRIG_WAIT(trig))
       event_cancel(GET_TRIG_WAIT(trig));
 
@@ -152,6 +164,8 @@ void extract_script(void *thing, int type)
     }
   }
 #endif
+  unlist_random_script(sc, type);
+
   for (trig = TRIGGERS(sc); trig; trig = next_trig) {
     next_trig = trig->next;
     extract_trigger(trig);
@@ -159,7 +173,7 @@ void extract_script(void *thing, int type)
   TRIGGERS(sc) = NULL;
 
   /* Thanks to James Long for tracking down this memory leak */
-  free_varlist(sc->global_vars);
+  free_varlist(&sc->global_vars);
 
   free(sc);
 }
@@ -21,6 +21,7 @@
 #include "spells.h"
 #include "constants.h"
 #include "fight.h"
+#include "keyword.h"
 
 
 /* copied from spell_parser.c: */
@@ -137,6 +138,7 @@ void do_dg_cast(void *go, struct script_data *sc, trig_data *trig, int type, cha
     caster->next_in_room = caster_room->people;
     caster_room->people = caster;
     caster->in_room = real_room(caster_room->number);
+    keyword_people_add(caster);
     call_magic(caster, tch, tobj, spellnum, DG_SPELL_LEVEL, CAST_SPELL);
     extract_char(caster);
   } else
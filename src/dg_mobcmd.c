@@ -22,6 +22,8 @@
 #include "genzon.h" /* for real_zone_by_thing */
 #include "act.h"
 #include "fight.h"
+#include "graph.h"
+#include "keyword.h"
 
 
 /* Local file scope functions. */
@@ -977,6 +979,7 @@ ACMD(do_mtransform)
     FIGHTING(&tmpmob) = FIGHTING(ch);
     HUNTING(&tmpmob) = HUNTING(ch);
     memcpy(ch, &tmpmob, sizeof(*ch));
+    keyword_char_renamed(ch);
 
     for (pos = 0; pos < NUM_WEARS; pos++) {
       if (obj[pos])
@@ -1039,6 +1042,7 @@ ACMD(do_mdoor)
     }
 
     newexit = rm->dir_option[dir];
+    graph_changed();
 
     /* purge exit */
     if (fd == 0) {
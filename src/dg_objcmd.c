@@ -20,6 +20,8 @@
 #include "constants.h"
 #include "genzon.h" /* for access to real_zone_by_thing */
 #include "fight.h" /* for die() */
+#include "graph.h"
+#include "keyword.h"
 
 
 
@@ -336,6 +338,7 @@ static OCMD(do_otransform)
     tmpobj.next_content = obj->next_content;
     tmpobj.next = obj->next;
     memcpy(obj, &tmpobj, sizeof(*obj));
+    keyword_obj_renamed(obj);
 
     if (wearer) {
       equip_char(wearer, obj, pos);
@@ -640,6 +643,7 @@ static OCMD(do_odoor)
     }
 
     newexit = rm->dir_option[dir];
+    graph_changed();
 
     /* purge exit */
     if (fd == 0) {
@@ -21,6 +21,7 @@
 #include "genzon.h"      /* for real_zone_by_thing */
 #include "constants.h"   /* for the *trig_types */
 #include "modify.h"      /* for smash_tilde */
+#include "keyword.h"
 
 
 /* local functions */
@@ -636,6 +637,8 @@ void trigedit_save(struct descriptor_data *d)
   char bitBuf[MAX_INPUT_LENGTH];
   char fname[MAX_INPUT_LENGTH];
 
+  keyword_protos_changed(KW_TRIGGERS);
+
   if ((rnum = real_trigger(OLC_NUM(d))) != NOTHING) {
     proto = trig_index[rnum]->proto;
     for (cmd = proto->cmdlist; cmd; cmd = next_cmd) {
@@ -669,6 +672,8 @@ void trigedit_save(struct descriptor_data *d)
     } else
       trig->cmdlist->cmd = strdup("* No Script");
 
+    compile_trigger(trig);
+
     /* make the prorotype look like what we have */
     trig_data_copy(proto, trig);
 
@@ -696,10 +701,7 @@ void trigedit_save(struct descriptor_data *d)
           event_cancel(GET_TRIG_WAIT(live_trig));
           GET_TRIG_WAIT(live_trig)=NULL;
         }
-        if (live_trig->var_list) {
-          free_varlist(live_trig->var_list);
-          live_trig->var_list=NULL;
-        }
+        free_varlist(&live_trig->var_list);
 
         live_trig->cmdlist = proto->cmdlist;
         live_trig->curr_state = live_trig->cmdlist;
@@ -782,6 +784,8 @@ void trigedit_save(struct descriptor_data *d)
     trig_index = new_index;
     top_of_trigt++;
 
+    compile_trigger(trig);
+
     /* HERE IT HAS TO GO THROUGH AND FIX ALL SCRIPTS/TRIGS OF HIGHER RNUM */
     for (live_trig = trigger_list; live_trig; live_trig = live_trig->next_in_world)
       GET_TRIG_RNUM(live_trig) += (GET_TRIG_RNUM(live_trig) != NOTHING && GET_TRIG_RNUM(live_trig) > rnum);
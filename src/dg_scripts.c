@@ -71,6 +71,11 @@ static void dg_letter_value(struct script_data *sc, trig_data *trig, char *cmd);
 static struct cmdlist_element * find_case(struct trig_data *trig, struct cmdlist_element *cl,
           void *go, struct script_data *sc, int type, char *cond);
 static struct cmdlist_element *find_done(struct cmdlist_element *cl);
+static struct cmdlist_element *scan_else(trig_data *trig, struct cmdlist_element *cl);
+static struct cmdlist_element *scan_case(struct cmdlist_element *cl);
+static int test_line(struct cmdlist_element *cl, void *go, struct script_data *sc,
+          trig_data *trig, int type);
+static byte command_op(char *cmd, int fixed);
 static struct char_data *find_char_by_uid_in_lookup_table(long uid);
 static struct obj_data *find_obj_by_uid_in_lookup_table(long uid);
 static EVENTFUNC(trig_wait_event);
@@ -621,46 +626,109 @@ obj_data *get_obj_by_room(room_data *room, char *name)
   return NULL;
 }
 
+/* Every mob, object and room with a random trigger has its script linked on
+ * random_scripts[type], so script_trigger_check() need not walk the whole
+ * character list, object list and world.  Whatever attaches triggers to a
+ * live thing calls list_random_script(); extract_script() unlinks, and a
+ * script that has lost its random trigger is dropped on the next pass.
+ * Rooms are listed by address, so relist_random_rooms() must follow any
+ * reshuffle of world[]. */
+static struct script_data *random_scripts[WLD_TRIGGER + 1];
+static struct script_data *random_next = NULL; /* next to visit in a pass */
+
+void list_random_script(void *go, int type)
+{
+  struct script_data *sc = NULL;
+
+  switch (type) {
+    case MOB_TRIGGER: sc = SCRIPT((char_data *) go); break;
+    case OBJ_TRIGGER: sc = SCRIPT((obj_data *) go); break;
+    case WLD_TRIGGER: sc = SCRIPT((room_data *) go); break;
+  }
+
+  /* The random bit is the same for all three types. */
+  if (!sc || sc->random_owner || !IS_SET(SCRIPT_TYPES(sc), WTRIG_RANDOM))
+    return;
+
+  sc->random_owner = go;
+  sc->prev_random = NULL;
+  sc->next_random = random_scripts[type];
+  if (sc->next_random)
+    sc->next_random->prev_random = sc;
+  random_scripts[type] = sc;
+}
+
+void unlist_random_script(struct script_data *sc, int type)
+{
+  if (!sc->random_owner)
+    return;
+
+  if (random_next == sc)
+    random_next = sc->next_random;
+
+  if (sc->prev_random)
+    sc->prev_random->next_random = sc->next_random;
+  else
+    random_scripts[type] = sc->next_random;
+  if (sc->next_random)
+    sc->next_random->prev_random = sc->prev_random;
+
+  sc->random_owner = NULL;
+  sc->next_random = sc->prev_random = NULL;
+}
+
+void relist_random_rooms(void)
+{
+  room_rnum nr;
+
+  while (random_scripts[WLD_TRIGGER])
+    unlist_random_script(random_scripts[WLD_TRIGGER], WLD_TRIGGER);
+
+  for (nr = 0; nr <= top_of_world; nr++)
+    list_random_script(&world[nr], WLD_TRIGGER);
+}
+
 /* checks every PULSE_SCRIPT for random triggers */
 void script_trigger_check(void)
 {
   char_data *ch;
   obj_data *obj;
-  struct room_data *room=NULL;
-  room_rnum nr;
+  struct room_data *room;
   struct script_data *sc;
 
-  for (ch = character_list; ch; ch = ch->next) {
-    if (SCRIPT(ch)) {
-      sc = SCRIPT(ch);
+  /* random_next is kept valid if a trigger purges what comes next. */
+  for (sc = random_scripts[MOB_TRIGGER]; sc; sc = random_next) {
+    random_next = sc->next_random;
+    ch = (char_data *) sc->random_owner;
 
-      if (IS_SET(SCRIPT_TYPES(sc), WTRIG_RANDOM) &&
-          (!is_empty(world[IN_ROOM(ch)].zone) ||
-           IS_SET(SCRIPT_TYPES(sc), WTRIG_GLOBAL)))
-        random_mtrigger(ch);
-    }
+    if (!IS_SET(SCRIPT_TYPES(sc), MTRIG_RANDOM))
+      unlist_random_script(sc, MOB_TRIGGER);
+    else if (IN_ROOM(ch) != NOWHERE &&
+        (!is_empty(world[IN_ROOM(ch)].zone) ||
+         IS_SET(SCRIPT_TYPES(sc), MTRIG_GLOBAL)))
+      random_mtrigger(ch);
   }
 
-  for (obj = object_list; obj; obj = obj->next) {
-    if (SCRIPT(obj)) {
-      sc = SCRIPT(obj);
+  for (sc = random_scripts[OBJ_TRIGGER]; sc; sc = random_next) {
+    random_next = sc->next_random;
+    obj = (obj_data *) sc->random_owner;
 
-      if (IS_SET(SCRIPT_TYPES(sc), OTRIG_RANDOM))
-        random_otrigger(obj);
-    }
+    if (!IS_SET(SCRIPT_TYPES(sc), OTRIG_RANDOM))
+      unlist_random_script(sc, OBJ_TRIGGER);
+    else
+      random_otrigger(obj);
   }
 
-  for (nr = 0; nr <= top_of_world; nr++) {
-    if (SCRIPT(&world[nr])) {
-      room = &world[nr];
-      sc = SCRIPT(room);
+  for (sc = random_scripts[WLD_TRIGGER]; sc; sc = random_next) {
+    random_next = sc->next_random;
+    room = (struct room_data *) sc->random_owner;
 
-      if (IS_SET(SCRIPT_TYPES(sc), WTRIG_RANDOM) &&
-          (!is_empty(room->zone) ||
-           IS_SET(SCRIPT_TYPES(sc), WTRIG_GLOBAL)))
-        random_wtrigger(room);
-    }
+    if (!IS_SET(SCRIPT_TYPES(sc), WTRIG_RANDOM))
+      unlist_random_script(sc, WLD_TRIGGER);
+    else if (!is_empty(room->zone) || IS_SET(SCRIPT_TYPES(sc), WTRIG_GLOBAL))
+      random_wtrigger(room);
   }
+  random_next = NULL;
 }
 
 void check_time_triggers(void)
@@ -827,10 +895,10 @@ static void script_stat (char_data *ch, struct script_data *sc)
   char namebuf[512];
   char buf1[MAX_STRING_LENGTH];
 
-  send_to_char(ch, "Global Variables: %s\r\n", sc->global_vars ? "" : "None");
+  send_to_char(ch, "Global Variables: %s\r\n", sc->global_vars.list ? "" : "None");
   send_to_char(ch, "Global context: %ld\r\n", sc->context);
 
-  for (tv = sc->global_vars; tv; tv = tv->next) {
+  for (tv = sc->global_vars.list; tv; tv = tv->next) {
     snprintf(namebuf, sizeof(namebuf), "%s:%ld", tv->name, tv->context);
     if (*(tv->value) == UID_CHAR) {
       find_uid_name(tv->value, name, sizeof(name));
@@ -865,9 +933,9 @@ static void script_stat (char_data *ch, struct script_data *sc)
       send_to_char(ch, "    Wait: %ld, Current line: %s\r\n",
               event_time(GET_TRIG_WAIT(t)),
               t->curr_state ? t->curr_state->cmd : "End of Script");
-      send_to_char(ch, "  Variables: %s\r\n", GET_TRIG_VARS(t) ? "" : "None");
+      send_to_char(ch, "  Variables: %s\r\n", GET_TRIG_VARS(t).list ? "" : "None");
 
-      for (tv = GET_TRIG_VARS(t); tv; tv = tv->next) {
+      for (tv = GET_TRIG_VARS(t).list; tv; tv = tv->next) {
         if (*(tv->value) == UID_CHAR) {
           find_uid_name(tv->value, name, sizeof(name));
           send_to_char(ch, "    %15s:  %s\r\n", tv->name, name);
@@ -989,6 +1057,7 @@ ACMD(do_attach)
     if (!SCRIPT(victim))
       CREATE(SCRIPT(victim), struct script_data, 1);
     add_trigger(SCRIPT(victim), trig, loc);
+    list_random_script(victim, MOB_TRIGGER);
 
     if (IS_NPC(victim))
     send_to_char(ch, "Trigger %d (%s) attached to %s [%d].\r\n",
@@ -1031,6 +1100,7 @@ ACMD(do_attach)
     if (!SCRIPT(object))
       CREATE(SCRIPT(object), struct script_data, 1);
     add_trigger(SCRIPT(object), trig, loc);
+    list_random_script(object, OBJ_TRIGGER);
 
     send_to_char(ch, "Trigger %d (%s) attached to %s [%d].\r\n",
                  tn, GET_TRIG_NAME(trig),
@@ -1068,6 +1138,7 @@ ACMD(do_attach)
     if (!SCRIPT(room))
       CREATE(SCRIPT(room), struct script_data, 1);
     add_trigger(SCRIPT(room), trig, loc);
+    list_random_script(room, WLD_TRIGGER);
 
     send_to_char(ch, "Trigger %d (%s) attached to room %d.\r\n",
                  tn, GET_TRIG_NAME(trig), world[rnum].number);
@@ -1607,6 +1678,16 @@ static int process_if(char *cond, void *go, struct script_data *sc,
     return 1;
 }
 
+/* compile_trigger() may scan a broken block more than once; say so once. */
+static int missing_end;
+
+static void log_missing_end(trig_data *trig, int error)
+{
+  if (!missing_end++)
+    script_log("Trigger VNum %d has 'if' without 'end'. (error %d)",
+               GET_TRIG_VNUM(trig), error);
+}
+
 /* Scans for end of if-block.  returns the line containg 'end', or the last
  * line of the trigger if not found. */
 static struct cmdlist_element *find_end(trig_data *trig, struct cmdlist_element *cl)
@@ -1615,7 +1696,7 @@ static struct cmdlist_element *find_end(trig_data *trig, struct cmdlist_element
   char *p;
 
   if (!(cl->next)) { /* rryan: if this is the last line, theres no end */
-    script_log("Trigger VNum %d has 'if' without 'end'. (error 1)", GET_TRIG_VNUM(trig));
+    log_missing_end(trig, 1);
     return cl;
   }
 
@@ -1629,20 +1710,38 @@ static struct cmdlist_element *find_end(trig_data *trig, struct cmdlist_element
 
     /* thanks to Russell Ryan for this fix */
     if(!c->next) { /* rryan: this is the last line, we didn't find an end. */
-      script_log("Trigger VNum %d has 'if' without 'end'. (error 2)", GET_TRIG_VNUM(trig));
+      log_missing_end(trig, 2);
       return c;
     }
   }
 
   /* rryan: we didn't find an end */
-  script_log("Trigger VNum %d has 'if' without 'end'. (error 3)", GET_TRIG_VNUM(trig));
+  log_missing_end(trig, 3);
   return c;
 }
 
 /* Searches for valid elseif, else, or end to continue execution at. Returns 
- * line of elseif, else, or end if found, or last line of trigger. */
+ * line of elseif, else, or end if found, or last line of trigger.  The
+ * candidates were chained together by compile_trigger(). */
 static struct cmdlist_element *find_else_end(trig_data *trig,
     struct cmdlist_element *cl, void *go, struct script_data *sc, int type)
+{
+  struct cmdlist_element *c;
+
+  for (c = cl->chain; c->next; c = c->chain) {
+    if (c->stop == DG_STOP_TEST && !test_line(c, go, sc, trig, type))
+      continue;
+    if (c->stop != DG_STOP_END)
+      GET_TRIG_DEPTH(trig)++;
+    return c;
+  }
+
+  return c;
+}
+
+/* The compile-time half of find_else_end(): the next elseif, else or end
+ * after cl at this nesting level, or the last line of the trigger. */
+static struct cmdlist_element *scan_else(trig_data *trig, struct cmdlist_element *cl)
 {
   struct cmdlist_element *c;
   char *p;
@@ -1650,30 +1749,17 @@ static struct cmdlist_element *find_else_end(trig_data *trig,
   if (!(cl->next))
     return cl;
 
-  for (c = cl->next;c->next; c = c->next) {
+  for (c = cl->next; c->next; c = c->next) {
     for (p = c->cmd; *p && isspace(*p); p++); /* skip spaces */
 
     if (!strn_cmp("if ", p, 3))
       c = find_end(trig, c);
-
-    else if (!strn_cmp("elseif ", p, 7)) {
-      if (process_if(p + 7, go, sc, trig, type)) {
-        GET_TRIG_DEPTH(trig)++;
-        return c;
-      }
-    }
-
-    else if (!strn_cmp("else", p, 4)) {
-      GET_TRIG_DEPTH(trig)++;
-      return c;
-    }
-
-    else if (!strn_cmp("end", p, 3))
+    else if (!strn_cmp("else", p, 4) || !strn_cmp("end", p, 3))
       return c;
 
     /* thanks to Russell Ryan for this fix */
     if(!c->next) { /* rryan: this is the last line, return. */
-      script_log("Trigger VNum %d has 'if' without 'end'. (error 4)", GET_TRIG_VNUM(trig));
+      log_missing_end(trig, 4);
       return c;
     }
   }
@@ -1681,10 +1767,186 @@ static struct cmdlist_element *find_else_end(trig_data *trig,
   /* rryan: if we got here, it's the last line, if its not an end, log it. */
   for (p = c->cmd; *p && isspace(*p); p++); /* skip spaces */
   if(strn_cmp("end", p, 3))
-    script_log("Trigger VNum %d has 'if' without 'end'. (error 5)", GET_TRIG_VNUM(trig));
+    log_missing_end(trig, 5);
+  return c;
+}
+
+/* The compile-time half of find_case(): the next case, default or done after
+ * cl at this nesting level, or the last line of the trigger. */
+static struct cmdlist_element *scan_case(struct cmdlist_element *cl)
+{
+  struct cmdlist_element *c, *done;
+  char *p;
+
+  if (!(cl->next))
+    return cl;
+
+  for (c = cl->next; c->next; c = c->next) {
+    for (p = c->cmd; *p && isspace(*p); p++);
+
+    if (!strn_cmp("while ", p, 6) || !strn_cmp("switch", p, 6)) {
+      /* a nested block running off the end leaves nothing to search */
+      if (!(done = find_done(c)) || !done->next) {
+        while (c->next)
+          c = c->next;
+        return c;
+      }
+      c = done;
+    } else if (!strn_cmp("case ", p, 5) || !strn_cmp("default", p, 7) ||
+               !strn_cmp("done", p, 3))
+      return c;
+  }
   return c;
 }
 
+/* Keywords of the commands script_driver() handles itself, in the order it
+ * tries them.  Anything else goes to the command interpreter. */
+static const struct {
+  const char *word;
+  byte op;
+} dg_commands[] = {
+  { "eval "      , DG_OP_EVAL },
+  { "nop "       , DG_OP_NOP },
+  { "extract "   , DG_OP_EXTRACT },
+  { "dg_letter " , DG_OP_LETTER },
+  { "makeuid "   , DG_OP_MAKEUID },
+  { "halt"       , DG_OP_HALT },
+  { "dg_cast "   , DG_OP_CAST },
+  { "dg_affect " , DG_OP_AFFECT },
+  { "global "    , DG_OP_GLOBAL },
+  { "context "   , DG_OP_CONTEXT },
+  { "remote "    , DG_OP_REMOTE },
+  { "rdelete "   , DG_OP_RDELETE },
+  { "return "    , DG_OP_RETURN },
+  { "set "       , DG_OP_SET },
+  { "unset "     , DG_OP_UNSET },
+  { "wait "      , DG_OP_WAIT },
+  { "attach "    , DG_OP_ATTACH },
+  { "detach "    , DG_OP_DETACH },
+  { "\n"         , DG_OP_COMMAND }
+};
+
+/* Classifies a command line.  Only the first 'fixed' characters of cmd are
+ * final (the rest waits on variable substitution), or all of them if fixed
+ * is -1; returns DG_OP_SUBST if that is not enough to tell. */
+static byte command_op(char *cmd, int fixed)
+{
+  int i, len;
+
+  for (i = 0; *dg_commands[i].word != '\n'; i++) {
+    len = strlen(dg_commands[i].word);
+
+    if (fixed >= 0 && fixed < len) {
+      if (!strn_cmp(cmd, dg_commands[i].word, fixed))
+        return DG_OP_SUBST;
+    } else if (!strn_cmp(cmd, dg_commands[i].word, len))
+      return dg_commands[i].op;
+  }
+
+  return DG_OP_COMMAND;
+}
+
+/* returns 1 if the condition on an if, elseif or while line holds */
+static int test_line(struct cmdlist_element *cl, void *go, struct script_data *sc,
+               trig_data *trig, int type)
+{
+  if (cl->cond != DG_COND_VARIES)
+    return (cl->cond == DG_COND_TRUE);
+
+  return process_if(cl->arg, go, sc, trig, type);
+}
+
+/* Works out once what script_driver() would otherwise rediscover from the
+ * text on every run: what each line does, where its condition starts, which
+ * line closes its block and, for if and switch, the chain of elseif/else or
+ * case lines to try.  Conditions without variables are evaluated here and
+ * remembered.  Triggers share their prototype's command list, so this is
+ * done when the prototype is loaded or saved from trigedit. */
+void compile_trigger(trig_data *trig)
+{
+  struct cmdlist_element *cl;
+  char *p;
+
+  missing_end = 0;
+
+  for (cl = trig->cmdlist; cl; cl = cl->next) {
+    for (p = cl->cmd; *p && isspace(*p); p++);
+
+    cl->text = cl->arg = p;
+    cl->jump = cl->chain = NULL;
+    cl->stop = DG_STOP_NONE;
+    cl->cond = DG_COND_VARIES;
+
+    if (*p == '*')
+      cl->op = DG_OP_COMMENT;
+    else if (!strn_cmp(p, "if ", 3)) {
+      cl->op = DG_OP_IF;
+      cl->arg = p + 3;
+    } else if (!strn_cmp("elseif ", p, 7)) {
+      cl->op = DG_OP_ELSE;
+      cl->stop = DG_STOP_TEST;
+      cl->arg = p + 7;
+    } else if (!strn_cmp("else", p, 4)) {
+      cl->op = DG_OP_ELSE;
+      cl->stop = DG_STOP_ENTER;
+    } else if (!strn_cmp("while ", p, 6)) {
+      cl->op = DG_OP_WHILE;
+      cl->arg = p + 6;
+    } else if (!strn_cmp("switch ", p, 7)) {
+      cl->op = DG_OP_SWITCH;
+      cl->arg = p + 7;
+    } else if (!strn_cmp("end", p, 3)) {
+      cl->op = DG_OP_END;
+      cl->stop = DG_STOP_END;
+    } else if (!strn_cmp("done", p, 4))
+      cl->op = DG_OP_DONE;
+    else if (!strn_cmp("break", p, 5))
+      cl->op = DG_OP_BREAK;
+    else if (!strn_cmp("case", p, 4))
+      cl->op = DG_OP_CASE;
+    else
+      cl->op = command_op(p, strchr(p, '%') ? strchr(p, '%') - p : -1);
+
+    /* stops for find_case(); none of these can also be an else stop */
+    if (!strn_cmp("case ", p, 5)) {
+      cl->stop = DG_STOP_TEST;
+      cl->arg = p + 5;
+    } else if (!strn_cmp("default", p, 7))
+      cl->stop = DG_STOP_ENTER;
+    else if (!strn_cmp("done", p, 3))
+      cl->stop = DG_STOP_END;
+  }
+
+  for (cl = trig->cmdlist; cl; cl = cl->next) {
+    switch (cl->op) {
+      case DG_OP_IF:
+        cl->chain = scan_else(trig, cl);
+        break;
+      case DG_OP_ELSE:
+        if (cl->stop == DG_STOP_TEST)
+          cl->chain = scan_else(trig, cl);
+        cl->jump = find_end(trig, cl);
+        break;
+      case DG_OP_WHILE:
+      case DG_OP_BREAK:
+        cl->jump = find_done(cl);
+        break;
+      case DG_OP_SWITCH:
+        cl->chain = scan_case(cl);
+        break;
+      case DG_OP_CASE:
+        if (cl->stop == DG_STOP_TEST)
+          cl->chain = scan_case(cl);
+        break;
+    }
+
+    if ((cl->op == DG_OP_IF || cl->op == DG_OP_WHILE ||
+         (cl->op == DG_OP_ELSE && cl->stop == DG_STOP_TEST)) && !strchr(cl->arg, '%'))
+      cl->cond = process_if(cl->arg, NULL, NULL, trig, WLD_TRIGGER) ?
+                 DG_COND_TRUE : DG_COND_FALSE;
+  }
+}
+
 /* processes any 'wait' commands in a trigger */
 static void process_wait(void *go, trig_data *trig, int type, char *cmd,
                   struct cmdlist_element *cl)
@@ -1847,6 +2109,7 @@ static void process_attach(void *go, struct script_data *sc, trig_data *trig,
     if (!SCRIPT(c))
       CREATE(SCRIPT(c), struct script_data, 1);
     add_trigger(SCRIPT(c), newtrig, -1);
+    list_random_script(c, MOB_TRIGGER);
     return;
   }
 
@@ -1854,6 +2117,7 @@ static void process_attach(void *go, struct script_data *sc, trig_data *trig,
     if (!SCRIPT(o))
       CREATE(SCRIPT(o), struct script_data, 1);
     add_trigger(SCRIPT(o), newtrig, -1);
+    list_random_script(o, OBJ_TRIGGER);
     return;
   }
 
@@ -1861,6 +2125,7 @@ static void process_attach(void *go, struct script_data *sc, trig_data *trig,
     if (!SCRIPT(r))
       CREATE(SCRIPT(r), struct script_data, 1);
     add_trigger(SCRIPT(r), newtrig, -1);
+    list_random_script(r, WLD_TRIGGER);
     return;
   }
 }
@@ -2126,15 +2391,10 @@ static void process_remote(struct script_data *sc, trig_data *trig, char *cmd)
   }
 
   /* find the locally owned variable */
-  for (vd = GET_TRIG_VARS(trig); vd; vd = vd->next)
-    if (!str_cmp(vd->name, buf))
-      break;
+  vd = find_var(&GET_TRIG_VARS(trig), buf);
 
   if (!vd)
-    for (vd = sc->global_vars; vd; vd = vd->next)
-      if (!str_cmp(vd->name, var) &&
-          (vd->context==0 || vd->context==sc->context))
-        break;
+    vd = find_var_context(&sc->global_vars, var, sc->context);
 
   if (!vd) {
     script_log("Trigger: %s, VNum %d. local var '%s' not found in remote call",
@@ -2175,7 +2435,7 @@ static void process_remote(struct script_data *sc, trig_data *trig, char *cmd)
  * was to delete rooms. */
 ACMD(do_vdelete)
 {
-  struct trig_var_data *vd, *vd_prev=NULL;
+  struct trig_var_data *vd;
   struct script_data *sc_remote=NULL;
   char *var, *uid_p;
   char buf[MAX_INPUT_LENGTH], buf2[MAX_INPUT_LENGTH];
@@ -2219,42 +2479,26 @@ ACMD(do_vdelete)
     return;
   }
 
-  if (sc_remote->global_vars==NULL) {
+  if (sc_remote->global_vars.list==NULL) {
     send_to_char(ch, "That id represents no global variables.(2)\r\n");
     return;
   }
 
   if (*var == '*' || is_abbrev(var, "all")) {
-    struct trig_var_data *vd_next;
-    for (vd = sc_remote->global_vars; vd; vd = vd_next) {
-      vd_next = vd->next;
-      free(vd->value);
-      free(vd->name);
-      free(vd);
-    }
-    sc_remote->global_vars = NULL;
+    free_varlist(&sc_remote->global_vars);
     send_to_char(ch, "All variables deleted from that id.\r\n");
     return;
   }
 
   /* find the global */
-  for (vd = sc_remote->global_vars; vd; vd_prev = vd, vd = vd->next)
-    if (!str_cmp(vd->name, var))
-      break;
-
-  if (!vd) {
+  if (!(vd = find_var(&sc_remote->global_vars, var))) {
     send_to_char(ch, "That variable cannot be located.\r\n");
     return;
   }
 
-  /* ok, delete the variable */
-  if (vd_prev) vd_prev->next = vd->next;
-  else sc_remote->global_vars = vd->next;
-
-  /* and free up the space */
-  free(vd->value);
-  free(vd->name);
-  free(vd);
+  /* ok, delete the variable and free up the space */
+  delete_var(&sc_remote->global_vars, vd);
+  free_var_el(vd);
 
   send_to_char(ch, "Deleted.\r\n");
 }
@@ -2282,7 +2526,7 @@ int perform_set_dg_var(struct char_data *ch, struct char_data *vict, char *val_a
  * 'rdelete <variable_name> <uid>' */
 static void process_rdelete(struct script_data *sc, trig_data *trig, char *cmd)
 {
-  struct trig_var_data *vd, *vd_prev=NULL;
+  struct trig_var_data *vd;
   struct script_data *sc_remote=NULL;
   char *line, *var, *uid_p;
   char arg[MAX_INPUT_LENGTH], buf[MAX_STRING_LENGTH], buf2[MAX_STRING_LENGTH];
@@ -2325,24 +2569,16 @@ static void process_rdelete(struct script_data *sc, trig_data *trig, char *cmd)
   }
 
   if (sc_remote==NULL) return; /* no script to delete a trigger from */
-  if (sc_remote->global_vars==NULL) return; /* no script globals */
+  if (sc_remote->global_vars.list==NULL) return; /* no script globals */
 
   /* find the global */
-  for (vd = sc_remote->global_vars; vd; vd_prev = vd, vd = vd->next)
-    if (!str_cmp(vd->name, var) &&
-        (vd->context==0 || vd->context==sc->context))
-      break;
+  vd = find_var_context(&sc_remote->global_vars, var, sc->context);
 
   if (!vd) return; /* the variable doesn't exist, or is the wrong context */
 
-  /* ok, delete the variable */
-  if (vd_prev) vd_prev->next = vd->next;
-  else sc_remote->global_vars = vd->next;
-
-  /* and free up the space */
-  free(vd->value);
-  free(vd->name);
-  free(vd);
+  /* ok, delete the variable and free up the space */
+  delete_var(&sc_remote->global_vars, vd);
+  free_var_el(vd);
 }
 
 /* Makes a local variable into a global variable. */
@@ -2361,9 +2597,7 @@ static void process_global(struct script_data *sc, trig_data *trig, char *cmd, l
     return;
   }
 
-  for (vd = GET_TRIG_VARS(trig); vd; vd = vd->next)
-    if (!str_cmp(vd->name, var))
-      break;
+  vd = find_var(&GET_TRIG_VARS(trig), var);
 
   if (!vd) {
     script_log("Trigger: %s, VNum %d. local var '%s' not found in global call",
@@ -2486,6 +2720,7 @@ int script_driver(void *go_adress, trig_data *trig, int type, int mode)
   char cmd[MAX_INPUT_LENGTH], *p;
   struct script_data *sc = 0;
   struct cmdlist_element *temp;
+  byte op;
   unsigned long loops = 0;
   void *go = NULL;
 
@@ -2544,46 +2779,49 @@ int script_driver(void *go_adress, trig_data *trig, int type, int mode)
 
   dg_owner_purged = 0;
 
+  /* lists built outside parse_trigger() and trigedit get compiled here */
+  if (trig->cmdlist && !trig->cmdlist->text)
+    compile_trigger(trig);
+
   for (cl = (mode == TRIG_NEW) ? trig->cmdlist : trig->curr_state;
       cl && GET_TRIG_DEPTH(trig); cl = cl->next) {
-    for (p = cl->cmd; *p && isspace(*p); p++);
+    p = cl->text;
 
-    if (*p == '*') /* comment */
+    if (cl->op == DG_OP_COMMENT)
       continue;
 
-    else if (!strn_cmp(p, "if ", 3)) {
-      if (process_if(p + 3, go, sc, trig, type))
+    else if (cl->op == DG_OP_IF) {
+      if (test_line(cl, go, sc, trig, type))
         GET_TRIG_DEPTH(trig)++;
       else
         cl = find_else_end(trig, cl, go, sc, type);
     }
 
-    else if (!strn_cmp("elseif ", p, 7) ||
-       !strn_cmp("else", p, 4)) {
+    else if (cl->op == DG_OP_ELSE) {
       /* If not in an if-block, ignore the extra 'else[if]' and warn about it. */
       if (GET_TRIG_DEPTH(trig) == 1) {
         script_log("Trigger VNum %d has 'else' without 'if'.",
                    GET_TRIG_VNUM(trig));
         continue;
       }
-      cl = find_end(trig, cl);
+      cl = cl->jump;
       GET_TRIG_DEPTH(trig)--;
-    } else if (!strn_cmp("while ", p, 6)) {
-      temp = find_done(cl);
+    } else if (cl->op == DG_OP_WHILE) {
+      temp = cl->jump;
       if (!temp) {
         script_log("Trigger VNum %d has 'while' without 'done'.",
                    GET_TRIG_VNUM(trig));
         return ret_val;
       }
-      if (process_if(p + 6, go, sc, trig, type)) {
+      if (test_line(cl, go, sc, trig, type)) {
          temp->original = cl;
       } else {
          cl = temp;
          loops = 0;
       }
-    } else if (!strn_cmp("switch ", p, 7)) {
-      cl = find_case(trig, cl, go, sc, type, p + 7);
-    } else if (!strn_cmp("end", p, 3)) {
+    } else if (cl->op == DG_OP_SWITCH) {
+      cl = find_case(trig, cl, go, sc, type, cl->arg);
+    } else if (cl->op == DG_OP_END) {
       /* If not in an if-block, ignore the extra 'end' and warn about it. */
       if (GET_TRIG_DEPTH(trig) == 1) {
         script_log("Trigger VNum %d has 'end' without 'if'.",
@@ -2591,13 +2829,10 @@ int script_driver(void *go_adress, trig_data *trig, int type, int mode)
         continue;
       }
       GET_TRIG_DEPTH(trig)--;
-    } else if (!strn_cmp("done", p, 4)) {
+    } else if (cl->op == DG_OP_DONE) {
       /* if in a while loop, cl->original is non-NULL */
       if (cl->original) {
-      char *orig_cmd = cl->original->cmd;
-      while (*orig_cmd && isspace(*orig_cmd)) orig_cmd++;
-      if (cl->original && process_if(orig_cmd + 6, go, sc, trig,
-          type)) {
+      if (test_line(cl->original, go, sc, trig, type)) {
         cl = cl->original;
         loops++;
         GET_TRIG_LOOPS(trig)++;
@@ -2615,69 +2850,75 @@ int script_driver(void *go_adress, trig_data *trig, int type, int mode)
          /* if we're falling through a switch statement, this ends it. */
         }
       }
-    } else if (!strn_cmp("break", p, 5)) {
-      cl = find_done(cl);
-    } else if (!strn_cmp("case", p, 4)) {
+    } else if (cl->op == DG_OP_BREAK) {
+      /* a malformed block may leave nowhere to break to */
+      if (!(cl = cl->jump))
+        break;
+    } else if (cl->op == DG_OP_CASE) {
        /* Do nothing, this allows multiple cases to a single instance */
     }
 
     else {
       var_subst(go, sc, trig, type, p, cmd);
 
-      if (!strn_cmp(cmd, "eval ", 5))
+      /* the keyword of some lines is only known after substitution */
+      if ((op = cl->op) == DG_OP_SUBST)
+        op = command_op(cmd, -1);
+
+      if (op == DG_OP_EVAL)
         process_eval(go, sc, trig, type, cmd);
 
-      else if (!strn_cmp(cmd, "nop ", 4)); /* nop: do nothing */
+      else if (op == DG_OP_NOP); /* nop: do nothing */
 
-      else if (!strn_cmp(cmd, "extract ", 8))
+      else if (op == DG_OP_EXTRACT)
         extract_value(sc, trig, cmd);
 
-      else if (!strn_cmp(cmd, "dg_letter ", 10))
+      else if (op == DG_OP_LETTER)
         dg_letter_value(sc, trig, cmd);
 
-      else if (!strn_cmp(cmd, "makeuid ", 8))
+      else if (op == DG_OP_MAKEUID)
         makeuid_var(go, sc, trig, type, cmd);
 
-      else if (!strn_cmp(cmd, "halt", 4))
+      else if (op == DG_OP_HALT)
         break;
 
-      else if (!strn_cmp(cmd, "dg_cast ", 8))
+      else if (op == DG_OP_CAST)
         do_dg_cast(go, sc, trig, type, cmd);
 
-      else if (!strn_cmp(cmd, "dg_affect ", 10))
+      else if (op == DG_OP_AFFECT)
         do_dg_affect(go, sc, trig, type, cmd);
 
-      else if (!strn_cmp(cmd, "global ", 7))
+      else if (op == DG_OP_GLOBAL)
         process_global(sc, trig, cmd, sc->context);
 
-      else if (!strn_cmp(cmd, "context ", 8))
+      else if (op == DG_OP_CONTEXT)
         process_context(sc, trig, cmd);
 
-      else if (!strn_cmp(cmd, "remote ", 7))
+      else if (op == DG_OP_REMOTE)
         process_remote(sc, trig, cmd);
 
-      else if (!strn_cmp(cmd, "rdelete ", 8))
+      else if (op == DG_OP_RDELETE)
         process_rdelete(sc, trig, cmd);
 
-      else if (!strn_cmp(cmd, "return ", 7))
+      else if (op == DG_OP_RETURN)
         ret_val = process_return(trig, cmd);
 
-      else if (!strn_cmp(cmd, "set ", 4))
+      else if (op == DG_OP_SET)
         process_set(sc, trig, cmd);
 
-      else if (!strn_cmp(cmd, "unset ", 6))
+      else if (op == DG_OP_UNSET)
         process_unset(sc, trig, cmd);
 
-      else if (!strn_cmp(cmd, "wait ", 5)) {
+      else if (op == DG_OP_WAIT) {
         process_wait(go, trig, type, cmd, cl);
         depth--;
         return ret_val;
       }
 
-      else if (!strn_cmp(cmd, "attach ", 7))
+      else if (op == DG_OP_ATTACH)
         process_attach(go, sc, trig, type, cmd);
 
-      else if (!strn_cmp(cmd, "detach ", 7))
+      else if (op == DG_OP_DETACH)
         process_detach(go, sc, trig, type, cmd);
 
       else {
@@ -2709,8 +2950,7 @@ int script_driver(void *go_adress, trig_data *trig, int type, int mode)
     case WLD_TRIGGER:    sc = SCRIPT((room_data *) go);    break;
   }
   if (sc)
-  free_varlist(GET_TRIG_VARS(trig));
-  GET_TRIG_VARS(trig) = NULL;
+  free_varlist(&GET_TRIG_VARS(trig));
   GET_TRIG_DEPTH(trig) = 0;
 
   depth--;
@@ -2766,32 +3006,17 @@ static struct cmdlist_element *
 find_case(struct trig_data *trig, struct cmdlist_element *cl,
           void *go, struct script_data *sc, int type, char *cond)
 {
-  char result[MAX_INPUT_LENGTH];
+  char result[MAX_INPUT_LENGTH], buf[MAX_INPUT_LENGTH];
   struct cmdlist_element *c;
-  char *p, *buf;
 
   eval_expr(cond, result, go, sc, trig, type);
 
-  if (!(cl->next))
-    return cl;
-
-  for (c = cl->next; c->next; c = c->next) {
-    for (p = c->cmd; *p && isspace(*p); p++);
-
-    if (!strn_cmp("while ", p, 6) || !strn_cmp("switch", p, 6))
-      c = find_done(c);
-    else if (!strn_cmp("case ", p, 5)) {
-      buf = (char*)malloc(MAX_STRING_LENGTH);
-      eval_op("==", result, p + 5, buf, go, sc, trig);
-      if (*buf && *buf!='0') {
-        free(buf);
-        return c;
-      }
-      free(buf);
-    } else if (!strn_cmp("default", p, 7))
+  for (c = cl->chain; c->next; c = c->chain) {
+    if (c->stop != DG_STOP_TEST)
+      return c;
+    eval_op("==", result, c->arg, buf, go, sc, trig);
+    if (*buf && *buf!='0')
       return c;
-    else if (!strn_cmp("done", p, 3))
-     return c;
   }
   return c;
 }
@@ -2885,8 +3110,8 @@ void save_char_vars(struct char_data *ch)
   unlink(fn);
 
   /* make sure this char has global variables to save */
-  if (ch->script->global_vars == NULL) return;
-  vars = ch->script->global_vars;
+  if (ch->script->global_vars.list == NULL) return;
+  vars = ch->script->global_vars.list;
 
   file = fopen(fn,"wt");
   if (!file) {
@@ -2954,55 +3179,104 @@ void save_char_vars_ascii(FILE *file, struct char_data *ch)
   if (IS_NPC(ch)) return;
 
   /* make sure this char has global variables to save */
-  if (ch->script->global_vars == NULL) return;
+  if (ch->script->global_vars.list == NULL) return;
 
   /* Note that currently, context will always be zero. This may change in the 
    * future */
-  for (vars = ch->script->global_vars;vars;vars = vars->next)
+  for (vars = ch->script->global_vars.list;vars;vars = vars->next)
     if (*vars->name != '-')
       count++;
 
   if (count != 0) {
 	  fprintf(file, "Vars: %d\n", count);
 
-  for (vars = ch->script->global_vars;vars;vars = vars->next)
+  for (vars = ch->script->global_vars.list;vars;vars = vars->next)
     if (*vars->name != '-') /* don't save if it begins with - */
       fprintf(file, "%s %ld %s\n", vars->name, vars->context, vars->value);
   }
 }
 
 /* find_char() helpers */
+/* Script UIDs of live mobs, players and objects are kept in an open
+ * addressing table with linear probing.  A removed entry leaves a tombstone
+ * so later probes carry on past it; inserts reuse the first tombstone on
+ * their path, and the table is rebuilt (at twice the size if it is the live
+ * entries that fill it) once entries and tombstones pass 3/4 of the slots. */
 /* Must be power of 2. */
-#define BUCKET_COUNT 64
-/* To recognize an empty bucket. */
-#define UID_OUT_OF_RANGE 1000000000
+#define LOOKUP_MIN_SIZE 1024
+/* UID 0 is never handed out, so it marks a slot never used. */
+#define LOOKUP_EMPTY     0
+#define LOOKUP_TOMBSTONE (-1)
 
 struct lookup_table_t {
   long uid;
   void * c;
-  struct lookup_table_t *next;
 };
-static struct lookup_table_t lookup_table[BUCKET_COUNT];
+static struct lookup_table_t *lookup_table = NULL;
+static int lookup_size = 0;   /* slots, a power of 2 */
+static int lookup_bits = 0;   /* ...and its log2 */
+static int lookup_used = 0;   /* live entries */
+static int lookup_tombs = 0;  /* tombstones */
 
-void init_lookup_table(void)
+/* UIDs come out in two sequential runs (mobs and objects); Fibonacci
+ * hashing, which keeps the top bits of the product, spreads both runs
+ * evenly instead of letting them line up in long clusters. */
+static int lookup_home(long uid)
 {
-  int i;
-  for (i = 0; i < BUCKET_COUNT; i++) {
-    lookup_table[i].uid  = UID_OUT_OF_RANGE;
-    lookup_table[i].c    = NULL;
-    lookup_table[i].next = NULL;
+  return (int) ((((unsigned long) uid * 2654435769UL) & 0xFFFFFFFFUL) >> (32 - lookup_bits));
+}
+
+static void lookup_table_resize(int size)
+{
+  struct lookup_table_t *old = lookup_table;
+  int old_size = lookup_size, i, n;
+
+  CREATE(lookup_table, struct lookup_table_t, size);
+  lookup_size = size;
+  for (lookup_bits = 0; (1 << lookup_bits) < size; lookup_bits++)
+    ;
+  lookup_tombs = 0;
+
+  for (i = 0; i < old_size; i++) {
+    if (old[i].uid == LOOKUP_EMPTY || old[i].uid == LOOKUP_TOMBSTONE)
+      continue;
+    for (n = lookup_home(old[i].uid); lookup_table[n].uid != LOOKUP_EMPTY; n = (n + 1) & (size - 1))
+      ;
+    lookup_table[n] = old[i];
   }
+
+  if (old)
+    free(old);
 }
 
-static struct char_data *find_char_by_uid_in_lookup_table(long uid)
+void init_lookup_table(void)
+{
+  if (lookup_table)
+    free(lookup_table);
+  lookup_table = NULL;
+  lookup_size = lookup_used = lookup_tombs = 0;
+  lookup_table_resize(LOOKUP_MIN_SIZE);
+}
+
+/* Slot holding 'uid', or -1.  The table always has empty slots, so the
+ * probe ends. */
+static int lookup_slot(long uid)
 {
-  int bucket = (int) (uid & (BUCKET_COUNT - 1));
-  struct lookup_table_t *lt = &lookup_table[bucket];
+  int n;
 
-  for (;lt && lt->uid != uid ; lt = lt->next) ;
+  for (n = lookup_home(uid); lookup_table[n].uid != LOOKUP_EMPTY; n = (n + 1) & (lookup_size - 1))
+    if (lookup_table[n].uid == uid)
+      return (n);
 
-  if (lt)
-    return (struct char_data *)(lt->c);
+  return (-1);
+}
+
+static struct char_data *find_char_by_uid_in_lookup_table(long uid)
+{
+  int n = lookup_slot(uid);
+
+  if (n >= 0)
+    return (struct char_data *)(lookup_table[n].c);
 
   log("find_char_by_uid_in_lookup_table : No entity with number %ld in lookup table", uid);
   return NULL;
@@ -3010,13 +3284,10 @@ static struct char_data *find_char_by_uid_in_lookup_table(long uid)
 
 static struct obj_data *find_obj_by_uid_in_lookup_table(long uid)
 {
-  int bucket = (int) (uid & (BUCKET_COUNT - 1));
-  struct lookup_table_t *lt = &lookup_table[bucket];
-
-  for (;lt && lt->uid != uid ; lt = lt->next) ;
+  int n = lookup_slot(uid);
 
-  if (lt)
-    return (struct obj_data *)(lt->c);
+  if (n >= 0)
+    return (struct obj_data *)(lookup_table[n].c);
 
   log("find_obj_by_uid_in_lookup_table : No entity with number %ld in lookup table", uid);
   return NULL;
@@ -3024,51 +3295,72 @@ static struct obj_data *find_obj_by_uid_in_lookup_table(long uid)
 
 void add_to_lookup_table(long uid, void *c)
 {
-  int bucket = (int) (uid & (BUCKET_COUNT - 1));
-  struct lookup_table_t *lt = &lookup_table[bucket];
+  int n, tomb = -1;
 
-  if (lt && lt->uid == uid) {
-   log("add_to_lookup updating existing value for uid=%ld (%p -> %p)", uid, lt->c, c);
-   lt->c = c;
-   return;
-  }
-
-  for (;lt && lt->next; lt = lt->next)
-    if (lt->next->uid == uid) {
-      log("add_to_lookup updating existing value for uid=%ld (%p -> %p)", uid, lt->next->c, c);
+  for (n = lookup_home(uid); lookup_table[n].uid != LOOKUP_EMPTY; n = (n + 1) & (lookup_size - 1)) {
+    if (lookup_table[n].uid == uid) {
+      log("add_to_lookup updating existing value for uid=%ld (%p -> %p)", uid, lookup_table[n].c, c);
+      lookup_table[n].c = c;
       return;
     }
+    if (lookup_table[n].uid == LOOKUP_TOMBSTONE && tomb < 0)
+      tomb = n;
+  }
 
-  CREATE(lt->next, struct lookup_table_t, 1);
-  lt->next->uid = uid;
-  lt->next->c = c;
+  if (tomb >= 0) {
+    n = tomb;
+    lookup_tombs--;
+  }
+  lookup_table[n].uid = uid;
+  lookup_table[n].c = c;
+  lookup_used++;
+
+  if ((lookup_used + lookup_tombs) * 4 > lookup_size * 3)
+    lookup_table_resize(lookup_used * 2 > lookup_size ? lookup_size * 2 : lookup_size);
 }
 
 void remove_from_lookup_table(long uid)
 {
-  int bucket = (int) (uid & (BUCKET_COUNT - 1));
-  struct lookup_table_t *lt = &lookup_table[bucket], *flt = NULL;
+  int n;
 
   /* This is not supposed to happen. UID 0 is not used. However, while I'm 
    * debugging the issue, let's just return right away. - Welcor */
   if (uid == 0)
     return;
 
-  for (;lt;lt = lt->next)
-    if (lt->uid == uid)
-      flt = lt;
-
-  if (flt) {
-    for (lt = &lookup_table[bucket];lt->next != flt;lt = lt->next)
-      ;
-    lt->next = flt->next;
-    free(flt);
+  if ((n = lookup_slot(uid)) >= 0) {
+    lookup_table[n].uid = LOOKUP_TOMBSTONE;
+    lookup_table[n].c = NULL;
+    lookup_used--;
+    lookup_tombs++;
     return;
   }
 
   log("remove_from_lookup. UID %ld not found.", uid);
 }
 
+/* Occupancy and probe lengths, for 'show stats'. */
+size_t lookup_table_stats(char *buf, size_t len)
+{
+  long total = 0;
+  int n, home, dist, longest = 0;
+
+  for (n = 0; n < lookup_size; n++) {
+    if (lookup_table[n].uid == LOOKUP_EMPTY || lookup_table[n].uid == LOOKUP_TOMBSTONE)
+      continue;
+    home = lookup_home(lookup_table[n].uid);
+    dist = ((n - home) & (lookup_size - 1)) + 1;
+    total += dist;
+    longest = MAX(longest, dist);
+  }
+
+  return snprintf(buf, len,
+	"  %5d script UIDs in %d slots (%d%% full, %d tombstones)\r\n"
+	"        probes per lookup: %.2f average, %d longest\r\n",
+	lookup_used, lookup_size, lookup_size ? (lookup_used + lookup_tombs) * 100 / lookup_size : 0,
+	lookup_tombs, lookup_used ? (double) total / lookup_used : 0.0, longest);
+}
+
 bool check_flags_by_name_ar(int *array, int numflags, char *search, const char *namelist[]) 
 { 
   int i, item=-1; 
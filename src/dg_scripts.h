@@ -130,19 +130,88 @@
 
 #define SCRIPT_ERROR_CODE     -9999999   /* this shouldn't happen too often */
 
+/* What compile_trigger() makes of each line, in the order script_driver()
+ * used to test for them.  DG_OP_SUBST marks a command whose keyword is only
+ * known after variable substitution. */
+#define DG_OP_COMMENT           1
+#define DG_OP_IF                2
+#define DG_OP_ELSE              3    /* else and elseif */
+#define DG_OP_WHILE             4
+#define DG_OP_SWITCH            5
+#define DG_OP_END               6
+#define DG_OP_DONE              7
+#define DG_OP_BREAK             8
+#define DG_OP_CASE              9
+#define DG_OP_SUBST            10
+#define DG_OP_EVAL             11
+#define DG_OP_NOP              12
+#define DG_OP_EXTRACT          13
+#define DG_OP_LETTER           14
+#define DG_OP_MAKEUID          15
+#define DG_OP_HALT             16
+#define DG_OP_CAST             17
+#define DG_OP_AFFECT           18
+#define DG_OP_GLOBAL           19
+#define DG_OP_CONTEXT          20
+#define DG_OP_REMOTE           21
+#define DG_OP_RDELETE          22
+#define DG_OP_RETURN           23
+#define DG_OP_SET              24
+#define DG_OP_UNSET            25
+#define DG_OP_WAIT             26
+#define DG_OP_ATTACH           27
+#define DG_OP_DETACH           28
+#define DG_OP_COMMAND          29
+
+/* How a line ends a search for the next else or case to run */
+#define DG_STOP_NONE            0
+#define DG_STOP_TEST            1    /* elseif, case: run it if arg holds */
+#define DG_STOP_ENTER           2    /* else, default: always run it */
+#define DG_STOP_END             3    /* end, done: nothing matched */
+
+/* Conditions without variables are worked out when the trigger is compiled */
+#define DG_COND_VARIES          0
+#define DG_COND_FALSE           1
+#define DG_COND_TRUE            2
+
 /* one line of the trigger */
 struct cmdlist_element {
   char *cmd;				/* one line of a trigger */
   struct cmdlist_element *original;
   struct cmdlist_element *next;
+
+  /* filled in by compile_trigger() */
+  char *text;                           /* cmd past its indentation       */
+  char *arg;                            /* condition or case value        */
+  struct cmdlist_element *jump;         /* end or done closing this block */
+  struct cmdlist_element *chain;        /* next elseif/else or case to try */
+  byte op;                              /* DG_OP_xxx                      */
+  byte stop;                            /* DG_STOP_xxx                    */
+  byte cond;                            /* DG_COND_xxx                    */
 };
 
 struct trig_var_data {
   char *name;				/* name of variable  */
   char *value;				/* value of variable */
   long context;				/* 0: global context */
+  unsigned int hash;			/* of the name, case folded */
 
   struct trig_var_data *next;
+  struct trig_var_data *prev;
+  struct trig_var_data *next_hash;	/* next in the same index bucket */
+};
+
+/* Scopes with more variables than this get a hash index. */
+#define VAR_INDEX_MIN           8
+
+/** The local variables of a trigger or the globals of a script.  The list
+ * holds the newest variable first and is what gets shown and saved; the
+ * index, once there is one, finds a name without walking it. */
+struct trig_var_scope {
+  struct trig_var_data *list;         /**< every variable, newest first   */
+  struct trig_var_data **index;       /**< hash buckets, or NULL if small */
+  int index_size;                     /**< number of buckets, power of 2  */
+  int count;                          /**< number of variables            */
 };
 
 /** structure for triggers */
@@ -160,7 +229,7 @@ struct trig_data {
     int loops;                          /**< loop iteration counter          */
     struct event *wait_event;           /**< event to pause the trigger  */
     ubyte purged;                       /**< trigger is set to be purged     */
-    struct trig_var_data *var_list;	    /**< list of local vars for trigger  */
+    struct trig_var_scope var_list;     /**< local vars for trigger          */
 
     struct trig_data *next;
     struct trig_data *next_in_world;    /**< next in the global trigger list */
@@ -170,11 +239,15 @@ struct trig_data {
 struct script_data {
   long types;                        /**< bitvector of trigger types */
   struct trig_data *trig_list;       /**< list of triggers           */
-  struct trig_var_data *global_vars; /**< list of global variables   */
+  struct trig_var_scope global_vars; /**< global variables           */
   ubyte purged;                      /**< script is set to be purged */
   long context;                      /**< current context for statics */
 
   struct script_data *next;          /**< used for purged_scripts    */
+
+  void *random_owner;                /**< owner, while on a random list */
+  struct script_data *next_random;   /**< links in that list          */
+  struct script_data *prev_random;
 };
 
 /* The event data for the wait command */
@@ -287,12 +360,16 @@ int trgvar_in_room(room_vnum vnum);
 obj_data *get_obj_in_list(char *name, obj_data *list);
 obj_data *get_object_in_equip(char_data * ch, char *name);
 void script_trigger_check(void);
+void list_random_script(void *go, int type);
+void unlist_random_script(struct script_data *sc, int type);
+void relist_random_rooms(void);
 void check_time_triggers(void);
 void find_uid_name(char *uid, char *name, size_t nlen);
 void do_sstat_room(struct char_data * ch, room_data *r);
 void do_sstat_object(char_data *ch, obj_data *j);
 void do_sstat_character(char_data *ch, char_data *k);
 void add_trigger(struct script_data *sc, trig_data *t, int loc);
+void compile_trigger(trig_data *trig);
 void script_vlog(const char *format, va_list args);
 void script_log(const char *format, ...) __attribute__ ((format (printf, 1, 2)));
 char *matching_quote(char *p);
@@ -314,17 +391,22 @@ void save_char_vars(struct char_data *ch);
 void init_lookup_table(void);
 void add_to_lookup_table(long uid, void *c);
 void remove_from_lookup_table(long uid);
+size_t lookup_table_stats(char *buf, size_t len);
 
 /* from dg_db_scripts.c */
 void parse_trigger(FILE *trig_f, int nr);
 trig_data *read_trigger(int nr);
 void trig_data_copy(trig_data *this_data, const trig_data *trg);
 void dg_read_trigger(FILE *fp, void *proto, int type);
+void dg_attach_trigger(void *proto, int type, int vnum);
 void dg_obj_trigger(char *line, struct obj_data *obj);
 void assign_triggers(void *i, int type);
 
 /* From dg_variables.c */
-void add_var(struct trig_var_data **var_list, const char *name, const char *value, long id);
+void add_var(struct trig_var_scope *scope, const char *name, const char *value, long id);
+struct trig_var_data *find_var(struct trig_var_scope *scope, const char *name);
+struct trig_var_data *find_var_context(struct trig_var_scope *scope,
+               const char *name, long context);
 int item_in_list(char *item, obj_data *list);
 char *skill_percent(struct char_data *ch, char *skill);
 int char_has_item(char *item, struct char_data *ch);
@@ -337,8 +419,9 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
 
 /* From dg_handler.c */
 void free_var_el(struct trig_var_data *var);
-void free_varlist(struct trig_var_data *vd);
-int remove_var(struct trig_var_data **var_list, char *name);
+void free_varlist(struct trig_var_scope *scope);
+void delete_var(struct trig_var_scope *scope, struct trig_var_data *vd);
+int remove_var(struct trig_var_scope *scope, char *name);
 void free_trigger(trig_data *trig);
 void extract_trigger(struct trig_data *trig);
 void extract_script(void *thing, int type);
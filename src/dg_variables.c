@@ -30,19 +30,83 @@
 
 /* Utility functions */
 
+/* FNV-1a over the lowercased name, so names equal under str_cmp() hash
+ * alike. */
+static unsigned int var_hash(const char *name)
+{
+  unsigned int hash = 2166136261U;
+
+  for (; *name; name++)
+    hash = (hash ^ (unsigned char) LOWER(*name)) * 16777619U;
+
+  return (hash);
+}
+
+/* (Re)builds the index of scope with 'size' buckets.  Each bucket keeps the
+ * list's newest-first order, so a name defined in several contexts is found
+ * in the same order either way. */
+static void index_scope(struct trig_var_scope *scope, int size)
+{
+  struct trig_var_data *vd, **tail;
+
+  if (scope->index)
+    free(scope->index);
+  CREATE(scope->index, struct trig_var_data *, size);
+  scope->index_size = size;
+
+  for (vd = scope->list; vd; vd = vd->next) {
+    for (tail = &scope->index[vd->hash & (size - 1)]; *tail; tail = &(*tail)->next_hash);
+    *tail = vd;
+    vd->next_hash = NULL;
+  }
+}
+
+/* The newest variable called name, in any context if 'any' is set and
+ * otherwise in the global context or the given one. */
+static struct trig_var_data *lookup_var(struct trig_var_scope *scope,
+               const char *name, unsigned int hash, bool any, long context)
+{
+  struct trig_var_data *vd;
+
+  if (scope->index)
+    vd = scope->index[hash & (scope->index_size - 1)];
+  else
+    vd = scope->list;
+
+  for (; vd; vd = scope->index ? vd->next_hash : vd->next)
+    if (vd->hash == hash && !str_cmp(vd->name, name) &&
+        (any || !vd->context || vd->context == context))
+      return (vd);
+
+  return (NULL);
+}
+
+struct trig_var_data *find_var(struct trig_var_scope *scope, const char *name)
+{
+  return lookup_var(scope, name, var_hash(name), TRUE, 0);
+}
+
+struct trig_var_data *find_var_context(struct trig_var_scope *scope,
+               const char *name, long context)
+{
+  return lookup_var(scope, name, var_hash(name), FALSE, context);
+}
+
 /* Thanks to James Long for his assistance in plugging the memory leak that
  * used to be here. - Welcor */
 /* Adds a variable with given name and value to trigger. */
-void add_var(struct trig_var_data **var_list, const char *name, const char *value, long id)
+void add_var(struct trig_var_scope *scope, const char *name, const char *value, long id)
 {
   struct trig_var_data *vd;
+  unsigned int hash;
 
   if (strchr(name, '.')) {
     log("add_var() : Attempt to add illegal var: %s", name);
     return;
   }
 
-  for (vd = *var_list; vd && str_cmp(vd->name, name); vd = vd->next);
+  hash = var_hash(name);
+  vd = lookup_var(scope, name, hash, TRUE, 0);
 
   if (vd && (!vd->context || vd->context==id)) {
     free(vd->value);
@@ -57,9 +121,21 @@ void add_var(struct trig_var_data **var_list, const char *name, const char *valu
 
     CREATE(vd->value, char, strlen(value) + 1);
 
-    vd->next = *var_list;
+    vd->hash = hash;
+    vd->next = scope->list;
+    if (scope->list)
+      scope->list->prev = vd;
     vd->context = id;
-    *var_list = vd;
+    scope->list = vd;
+
+    /* index scopes once they are big enough for it to pay, at one bucket per
+     * variable or more */
+    if (++scope->count > scope->index_size && scope->count > VAR_INDEX_MIN)
+      index_scope(scope, scope->index_size ? scope->index_size * 2 : VAR_INDEX_MIN * 2);
+    else if (scope->index) {
+      vd->next_hash = scope->index[hash & (scope->index_size - 1)];
+      scope->index[hash & (scope->index_size - 1)] = vd;
+    }
   }
 
   strcpy(vd->value, value);                            /* strcpy: ok*/
@@ -282,16 +358,11 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
 
   /* X.global() will have a NULL trig */
   if (trig)
-    for (vd = GET_TRIG_VARS(trig); vd; vd = vd->next)
-      if (!str_cmp(vd->name, var))
-        break;
+    vd = find_var(&GET_TRIG_VARS(trig), var);
 
   /* some evil waitstates could crash the mud if sent here with sc==NULL*/
   if (!vd && sc)
-    for (vd = sc->global_vars; vd; vd = vd->next)
-      if (!str_cmp(vd->name, var) &&
-          (vd->context==0 || vd->context==sc->context))
-        break;
+    vd = find_var_context(&sc->global_vars, var, sc->context);
 
   if (!*field) {
     if (vd)
@@ -424,11 +495,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
           script_log("Attempt to find global var. Apparently the void has no script.");
           return;
         }
-        for (vd = thescript->global_vars; vd ; vd = vd->next)
-          if (!str_cmp(vd->name, field))
-            break;
-
-        if (vd)
+        if ((vd = find_var(&thescript->global_vars, field)))
           snprintf(str, slen, "%s", vd->value);
 
         return;
@@ -1125,9 +1192,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
             struct trig_var_data *remote_vd;
             strcpy(str, "0");
             if (SCRIPT(c)) {
-              for (remote_vd = SCRIPT(c)->global_vars; remote_vd; remote_vd = remote_vd->next) {
-                if (!str_cmp(remote_vd->name, subfield)) break;
-              }
+              remote_vd = find_var(&SCRIPT(c)->global_vars, subfield);
               if (remote_vd) strcpy(str, "1");
             }
           }
@@ -1181,10 +1246,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
 
       if (*str == '\x1') { /* no match found in switch */
         if (SCRIPT(c)) {
-          for (vd = (SCRIPT(c))->global_vars; vd; vd = vd->next)
-            if (!str_cmp(vd->name, field))
-              break;
-          if (vd)
+          if ((vd = find_var(&SCRIPT(c)->global_vars, field)))
             snprintf(str, slen, "%s", vd->value);
           else {
             *str = '\0';
@@ -1384,10 +1446,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
 
       if (*str == '\x1') { /* no match in switch */
         if (SCRIPT(o)) { /* check for global var */
-          for (vd = (SCRIPT(o))->global_vars; vd; vd = vd->next)
-            if (!str_cmp(vd->name, field))
-              break;
-          if (vd)
+          if ((vd = find_var(&SCRIPT(o)->global_vars, field)))
             snprintf(str, slen, "%s", vd->value);
           else {
             *str = '\0';
@@ -1411,10 +1470,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
           script_log("Trigger: %s, Vnum %d, type %d. Trying to access Global var list of void. Apparently this has not been set up!",
                      GET_TRIG_NAME(trig), GET_TRIG_VNUM(trig), type);
         } else {
-          for (vd = (SCRIPT(r))->global_vars; vd; vd = vd->next)
-            if (!str_cmp(vd->name, field))
-              break;
-          if (vd)
+          if ((vd = find_var(&SCRIPT(r)->global_vars, field)))
             snprintf(str, slen, "%s", vd->value);
           else
             *str = '\0';
@@ -1623,10 +1679,7 @@ void find_replacement(void *go, struct script_data *sc, trig_data *trig,
       }
       else {
         if (SCRIPT(r)) { /* check for global var */
-          for (vd = (SCRIPT(r))->global_vars; vd; vd = vd->next)
-            if (!str_cmp(vd->name, field))
-              break;
-          if (vd)
+          if ((vd = find_var(&SCRIPT(r)->global_vars, field)))
             snprintf(str, slen, "%s", vd->value);
           else {
             *str = '\0';
@@ -20,6 +20,7 @@
 #include "constants.h"
 #include "genzon.h" /* for zone_rnum real_zone_by_thing */
 #include "fight.h"  /* for die() */
+#include "graph.h"
 
 /* Local functions, macros, defines and structs */
 
@@ -239,6 +240,7 @@ WCMD(do_wdoor)
     }
 
     newexit = rm->dir_option[dir];
+    graph_changed();
 
     /* purge exit */
     if (fd == 0) {
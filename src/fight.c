@@ -25,6 +25,7 @@
 #include "fight.h"
 #include "shop.h"
 #include "quest.h"
+#include "profiler.h"
 
 
 /* locally defined global variables, used externally */
@@ -51,7 +52,29 @@ struct attack_hit_type attack_hit_text[] =
 };
 
 /* local (file scope only) variables */
-static struct char_data *next_combat_list = NULL;
+/* Each round of perform_violence() takes combat_list, in order, and sorts it
+ * by room, keeping the list order within a room; then it resolves one room
+ * after another.  A room's messages thus go out back to back, and those
+ * watching get the whole room's round as one run of shared text (see
+ * act()) rather than lines interleaved with every other fight's. */
+struct combat_slot {
+  struct char_data *ch;        /* NULL once they have left the fight */
+  room_rnum room;
+  int order;                   /* place on combat_list */
+};
+
+static struct combat_slot *round_slots = NULL;
+static int round_max = 0;      /* slots allocated */
+static int round_size = 0;     /* slots in the round under way, or 0 */
+static int round_pos = 0;      /* the slot whose turn it is */
+
+/* Counts and timings of the rounds that had anyone fighting, for 'profile'. */
+static struct {
+  unsigned long rounds;
+  unsigned long usec_total, usec_max, usec_last;
+  int fighters, rooms, crowd;  /* last round: fighters, rooms, most in one */
+  int peak;                    /* most fighters in any round */
+} combat_stats;
 
 /* local file scope utility functions */
 static void perform_group_gain(struct char_data *ch, int base, struct char_data *victim);
@@ -150,9 +173,14 @@ void set_fighting(struct char_data *ch, struct char_data *vict)
 void stop_fighting(struct char_data *ch)
 {
   struct char_data *temp;
+  int i;
 
-  if (ch == next_combat_list)
-    next_combat_list = ch->next_fighting;
+  /* If they have yet to swing this round, they don't now. */
+  for (i = round_pos + 1; i < round_size; i++)
+    if (round_slots[i].ch == ch) {
+      round_slots[i].ch = NULL;
+      break;
+    }
 
   REMOVE_FROM_LIST(ch, combat_list, next_fighting);
   ch->next_fighting = NULL;
@@ -902,13 +930,62 @@ void hit(struct char_data *ch, struct char_data *victim, int type)
   hitprcnt_mtrigger(victim);
 }
 
+static int combat_slot_compare(const void *a, const void *b)
+{
+  const struct combat_slot *x = a, *y = b;
+
+  if (x->room != y->room)
+    return (x->room < y->room ? -1 : 1);
+  return (x->order - y->order);
+}
+
+/* Lay out the round: combat_list sorted by room.  Returns the fighters. */
+static int combat_schedule(void)
+{
+  struct char_data *ch;
+  int i, count, run;
+
+  for (count = 0, ch = combat_list; ch; ch = ch->next_fighting)
+    count++;
+
+  if (count > round_max) {
+    round_max = count + count / 2;
+    RECREATE(round_slots, struct combat_slot, round_max);
+  }
+
+  for (i = 0, ch = combat_list; ch; ch = ch->next_fighting, i++) {
+    round_slots[i].ch = ch;
+    round_slots[i].room = IN_ROOM(ch);
+    round_slots[i].order = i;
+  }
+  qsort(round_slots, count, sizeof(struct combat_slot), combat_slot_compare);
+
+  combat_stats.rooms = combat_stats.crowd = 0;
+  for (i = run = 0; i < count; i++) {
+    if (i == 0 || round_slots[i].room != round_slots[i - 1].room) {
+      combat_stats.rooms++;
+      run = 0;
+    }
+    combat_stats.crowd = MAX(combat_stats.crowd, ++run);
+  }
+
+  return (count);
+}
+
 /* control the fights going on.  Called every 2 seconds from comm.c. */
 void perform_violence(void)
 {
   struct char_data *ch, *tch;
+  unsigned long start = prof_now(), usec;
+
+  if (!combat_list)
+    return;
 
-  for (ch = combat_list; ch; ch = next_combat_list) {
-    next_combat_list = ch->next_fighting;
+  round_size = combat_schedule();
+
+  for (round_pos = 0; round_pos < round_size; round_pos++) {
+    if ((ch = round_slots[round_pos].ch) == NULL)
+      continue;
 
     if (FIGHTING(ch) == NULL || IN_ROOM(ch) != IN_ROOM(FIGHTING(ch))) {
       stop_fighting(ch);
@@ -960,4 +1037,26 @@ void perform_violence(void)
       (GET_MOB_SPEC(ch)) (ch, ch, 0, actbuf);
     }
   }
+
+  combat_stats.fighters = round_size;
+  combat_stats.peak = MAX(combat_stats.peak, round_size);
+  round_size = round_pos = 0;
+
+  usec = prof_now() - start;
+  combat_stats.rounds++;
+  combat_stats.usec_total += usec;
+  combat_stats.usec_last = usec;
+  combat_stats.usec_max = MAX(combat_stats.usec_max, usec);
+}
+
+/* One status line for the 'profile' command. */
+size_t combat_status(char *buf, size_t len)
+{
+  return snprintf(buf, len,
+      "Combat: %lu rounds (avg %lu us, max %lu us, peak %d fighters); last "
+      "round %d fighters in %d rooms, at most %d in one, in %lu us.\r\n",
+      combat_stats.rounds,
+      combat_stats.rounds ? combat_stats.usec_total / combat_stats.rounds : 0,
+      combat_stats.usec_max, combat_stats.peak, combat_stats.fighters,
+      combat_stats.rooms, combat_stats.crowd, combat_stats.usec_last);
 }
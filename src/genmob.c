@@ -17,6 +17,7 @@
 #include "genzon.h"
 #include "dg_olc.h"
 #include "spells.h"
+#include "keyword.h"
 
 /* local functions */
 static void extract_mobile_all(mob_vnum vnum);
@@ -27,14 +28,18 @@ int add_mobile(struct char_data *mob, mob_vnum vnum)
   zone_rnum zone;
   struct char_data *live_mob;
 
+  keyword_protos_changed(KW_MOBILES);
+
   if ((rnum = real_mobile(vnum)) != NOBODY) {
     /* Copy over the mobile and free() the old strings. */
     copy_mobile(&mob_proto[rnum], mob);
 
     /* Now re-point all existing mobile strings to here. */
     for (live_mob = character_list; live_mob; live_mob = live_mob->next)
-      if (rnum == live_mob->nr)
+      if (rnum == live_mob->nr) {
         update_mobile_strings(live_mob, &mob_proto[rnum]);
+        keyword_char_renamed(live_mob);
+      }
 
     add_to_save_list(zone_table[real_zone_by_thing(vnum)].number, SL_MOB);
     log("GenOLC: add_mobile: Updated existing mobile #%d.", vnum);
@@ -53,12 +58,14 @@ int add_mobile(struct char_data *mob, mob_vnum vnum)
       mob_index[i].vnum = vnum;
       mob_index[i].number = 0;
       mob_index[i].func = 0;
+      vnum_index_set(DB_BOOT_MOB, vnum, i);
       found = i;
       break;
     }
     mob_index[i] = mob_index[i - 1];
     mob_proto[i] = mob_proto[i - 1];
     mob_proto[i].nr++;
+    vnum_index_set(DB_BOOT_MOB, mob_index[i].vnum, i);
   }
   if (!found) {
     mob_proto[0] = *mob;
@@ -67,6 +74,7 @@ int add_mobile(struct char_data *mob, mob_vnum vnum)
     mob_index[0].vnum = vnum;
     mob_index[0].number = 0;
     mob_index[0].func = 0;
+    vnum_index_set(DB_BOOT_MOB, vnum, 0);
   }
 
   log("GenOLC: add_mobile: Added mobile %d at index #%d.", vnum, found);
@@ -155,16 +163,20 @@ int delete_mobile(mob_rnum refpt)
     return NOBODY;
   }
 
+  keyword_protos_changed(KW_MOBILES);
+
   vnum = mob_index[refpt].vnum;
   proto = &mob_proto[refpt];
   
   extract_mobile_all(vnum);
   extract_char(proto);
 
+  vnum_index_set(DB_BOOT_MOB, vnum, NOBODY);
   for (counter = refpt; counter < top_of_mobt; counter++) {
     mob_index[counter] = mob_index[counter + 1];
     mob_proto[counter] = mob_proto[counter + 1];
     mob_proto[counter].nr--;
+    vnum_index_set(DB_BOOT_MOB, mob_index[counter].vnum, counter);
   }
 
   top_of_mobt--;
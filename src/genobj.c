@@ -19,6 +19,7 @@
 #include "handler.h"
 #include "interpreter.h"
 #include "boards.h" /* for board_info */
+#include "keyword.h"
 
 
 /* local functions */
@@ -30,6 +31,8 @@ obj_rnum add_object(struct obj_data *newobj, obj_vnum ovnum)
   int found = NOTHING;
   zone_rnum rznum = real_zone_by_thing(ovnum);
 
+  keyword_protos_changed(KW_OBJECTS);
+
   /* Write object to internal tables. */
   if ((newobj->item_number = real_object(ovnum)) != NOTHING) {
     copy_object(&obj_proto[newobj->item_number], newobj);
@@ -65,6 +68,9 @@ static int update_all_objects(struct obj_data *refobj)
 
     /* Copy game-time dependent variables over. */
     obj->script_id = swap.script_id;
+    obj->proto_script = swap.proto_script;
+    obj->script = swap.script;
+    obj->events = swap.events;
     IN_ROOM(obj) = swap.in_room;
     obj->carried_by = swap.carried_by;
     obj->worn_by = swap.worn_by;
@@ -74,6 +80,7 @@ static int update_all_objects(struct obj_data *refobj)
     obj->next_content = swap.next_content;
     obj->next = swap.next;
     obj->sitting_here = swap.sitting_here;
+    keyword_obj_renamed(obj);
   }
 
   return count;
@@ -150,6 +157,7 @@ obj_rnum insert_object(struct obj_data *obj, obj_vnum ovnum)
     obj_index[i] = obj_index[i - 1];
     obj_proto[i] = obj_proto[i - 1];
     obj_proto[i].item_number = i;
+    vnum_index_set(DB_BOOT_OBJ, obj_index[i].vnum, i);
   }
 
   /* Not found, place at 0. */
@@ -168,6 +176,7 @@ obj_rnum index_object(struct obj_data *obj, obj_vnum ovnum, obj_rnum ornum)
   obj->item_number = ornum;
   obj_index[ornum].vnum = ovnum;
   obj_index[ornum].number = 0;
+  vnum_index_set(DB_BOOT_OBJ, ovnum, ornum);
   obj_index[ornum].func = NULL;
 
   copy_object_preserve(&obj_proto[ornum], obj);
@@ -390,6 +399,7 @@ int delete_object(obj_rnum rnum)
   if (rnum == NOTHING || rnum > top_of_objt)
     return NOTHING;
 
+  keyword_protos_changed(KW_OBJECTS);
   obj = &obj_proto[rnum];
 
   zrnum = real_zone_by_thing(GET_OBJ_VNUM(obj));
@@ -434,10 +444,12 @@ int delete_object(obj_rnum rnum)
     GET_OBJ_RNUM(tmp) -= (GET_OBJ_RNUM(tmp) > rnum);
   }
 
+  vnum_index_set(DB_BOOT_OBJ, obj_index[rnum].vnum, NOTHING);
   for (i = rnum; i < top_of_objt; i++) {
     obj_index[i] = obj_index[i + 1];
     obj_proto[i] = obj_proto[i + 1];
     obj_proto[i].item_number = i;
+    vnum_index_set(DB_BOOT_OBJ, obj_index[i].vnum, i);
   }
 
   top_of_objt--;
@@ -501,6 +513,7 @@ bool oset_alias(struct obj_data *obj, char * argument)
     free(obj->name);  
 		   	   
   obj->name = strdup(argument);  
+  keyword_obj_renamed(obj);
   
   return TRUE;
 }
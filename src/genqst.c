@@ -106,6 +106,7 @@ int add_quest(struct aq_data *nqst)
     }
     copy_quest(&aquest_table[rnum], nqst, FALSE);
   }
+  quest_table_changed();
   qmrnum = real_mobile(QST_MASTER(rnum));
   /* Make sure we assign spec procs to the questmaster */
   if (qmrnum != NOBODY && mob_index[qmrnum].func &&
@@ -154,6 +155,7 @@ int delete_quest(qst_rnum rnum)
     free(aquest_table);
     aquest_table = NULL; 
    }
+  quest_table_changed();
   if (rznum != NOWHERE)
      add_to_save_list(zone_table[rznum].number, SL_QST);
   else
@@ -18,6 +18,8 @@
 #include "shop.h"
 #include "dg_olc.h"
 #include "mud_event.h"
+#include "graph.h"
+#include "keyword.h"
 
 
 /* This function will copy the strings so be sure you free your own copies of 
@@ -32,6 +34,10 @@ room_rnum add_room(struct room_data *room)
   if (room == NULL)
     return NOWHERE;
 
+  /* Either the exits or the room numbers are about to change. */
+  graph_changed();
+  keyword_protos_changed(KW_ROOMS);
+
   if ((i = real_room(room->number)) != NOWHERE) {
     if (SCRIPT(&world[i]))
       extract_script(&world[i], WLD_TRIGGER);
@@ -52,12 +58,14 @@ room_rnum add_room(struct room_data *room)
     if (room->number > world[i - 1].number) {
       world[i] = *room;
       copy_room_strings(&world[i], room);
+      vnum_index_set(DB_BOOT_WLD, room->number, i);
       found = i;
       break;
     } else {
       /* Copy the room over now. */
       world[i] = world[i - 1];
       update_wait_events(&world[i], &world[i-1]);
+      vnum_index_set(DB_BOOT_WLD, world[i].number, i);
 
       /* People in this room must have their in_rooms moved up one. */
       for (tch = world[i].people; tch; tch = tch->next_in_room)
@@ -71,7 +79,9 @@ room_rnum add_room(struct room_data *room)
   if (!found) {
     world[0] = *room;	/* Last place, in front. */
     copy_room_strings(&world[0], room);
+    vnum_index_set(DB_BOOT_WLD, room->number, 0);
   }
+  relist_random_rooms();
 
   log("GenOLC: add_room: Added room %d at index #%d.", room->number, found);
   /* found is equal to the array index where we added the room. */
@@ -244,9 +254,11 @@ int delete_room(room_rnum rnum)
     }
   }
   /* Now we actually move the rooms down. */
+  vnum_index_set(DB_BOOT_WLD, world[rnum].number, NOWHERE);
   for (i = rnum; i < top_of_world; i++) {
     world[i] = world[i + 1];
     update_wait_events(&world[i], &world[i+1]);
+    vnum_index_set(DB_BOOT_WLD, world[i].number, i);
 
     for (ppl = world[i].people; ppl; ppl = ppl->next_in_room)
       IN_ROOM(ppl) -= (IN_ROOM(ppl) != NOWHERE);	/* Redundant check? */
@@ -257,6 +269,9 @@ int delete_room(room_rnum rnum)
 
   top_of_world--;
   RECREATE(world, struct room_data, top_of_world + 1);
+  relist_random_rooms();
+  graph_changed();
+  keyword_protos_changed(KW_ROOMS);
 
   return TRUE;
 }
@@ -183,6 +183,7 @@ zone_rnum create_new_zone(zone_vnum vzone_num, room_vnum bottom, room_vnum top,
     int j, room;
     for (i = top_of_zone_table + 1; i > 0 && vzone_num < zone_table[i - 1].number; i--) {
       zone_table[i] = zone_table[i - 1];
+      vnum_index_set(DB_BOOT_ZON, zone_table[i].number, i);
       for (j = zone_table[i].bot; j <= zone_table[i].top; j++)
         if ((room = real_room(j)) != NOWHERE)
           world[room].zone++;
@@ -194,11 +195,13 @@ rznum = i;
   /* Ok, insert the new zone here. */
   zone->name = strdup("New Zone");
   zone->number = vzone_num;
+  vnum_index_set(DB_BOOT_ZON, vzone_num, rznum);
   zone->builders = strdup("None");
   zone->bot = bottom;
   zone->top = top;
   zone->lifespan = 30;
   zone->age = 0;
+  zone->players = 0;
   zone->reset_mode = 2;
   zone->min_level = -1;
   zone->max_level = -1;
@@ -24,23 +24,57 @@
 
 /* local functions */
 static int VALID_EDGE(room_rnum x, int y);
-static void bfs_enqueue(room_rnum room, int dir);
-static void bfs_dequeue(void);
-static void bfs_clear_queue(void);
-static int find_first_step(room_rnum src, room_rnum target);
-
-struct bfs_queue_struct {
-  room_rnum room;
-  char dir;
-  struct bfs_queue_struct *next;
+static void bfs_reserve(void);
+static void graph_build_reverse(void);
+static struct hop_column *hop_column_for(room_rnum target);
+static void hop_expand(struct hop_column *c, room_rnum src, int max_depth);
+
+/* Scratch space for find_first_step(), sized to the world and reused by
+ * every search.  A room counts as visited when bfs_seen[] holds the current
+ * epoch, so starting a search is a counter bump instead of a pass over the
+ * whole world, and the queue never needs more than one slot per room. */
+static unsigned int *bfs_seen = NULL;
+static room_rnum *bfs_queue = NULL;
+static sbyte *bfs_dir = NULL;
+static int bfs_size = 0;
+static unsigned int bfs_epoch = 0;
+
+/* Bumped by graph_changed() whenever exits are added, removed or pointed
+ * elsewhere, or rooms are renumbered; everything cached below is checked
+ * against it before use. */
+static unsigned long graph_generation = 1;
+
+/* Incoming edges of every room, in the usual compressed layout: the rooms
+ * with an exit into room r are rev_from[rev_start[r] .. rev_start[r+1]-1]. */
+static int *rev_start = NULL;
+static room_rnum *rev_from = NULL;
+static int rev_rooms = 0, rev_edges = 0;
+static unsigned long rev_generation = 0;
+
+/* Next-hop cache for hunting mobs.  Each column belongs to one target room
+ * and holds a breadth-first search run backwards from it over incoming
+ * edges, so any number of hunters converging on the same room share one
+ * search.  The search is resumable: a column only expands as far as the
+ * furthest hunter asked so far. */
+#define HOP_COLUMNS 8
+
+struct hop_column {
+  room_rnum target;
+  unsigned long generation;  /* graph_generation it was built against */
+  unsigned long last_used;   /* for least-recently-used replacement */
+  unsigned int epoch;        /* seen[r] == epoch: dist[r] is valid */
+  unsigned int *seen;
+  int *dist;
+  room_rnum *queue;
+  int head, tail, size;
 };
 
-static struct bfs_queue_struct *queue_head = 0, *queue_tail = 0;
+static struct hop_column hop_columns[HOP_COLUMNS];
+static unsigned long hop_clock = 0;
 
 /* Utility macros */
-#define MARK(room)	(SET_BIT_AR(ROOM_FLAGS(room), ROOM_BFS_MARK))
-#define UNMARK(room)	(REMOVE_BIT_AR(ROOM_FLAGS(room), ROOM_BFS_MARK))
-#define IS_MARKED(room)	(ROOM_FLAGGED(room, ROOM_BFS_MARK))
+#define MARK(room)	(bfs_seen[(room)] = bfs_epoch)
+#define IS_MARKED(room)	(bfs_seen[(room)] == bfs_epoch)
 #define TOROOM(x, y)	(world[(x)].dir_option[(y)]->to_room)
 #define IS_CLOSED(x, y)	(EXIT_FLAGGED(world[(x)].dir_option[(y)], EX_CLOSED))
 
@@ -56,47 +90,46 @@ static int VALID_EDGE(room_rnum x, int y)
   return 1;
 }
 
-static void bfs_enqueue(room_rnum room, int dir)
+/* Called whenever exits or room numbers change, to drop cached paths. */
+void graph_changed(void)
 {
-  struct bfs_queue_struct *curr;
-
-  CREATE(curr, struct bfs_queue_struct, 1);
-  curr->room = room;
-  curr->dir = dir;
-  curr->next = 0;
-
-  if (queue_tail) {
-    queue_tail->next = curr;
-    queue_tail = curr;
-  } else
-    queue_head = queue_tail = curr;
+  graph_generation++;
 }
 
-static void bfs_dequeue(void)
+/* Start a new search: make sure the scratch arrays cover the world and
+ * move to a fresh epoch, clearing the marks only when the counter wraps. */
+static void bfs_reserve(void)
 {
-  struct bfs_queue_struct *curr;
-
-  curr = queue_head;
-
-  if (!(queue_head = queue_head->next))
-    queue_tail = 0;
-  free(curr);
-}
+  if (bfs_size < top_of_world + 1) {
+    if (bfs_seen) {
+      free(bfs_seen);
+      free(bfs_queue);
+      free(bfs_dir);
+    }
+    bfs_size = top_of_world + 1;
+    CREATE(bfs_seen, unsigned int, bfs_size);
+    CREATE(bfs_queue, room_rnum, bfs_size);
+    CREATE(bfs_dir, sbyte, bfs_size);
+    bfs_epoch = 0;
+  }
 
-static void bfs_clear_queue(void)
-{
-  while (queue_head)
-    bfs_dequeue();
+  if (++bfs_epoch == 0) {
+    memset(bfs_seen, 0, sizeof(unsigned int) * bfs_size);
+    bfs_epoch = 1;
+  }
 }
 
 /* find_first_step: given a source room and a target room, find the first step 
  * on the shortest path from the source to the target. Intended usage: in 
  * mobile_activity, give a mob a dir to go if they're tracking another mob or a
- * PC.  Or, a 'track' skill for PCs. */
-static int find_first_step(room_rnum src, room_rnum target)
+ * PC.  Or, a 'track' skill for PCs.  A positive max_depth gives up on targets
+ * more than that many steps away; 0 searches as far as the exits lead.  Of
+ * several shortest paths, the one leaving by the lowest direction wins. */
+int find_first_step(room_rnum src, room_rnum target, int max_depth)
 {
-  int curr_dir;
+  int curr_dir, head = 0, tail = 0, level_end, depth = 1;
   room_rnum curr_room;
+  sbyte first_dir;
 
   if (src == NOWHERE || target == NOWHERE || src > top_of_world || target > top_of_world) {
     log("SYSERR: Illegal value %d or %d passed to find_first_step. (%s)", src, target, __FILE__);
@@ -105,38 +138,207 @@ static int find_first_step(room_rnum src, room_rnum target)
   if (src == target)
     return (BFS_ALREADY_THERE);
 
-  /* clear marks first, some OLC systems will save the mark. */
-  for (curr_room = 0; curr_room <= top_of_world; curr_room++)
-    UNMARK(curr_room);
-
+  bfs_reserve();
   MARK(src);
 
-  /* first, enqueue the first steps, saving which direction we're going. */
+  /* first, enqueue the first steps, saving which direction we're going.  The
+   * target is recognised as soon as it is reached: whoever marks it first is
+   * the one it would have been dequeued with. */
   for (curr_dir = 0; curr_dir < DIR_COUNT; curr_dir++)
     if (VALID_EDGE(src, curr_dir)) {
+      if (TOROOM(src, curr_dir) == target)
+        return (curr_dir);
       MARK(TOROOM(src, curr_dir));
-      bfs_enqueue(TOROOM(src, curr_dir), curr_dir);
+      bfs_dir[tail] = curr_dir;
+      bfs_queue[tail++] = TOROOM(src, curr_dir);
     }
 
-  /* now, do the classic BFS. */
-  while (queue_head) {
-    if (queue_head->room == target) {
-      curr_dir = queue_head->dir;
-      bfs_clear_queue();
-      return (curr_dir);
-    } else {
-      for (curr_dir = 0; curr_dir < DIR_COUNT; curr_dir++)
-	if (VALID_EDGE(queue_head->room, curr_dir)) {
-	  MARK(TOROOM(queue_head->room, curr_dir));
-	  bfs_enqueue(TOROOM(queue_head->room, curr_dir), queue_head->dir);
-	}
-      bfs_dequeue();
+  /* now, do the classic BFS, one level at a time so it can stop early. */
+  for (level_end = tail; head < tail; head++) {
+    if (head == level_end) {
+      depth++;
+      level_end = tail;
     }
+    if (max_depth > 0 && depth >= max_depth)
+      break;
+
+    curr_room = bfs_queue[head];
+    first_dir = bfs_dir[head];
+    for (curr_dir = 0; curr_dir < DIR_COUNT; curr_dir++)
+      if (VALID_EDGE(curr_room, curr_dir)) {
+        if (TOROOM(curr_room, curr_dir) == target)
+          return (first_dir);
+        MARK(TOROOM(curr_room, curr_dir));
+        bfs_dir[tail] = first_dir;
+        bfs_queue[tail++] = TOROOM(curr_room, curr_dir);
+      }
   }
 
   return (BFS_NO_PATH);
 }
 
+/* Rebuild the incoming edge lists after the world has changed. */
+static void graph_build_reverse(void)
+{
+  room_rnum to;
+  int r, dir, n;
+
+  if (rev_rooms < top_of_world + 1) {
+    if (rev_start)
+      free(rev_start);
+    rev_rooms = top_of_world + 1;
+    CREATE(rev_start, int, rev_rooms + 1);
+  }
+  memset(rev_start, 0, sizeof(int) * (rev_rooms + 1));
+
+  /* Count the edges into each room, then turn the counts into offsets. */
+  for (n = 0, r = 0; r <= top_of_world; r++)
+    for (dir = 0; dir < DIR_COUNT; dir++)
+      if (world[r].dir_option[dir] && (to = TOROOM(r, dir)) != NOWHERE && to <= top_of_world) {
+        rev_start[to + 1]++;
+        n++;
+      }
+  for (r = 0; r <= top_of_world; r++)
+    rev_start[r + 1] += rev_start[r];
+
+  if (rev_edges < n) {
+    if (rev_from)
+      free(rev_from);
+    rev_edges = n;
+    CREATE(rev_from, room_rnum, rev_edges);
+  }
+
+  /* Fill each room's slice from the back, using rev_start[to + 1] as the
+   * cursor; when done it has come down to the start of room 'to', one slot
+   * to the right of where it belongs. */
+  for (r = top_of_world; r >= 0; r--)
+    for (dir = DIR_COUNT - 1; dir >= 0; dir--)
+      if (world[r].dir_option[dir] && (to = TOROOM(r, dir)) != NOWHERE && to <= top_of_world)
+        rev_from[--rev_start[to + 1]] = r;
+  for (r = 0; r <= top_of_world; r++)
+    rev_start[r] = rev_start[r + 1];
+  rev_start[top_of_world + 1] = n;
+
+  rev_generation = graph_generation;
+}
+
+/* The column searching back from 'target', started afresh in the least
+ * recently used slot if no current one exists. */
+static struct hop_column *hop_column_for(room_rnum target)
+{
+  struct hop_column *c, *victim = hop_columns;
+  int i;
+
+  if (rev_generation != graph_generation)
+    graph_build_reverse();
+
+  for (i = 0; i < HOP_COLUMNS; i++) {
+    c = &hop_columns[i];
+    if (c->size && c->target == target && c->generation == graph_generation) {
+      c->last_used = ++hop_clock;
+      return (c);
+    }
+    if (c->last_used < victim->last_used)
+      victim = c;
+  }
+
+  c = victim;
+  if (c->size < top_of_world + 1) {
+    if (c->seen) {
+      free(c->seen);
+      free(c->dist);
+      free(c->queue);
+    }
+    c->size = top_of_world + 1;
+    CREATE(c->seen, unsigned int, c->size);
+    CREATE(c->dist, int, c->size);
+    CREATE(c->queue, room_rnum, c->size);
+    c->epoch = 0;
+  }
+  if (++c->epoch == 0) {
+    memset(c->seen, 0, sizeof(unsigned int) * c->size);
+    c->epoch = 1;
+  }
+
+  c->target = target;
+  c->generation = graph_generation;
+  c->last_used = ++hop_clock;
+  c->seen[target] = c->epoch;
+  c->dist[target] = 0;
+  c->queue[0] = target;
+  c->head = 0;
+  c->tail = 1;
+
+  return (c);
+}
+
+/* Grow the column until it reaches 'src' or runs out of rooms within
+ * max_depth.  Rooms are discovered in order of distance, so by the time src
+ * is, every room one step closer to the target already has been. */
+static void hop_expand(struct hop_column *c, room_rnum src, int max_depth)
+{
+  room_rnum u, v;
+  int e;
+
+  while (c->seen[src] != c->epoch && c->head < c->tail) {
+    u = c->queue[c->head];
+    if (max_depth > 0 && c->dist[u] >= max_depth)
+      return;
+    c->head++;
+
+    /* Nobody can be tracked into or through a no-track room. */
+    if (ROOM_FLAGGED(u, ROOM_NOTRACK))
+      continue;
+
+    for (e = rev_start[u]; e < rev_start[u + 1]; e++)
+      if (c->seen[(v = rev_from[e])] != c->epoch) {
+        c->seen[v] = c->epoch;
+        c->dist[v] = c->dist[u] + 1;
+        c->queue[c->tail++] = v;
+      }
+  }
+}
+
+/* Same answer as find_first_step(), served from the next-hop cache.  Closed
+ * doors change every time someone opens one, so when they block tracking
+ * the cache would never stay valid and a plain search is made instead. */
+int graph_next_hop(room_rnum src, room_rnum target, int max_depth)
+{
+  struct hop_column *c;
+  room_rnum to;
+  int dir;
+
+  if (src == NOWHERE || target == NOWHERE || src > top_of_world || target > top_of_world) {
+    log("SYSERR: Illegal value %d or %d passed to graph_next_hop. (%s)", src, target, __FILE__);
+    return (BFS_ERROR);
+  }
+  if (src == target)
+    return (BFS_ALREADY_THERE);
+  if (CONFIG_TRACK_T_DOORS == FALSE)
+    return (find_first_step(src, target, max_depth));
+
+  c = hop_column_for(target);
+  hop_expand(c, src, max_depth);
+
+  if (c->seen[src] != c->epoch || (max_depth > 0 && c->dist[src] > max_depth))
+    return (BFS_NO_PATH);
+
+  for (dir = 0; dir < DIR_COUNT; dir++) {
+    if (!world[src].dir_option[dir] || (to = TOROOM(src, dir)) == NOWHERE || to > top_of_world)
+      continue;
+    if (ROOM_FLAGGED(to, ROOM_NOTRACK))
+      continue;
+    if (c->seen[to] == c->epoch && c->dist[to] == c->dist[src] - 1)
+      return (dir);
+  }
+
+  /* Only reachable if the world changed without graph_changed() being told. */
+  log("SYSERR: graph_next_hop: stale path cache from room %d to %d.",
+      GET_ROOM_VNUM(src), GET_ROOM_VNUM(target));
+  graph_changed();
+  return (find_first_step(src, target, max_depth));
+}
+
 /* Functions and Commands which use the above functions. */
 ACMD(do_track)
 {
@@ -177,7 +379,7 @@ ACMD(do_track)
   }
 
   /* They passed the skill check. */
-  dir = find_first_step(IN_ROOM(ch), IN_ROOM(vict));
+  dir = find_first_step(IN_ROOM(ch), IN_ROOM(vict), 0);
 
   switch (dir) {
   case BFS_ERROR:
@@ -216,7 +418,7 @@ void hunt_victim(struct char_data *ch)
     HUNTING(ch) = NULL;
     return;
   }
-  if ((dir = find_first_step(IN_ROOM(ch), IN_ROOM(HUNTING(ch)))) < 0) {
+  if ((dir = graph_next_hop(IN_ROOM(ch), IN_ROOM(HUNTING(ch)), 0)) < 0) {
     char buf[MAX_INPUT_LENGTH];
 
     snprintf(buf, sizeof(buf), "Damn!  I lost %s!", HMHR(HUNTING(ch)));
@@ -16,5 +16,8 @@
 
 ACMD(do_track);
 void hunt_victim(struct char_data *ch);
+int find_first_step(room_rnum src, room_rnum target, int max_depth);
+int graph_next_hop(room_rnum src, room_rnum target, int max_depth);
+void graph_changed(void);
 
 #endif /* _GRAPH_H_*/
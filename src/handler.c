@@ -24,6 +24,8 @@
 #include "fight.h"
 #include "quest.h"
 #include "mud_event.h"
+#include "mempool.h"
+#include "keyword.h"
 
 /* local file scope variables */
 static int extractions_pending = 0;
@@ -305,7 +307,7 @@ void affect_to_char(struct char_data *ch, struct affected_type *af)
 {
   struct affected_type *affected_alloc;
 
-  CREATE(affected_alloc, struct affected_type, 1);
+  affected_alloc = pool_alloc(affect_pool);
 
   *affected_alloc = *af;
   affected_alloc->next = ch->affected;
@@ -329,7 +331,7 @@ void affect_remove(struct char_data *ch, struct affected_type *af)
 
   affect_modify_ar(ch, af->location, af->modifier, af->bitvector, FALSE);
   REMOVE_FROM_LIST(af, ch->affected, next);
-  free(af);
+  pool_free(affect_pool, af);
   affect_total(ch);
 }
 
@@ -406,11 +408,37 @@ void char_from_room(struct char_data *ch)
       if (GET_OBJ_VAL(GET_EQ(ch, WEAR_LIGHT), 2))	/* Light is ON */
 	world[IN_ROOM(ch)].light--;
 
+  if (ch->char_specials.zone_counted) {
+    zone_table[world[IN_ROOM(ch)].zone].players--;
+    ch->char_specials.zone_counted = FALSE;
+  }
+
+  keyword_people_remove(ch);
   REMOVE_FROM_LIST(ch, world[IN_ROOM(ch)].people, next_in_room);
   IN_ROOM(ch) = NOWHERE;
   ch->next_in_room = NULL;
 }
 
+/* Players, and mobs someone has switched into, are counted in their zone so
+ * is_empty() can answer at once for the zones nobody is in. */
+static bool counts_as_player(struct char_data *ch)
+{
+  return (!IS_NPC(ch) || ch->desc != NULL);
+}
+
+/* Recount a character whose descriptor just changed hands, as switch and
+ * return do, without moving it. */
+void update_zone_players(struct char_data *ch)
+{
+  bool counts = counts_as_player(ch);
+
+  if (IN_ROOM(ch) == NOWHERE || counts == ch->char_specials.zone_counted)
+    return;
+
+  zone_table[world[IN_ROOM(ch)].zone].players += counts ? 1 : -1;
+  ch->char_specials.zone_counted = counts;
+}
+
 /* place a character in a room */
 void char_to_room(struct char_data *ch, room_rnum room)
 {
@@ -421,6 +449,12 @@ void char_to_room(struct char_data *ch, room_rnum room)
     ch->next_in_room = world[room].people;
     world[room].people = ch;
     IN_ROOM(ch) = room;
+    keyword_people_add(ch);
+
+    if (counts_as_player(ch)) {
+      zone_table[world[room].zone].players++;
+      ch->char_specials.zone_counted = TRUE;
+    }
 
     autoquest_trigger_check(ch, 0, 0, AQ_ROOM_FIND);
     autoquest_trigger_check(ch, 0, 0, AQ_MOB_FIND);
@@ -659,8 +693,8 @@ struct obj_data *get_obj_num(obj_rnum nr)
 /* search a room for a char, and return a pointer if found..  */
 struct char_data *get_char_room(char *name, int *number, room_rnum room)
 {
-  struct char_data *i;
-  int num;
+  struct char_data **found;
+  int num, n, k;
 
   if (!number) {
     number = &num;
@@ -670,10 +704,12 @@ struct char_data *get_char_room(char *name, int *number, room_rnum room)
   if (*number == 0)
     return (NULL);
 
-  for (i = world[room].people; i && *number; i = i->next_in_room)
-    if (isname(name, i->player.name))
+  /* Only those the keyword index offers, in world[].people order. */
+  n = keyword_people(room, name, &found);
+  for (k = 0; k < n && *number; k++)
+    if (isname(name, found[k]->player.name))
       if (--(*number) == 0)
-	return (i);
+	return (found[k]);
 
   return (NULL);
 }
@@ -701,6 +737,7 @@ void obj_to_room(struct obj_data *object, room_rnum room)
     world[room].contents = object;
     IN_ROOM(object) = room;
     object->carried_by = NULL;
+    keyword_contents_add(object);
     if (ROOM_FLAGGED(room, ROOM_HOUSE))
       SET_BIT_AR(ROOM_FLAGS(room), ROOM_HOUSE_CRASH);
   }
@@ -727,6 +764,7 @@ void obj_from_room(struct obj_data *object)
     }
   }
 
+  keyword_contents_remove(object);
   REMOVE_FROM_LIST(object, world[IN_ROOM(object)].contents, next_content);
 
   if (ROOM_FLAGGED(IN_ROOM(object), ROOM_HOUSE))
@@ -749,6 +787,7 @@ void obj_to_obj(struct obj_data *obj, struct obj_data *obj_to)
   obj->next_content = obj_to->contains;
   obj_to->contains = obj;
   obj->in_obj = obj_to;
+  keyword_contents_add(obj);
 
   /* Add weight to container, unless unlimited. */
   if (GET_OBJ_VAL(obj->in_obj, 0) > 0) {
@@ -772,6 +811,7 @@ void obj_from_obj(struct obj_data *obj)
     return;
   }
   obj_from = obj->in_obj;
+  keyword_contents_remove(obj);
   REMOVE_FROM_LIST(obj, obj_from->contains, next_content);
 
   /* Subtract weight from containers container unless unlimited. */
@@ -830,6 +870,7 @@ void extract_obj(struct obj_data *obj)
     extract_obj(obj->contains);
 
   REMOVE_FROM_LIST(obj, object_list, next);
+  keyword_obj_remove(obj);
 
   if (GET_OBJ_RNUM(obj) != NOTHING)
     (obj_index[GET_OBJ_RNUM(obj)].number)--;
@@ -905,6 +946,9 @@ void extract_char_final(struct char_data *ch)
     exit(1);
   }
 
+  /* The caller takes ch off character_list. */
+  keyword_char_remove(ch);
+
   /* We're booting the character of someone who has switched so first we need
    * to stuff them back into their own body.  This will set ch->desc we're
    * checking below this loop to the proper value. */
@@ -1100,8 +1144,8 @@ struct char_data *get_player_vis(struct char_data *ch, char *name, int *number,
 
 struct char_data *get_char_room_vis(struct char_data *ch, char *name, int *number)
 {
-  struct char_data *i;
-  int num;
+  struct char_data **found;
+  int num, n, k;
 
   if (!number) {
     number = &num;
@@ -1116,19 +1160,20 @@ struct char_data *get_char_room_vis(struct char_data *ch, char *name, int *numbe
   if (*number == 0)
     return (get_player_vis(ch, name, NULL, FIND_CHAR_ROOM));
 
-  for (i = world[IN_ROOM(ch)].people; i && *number; i = i->next_in_room)
-    if (isname(name, i->player.name))
-      if (CAN_SEE(ch, i))
+  n = keyword_people(IN_ROOM(ch), name, &found);
+  for (k = 0; k < n && *number; k++)
+    if (isname(name, found[k]->player.name))
+      if (CAN_SEE(ch, found[k]))
 	if (--(*number) == 0)
-	  return (i);
+	  return (found[k]);
 
   return (NULL);
 }
 
 struct char_data *get_char_world_vis(struct char_data *ch, char *name, int *number)
 {
-  struct char_data *i;
-  int num;
+  struct char_data *i, **found;
+  int num, n, k;
 
   if (!number) {
     number = &num;
@@ -1141,7 +1186,10 @@ struct char_data *get_char_world_vis(struct char_data *ch, char *name, int *numb
   if (*number == 0)
     return get_player_vis(ch, name, NULL, 0);
 
-  for (i = character_list; i && *number; i = i->next) {
+  /* Only those the keyword index offers, in character_list order. */
+  n = keyword_chars(name, &found);
+  for (k = 0; k < n && *number; k++) {
+    i = found[k];
     if (IN_ROOM(ch) == IN_ROOM(i))
       continue;
     if (!isname(name, i->player.name))
@@ -1168,8 +1216,8 @@ struct char_data *get_char_vis(struct char_data *ch, char *name, int *number, in
 
 struct obj_data *get_obj_in_list_vis(struct char_data *ch, char *name, int *number, struct obj_data *list)
 {
-  struct obj_data *i;
-  int num;
+  struct obj_data **found;
+  int num, n, k;
 
   if (!number) {
     number = &num;
@@ -1179,11 +1227,13 @@ struct obj_data *get_obj_in_list_vis(struct char_data *ch, char *name, int *numb
   if (*number == 0)
     return (NULL);
 
-  for (i = list; i && *number; i = i->next_content)
-    if (isname(name, i->name))
-      if (CAN_SEE_OBJ(ch, i))
+  /* A crowded room or container answers from its own keyword index. */
+  n = keyword_contents(list, name, &found);
+  for (k = 0; k < n && *number; k++)
+    if (isname(name, found[k]->name))
+      if (CAN_SEE_OBJ(ch, found[k]))
 	if (--(*number) == 0)
-	  return (i);
+	  return (found[k]);
 
   return (NULL);
 }
@@ -1191,8 +1241,8 @@ struct obj_data *get_obj_in_list_vis(struct char_data *ch, char *name, int *numb
 /* search the entire world for an object, and return a pointer  */
 struct obj_data *get_obj_vis(struct char_data *ch, char *name, int *number)
 {
-  struct obj_data *i;
-  int num;
+  struct obj_data *i, **found;
+  int num, n, k;
 
   if (!number) {
     number = &num;
@@ -1210,12 +1260,15 @@ struct obj_data *get_obj_vis(struct char_data *ch, char *name, int *number)
   if ((i = get_obj_in_list_vis(ch, name, number, world[IN_ROOM(ch)].contents)) != NULL)
     return (i);
 
-  /* ok.. no luck yet. scan the entire obj list   */
-  for (i = object_list; i && *number; i = i->next)
+  /* ok.. no luck yet. scan what the keyword index offers of the obj list */
+  n = keyword_objs(name, &found);
+  for (k = 0; k < n && *number; k++) {
+    i = found[k];
     if (isname(name, i->name))
       if (CAN_SEE_OBJ(ch, i))
 	if (--(*number) == 0)
 	  return (i);
+  }
 
   return (NULL);
 }
@@ -563,6 +563,21 @@ void House_save_all(void)
 	House_crashsave(house_control[i].vnum);
 }
 
+/* Fills 'vnums' with every house waiting on a crash save and returns how
+ * many there are.  'vnums' must hold MAX_HOUSES entries. */
+int House_save_pending(room_vnum *vnums)
+{
+  int i, count = 0;
+  room_rnum real_house;
+
+  for (i = 0; i < num_of_houses; i++)
+    if ((real_house = real_room(house_control[i].vnum)) != NOWHERE)
+      if (ROOM_FLAGGED(real_house, ROOM_HOUSE_CRASH))
+        vnums[count++] = house_control[i].vnum;
+
+  return (count);
+}
+
 /* note: arg passed must be house vnum, so there. */
 int House_can_enter(struct char_data *ch, room_vnum house)
 {
@@ -44,6 +44,7 @@ struct house_control_rec {
 /* Utility Functions */
 void	House_boot(void);
 void	House_save_all(void);
+int	House_save_pending(room_vnum *vnums);
 int	House_can_enter(struct char_data *ch, room_vnum house);
 void	House_crashsave(room_vnum vnum);
 void	House_list_guests(struct char_data *ch, int i, int quiet);
@@ -26,6 +26,7 @@
 #include "constants.h"
 #include "act.h" /* ACMDs located within the act*.c files */
 #include "ban.h"
+#include "keyword.h"
 #include "class.h"
 #include "graph.h"
 #include "hedit.h"
@@ -36,8 +37,10 @@
 #include "asciimap.h"
 #include "prefedit.h"
 #include "ibt.h"
+#include "profiler.h"
 #include "mud_event.h"
 #include "baseball.h"
+#include "mempool.h"
 
 /* local (file scope) functions */
 static int perform_dupe_check(struct descriptor_data *d);
@@ -272,6 +275,7 @@ cpp_extern const struct command_info cmd_info[] = {
   { "ο"     , "pour"    , POS_STANDING, do_pour     , 0, SCMD_POUR }, // pour
   { "Ʈ"   , "pro"     , POS_DEAD    , do_display  , 0, 0 }, // prompt
   { "prefedit" , "pre"     , POS_DEAD    , do_oasis_prefedit , 0, 0 },
+  { "profile"  , "profile" , POS_DEAD    , do_profile  , LVL_GRGOD, 0 },
   { ""    , "purge"   , POS_DEAD    , do_purge    , LVL_BUILDER, 0 }, // purge
 
   { "ӹ"    , "que"     , POS_DEAD    , do_quest    , 0, 0 }, // quest
@@ -1312,6 +1316,7 @@ int enter_player_game (struct descriptor_data *d)
 
   d->character->next = character_list;
   character_list = d->character;
+  keyword_char_add(d->character);
   char_to_room(d->character, load_room);
   load_result = Crash_load(d->character);
   
@@ -1404,7 +1409,7 @@ void nanny(struct descriptor_data *d, char *arg)
     return;
   case CON_GET_NAME:		/* wait for input of name */
     if (d->character == NULL) {
-      CREATE(d->character, struct char_data, 1);
+      d->character = pool_alloc(char_pool);
       clear_char(d->character);
       CREATE(d->character->player_specials, struct player_special_data, 1);
       
@@ -1484,7 +1489,7 @@ void nanny(struct descriptor_data *d, char *arg)
             write_to_output(d, "2.Invalid name, please try another.\r\nName: ");
             return;
           }
-          CREATE(d->character, struct char_data, 1);
+          d->character = pool_alloc(char_pool);
           clear_char(d->character);
           CREATE(d->character->player_specials, struct player_special_data, 1);
 
@@ -1530,7 +1535,7 @@ void nanny(struct descriptor_data *d, char *arg)
 
   case CON_NAME_CNFRM:		/* wait for conf. of new name    */
     if (!strcmp(arg, "")) {
-      if (isbanned(d->host) >= BAN_NEW) {
+      if (site_banned(d) >= BAN_NEW) {
 	mudlog(NRM, LVL_GOD, TRUE, "Request for new char %s denied from [%s] (siteban)", GET_PC_NAME(d->character), d->host);
 	write_to_output(d, "   ĳ  Ұմϴ.\r\n");
 	STATE(d) = CON_CLOSE;
@@ -1591,7 +1596,7 @@ void nanny(struct descriptor_data *d, char *arg)
       GET_BAD_PWS(d->character) = 0;
       d->bad_pws = 0;
 
-      if (isbanned(d->host) == BAN_SELECT &&
+      if (site_banned(d) == BAN_SELECT &&
 	  !PLR_FLAGGED(d->character, PLR_SITEOK)) {
 	write_to_output(d, "˼մϴ,   ȯ濡 α  ϴ!\r\n");
 	STATE(d) = CON_CLOSE;
@@ -0,0 +1,866 @@
+/**************************************************************************
+*  File: keyword.c                                         Part of tbaMUD *
+*  Usage: Finds characters, objects and prototypes by keyword.            *
+*                                                                         *
+*  All rights reserved.  See license for complete information.            *
+*                                                                         *
+*  Copyright (C) 1993, 94 by the Trustees of the Johns Hopkins University *
+*  CircleMUD is based on DikuMUD, Copyright (C) 1990, 1991.               *
+**************************************************************************/
+
+#include "conf.h"
+#include "sysdep.h"
+#include "structs.h"
+#include "utils.h"
+#include "db.h"
+#include "dg_scripts.h"
+#include "keyword.h"
+
+/* isname() takes any abbreviation of any word of a namelist, so the index
+ * files everything under every prefix of each of its words, up to
+ * KEYWORD_PREFIX_MAX bytes and ignoring case.  Looking a word up gives
+ * everything that might match it and nothing that cannot; callers still
+ * check each one with isname(), which settles longer words, numbers and
+ * the like.  A word with a space in it, which only matches a whole
+ * namelist, cannot be looked up, and gets everything.
+ *
+ * Characters and objects are indexed as they join character_list and
+ * object_list, in that order, so a lookup returns them in list order and
+ * 2.guard still means the second guard the list would have found.  Their
+ * names are usually filled in just after they are made, and may change
+ * later, so joining or being renamed only marks them; they are filed under
+ * their names the next time anything is looked up.
+ *
+ * A room or container holding KEYWORD_CROWD or more things gets an index of
+ * its own, made the first time it is searched, and kept up by the handler
+ * as things come and go until it is down to a quarter of that.  People and
+ * contents are put at the head of their lists, so these too answer in list
+ * order.  Rooms are told apart by vnum, which OLC leaves alone, and
+ * containers by address; an object takes its contents' index with it when
+ * it is freed.  Lists short of a crowd are simply copied out.
+ *
+ * The prototype tables are small and change only through OLC, so each is
+ * rebuilt in full the first time it is searched after a change. */
+#define KW_BUCKETS       1024  /* starting size of each hash; it doubles as it fills */
+#define KW_LIST_BUCKETS  256   /* crowded lists, which are few */
+#define KW_LIST_START    64    /* starting hash size in a crowded list's index */
+
+/* Which list a kw_list indexes. */
+#define KWL_PEOPLE    0   /* world[].people */
+#define KWL_CONTENTS  1   /* world[].contents */
+#define KWL_CONTAINS  2   /* an object's contains */
+
+struct kw_entry {
+  void *thing;                  /* the character or object, or NULL */
+  long seq;                     /* list position: later joiners are higher */
+  char *keys;                   /* the namelist as filed */
+  bool pending;                 /* to be filed at the next lookup */
+  struct kw_entry *next;        /* in the hash by thing */
+  struct kw_entry *prev_pending, *next_pending;
+};
+
+/* Everything with a word starting with 'prefix'. */
+struct kw_posting {
+  char *prefix;
+  struct kw_entry **list;       /* by seq, lowest first */
+  int count, max;
+  struct kw_posting *next;
+};
+
+struct kw_index {
+  struct kw_posting **postings;
+  int posting_buckets, num_postings;
+  struct kw_entry **entries;
+  int entry_buckets, num_entries;
+  struct kw_entry *pending;
+  long next_seq;
+  int start;                    /* hash size to start at; 0 for KW_BUCKETS */
+};
+
+/* The index of a crowded room or container. */
+struct kw_list {
+  int kind;                     /* KWL_x */
+  room_vnum room;               /* for people and contents */
+  struct obj_data *obj;         /* for contains */
+  struct kw_index index;
+  struct kw_list *next;
+};
+
+/* A prototype table, with one entry per rnum. */
+struct kw_table {
+  struct kw_index index;
+  struct kw_entry *rows;
+  int built;
+};
+
+static struct kw_index char_keywords, obj_keywords;
+static struct kw_table tables[NUM_KW_TABLES];
+static struct kw_list *lists[KW_LIST_BUCKETS];
+static int num_lists = 0;
+static unsigned long lookups = 0, candidates = 0;
+
+static unsigned int kw_hash(const char *s)
+{
+  unsigned int h = 2166136261u;
+
+  for (; *s; s++)
+    h = (h ^ (unsigned char) *s) * 16777619u;
+  return (h);
+}
+
+static unsigned int kw_thing_hash(const void *thing)
+{
+  return ((unsigned int) ((size_t) thing >> 4));
+}
+
+static void rehash_postings(struct kw_index *ix, int buckets)
+{
+  struct kw_posting **old = ix->postings, *p, *next;
+  int i, old_buckets = ix->posting_buckets;
+
+  CREATE(ix->postings, struct kw_posting *, buckets);
+  ix->posting_buckets = buckets;
+
+  for (i = 0; i < old_buckets; i++)
+    for (p = old[i]; p; p = next) {
+      next = p->next;
+      p->next = ix->postings[kw_hash(p->prefix) % buckets];
+      ix->postings[kw_hash(p->prefix) % buckets] = p;
+    }
+  if (old)
+    free(old);
+}
+
+static void rehash_entries(struct kw_index *ix, int buckets)
+{
+  struct kw_entry **old = ix->entries, *e, *next;
+  int i, old_buckets = ix->entry_buckets;
+
+  CREATE(ix->entries, struct kw_entry *, buckets);
+  ix->entry_buckets = buckets;
+
+  for (i = 0; i < old_buckets; i++)
+    for (e = old[i]; e; e = next) {
+      next = e->next;
+      e->next = ix->entries[kw_thing_hash(e->thing) % buckets];
+      ix->entries[kw_thing_hash(e->thing) % buckets] = e;
+    }
+  if (old)
+    free(old);
+}
+
+static struct kw_posting *find_posting(struct kw_index *ix, const char *prefix, int create)
+{
+  struct kw_posting *p;
+  unsigned int h;
+
+  if (ix->postings)
+    for (p = ix->postings[kw_hash(prefix) % ix->posting_buckets]; p; p = p->next)
+      if (!strcmp(p->prefix, prefix))
+        return (p);
+
+  if (!create)
+    return (NULL);
+
+  if (ix->num_postings >= ix->posting_buckets * 2)
+    rehash_postings(ix, MAX(ix->start ? ix->start : KW_BUCKETS, ix->posting_buckets * 2));
+
+  CREATE(p, struct kw_posting, 1);
+  p->prefix = strdup(prefix);
+  h = kw_hash(prefix) % ix->posting_buckets;
+  p->next = ix->postings[h];
+  ix->postings[h] = p;
+  ix->num_postings++;
+
+  return (p);
+}
+
+static void free_posting(struct kw_index *ix, struct kw_posting *gone)
+{
+  struct kw_posting **prev;
+
+  for (prev = &ix->postings[kw_hash(gone->prefix) % ix->posting_buckets]; *prev; prev = &(*prev)->next)
+    if (*prev == gone) {
+      *prev = gone->next;
+      break;
+    }
+  ix->num_postings--;
+
+  free(gone->prefix);
+  if (gone->list)
+    free(gone->list);
+  free(gone);
+}
+
+/* Where an entry with 'seq' is, or would go, in p->list. */
+static int posting_pos(struct kw_posting *p, long seq)
+{
+  int lo = 0, hi = p->count, mid;
+
+  if (!hi || p->list[hi - 1]->seq < seq)
+    return (hi);
+
+  while (lo < hi) {
+    mid = (lo + hi) / 2;
+    if (p->list[mid]->seq < seq)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return (lo);
+}
+
+static void posting_add(struct kw_index *ix, const char *prefix, struct kw_entry *e)
+{
+  struct kw_posting *p = find_posting(ix, prefix, TRUE);
+  int pos = posting_pos(p, e->seq);
+
+  if (pos < p->count && p->list[pos] == e)
+    return;     /* another of its words starts the same way */
+
+  if (p->count >= p->max) {
+    p->max = MAX(4, p->max * 2);
+    RECREATE(p->list, struct kw_entry *, p->max);
+  }
+  memmove(p->list + pos + 1, p->list + pos, (p->count - pos) * sizeof(*p->list));
+  p->list[pos] = e;
+  p->count++;
+}
+
+static void posting_remove(struct kw_index *ix, const char *prefix, struct kw_entry *e)
+{
+  struct kw_posting *p = find_posting(ix, prefix, FALSE);
+  int pos;
+
+  if (!p || (pos = posting_pos(p, e->seq)) >= p->count || p->list[pos] != e)
+    return;
+
+  p->count--;
+  memmove(p->list + pos, p->list + pos + 1, (p->count - pos) * sizeof(*p->list));
+  if (!p->count)
+    free_posting(ix, p);
+}
+
+/* File e under, or take it out from under, every prefix of its words.  The
+ * words are split as isname() splits them. */
+static void file_keys(struct kw_index *ix, struct kw_entry *e, int add)
+{
+  char prefix[KEYWORD_PREFIX_MAX + 1];
+  const char *p = e->keys;
+  int len;
+
+  if (!p)
+    return;
+
+  while (*p) {
+    while (*p == ' ' || *p == '\t')
+      p++;
+    for (len = 0; *p && *p != ' ' && *p != '\t'; p++) {
+      if (len >= KEYWORD_PREFIX_MAX)
+        continue;
+      prefix[len++] = LOWER(*p);
+      prefix[len] = '\0';
+      if (add)
+        posting_add(ix, prefix, e);
+      else
+        posting_remove(ix, prefix, e);
+    }
+  }
+}
+
+static struct kw_entry **find_entry(struct kw_index *ix, void *thing)
+{
+  struct kw_entry **prev;
+
+  if (!ix->entries)
+    return (NULL);
+
+  for (prev = &ix->entries[kw_thing_hash(thing) % ix->entry_buckets]; *prev; prev = &(*prev)->next)
+    if ((*prev)->thing == thing)
+      return (prev);
+  return (NULL);
+}
+
+static void mark_pending(struct kw_index *ix, struct kw_entry *e)
+{
+  e->pending = TRUE;
+  e->prev_pending = NULL;
+  if ((e->next_pending = ix->pending) != NULL)
+    ix->pending->prev_pending = e;
+  ix->pending = e;
+}
+
+static void unmark_pending(struct kw_index *ix, struct kw_entry *e)
+{
+  if (e->prev_pending)
+    e->prev_pending->next_pending = e->next_pending;
+  else
+    ix->pending = e->next_pending;
+  if (e->next_pending)
+    e->next_pending->prev_pending = e->prev_pending;
+  e->pending = FALSE;
+}
+
+/* Takes thing out of the index, whether or not its words were filed. */
+static void index_leave(struct kw_index *ix, void *thing)
+{
+  struct kw_entry **prev, *e;
+
+  if ((prev = find_entry(ix, thing)) == NULL)
+    return;
+
+  e = *prev;
+  *prev = e->next;
+  ix->num_entries--;
+
+  if (e->pending)
+    unmark_pending(ix, e);
+  else
+    file_keys(ix, e, FALSE);
+  if (e->keys)
+    free(e->keys);
+  free(e);
+}
+
+/* Adds thing as the newest member of its list. */
+static void index_join(struct kw_index *ix, void *thing)
+{
+  struct kw_entry *e;
+  unsigned int h;
+
+  index_leave(ix, thing);
+
+  if (ix->num_entries >= ix->entry_buckets * 2)
+    rehash_entries(ix, MAX(ix->start ? ix->start : KW_BUCKETS, ix->entry_buckets * 2));
+
+  CREATE(e, struct kw_entry, 1);
+  e->thing = thing;
+  e->seq = ix->next_seq++;
+  h = kw_thing_hash(thing) % ix->entry_buckets;
+  e->next = ix->entries[h];
+  ix->entries[h] = e;
+  ix->num_entries++;
+
+  mark_pending(ix, e);
+}
+
+static void index_renamed(struct kw_index *ix, void *thing)
+{
+  struct kw_entry **prev, *e;
+
+  if ((prev = find_entry(ix, thing)) == NULL || (e = *prev)->pending)
+    return;
+
+  file_keys(ix, e, FALSE);
+  if (e->keys)
+    free(e->keys);
+  e->keys = NULL;
+  mark_pending(ix, e);
+}
+
+/* Files everything marked since the last lookup under its name now. */
+static void index_flush(struct kw_index *ix, const char *(*name)(void *thing))
+{
+  struct kw_entry *e;
+  const char *keys;
+
+  while ((e = ix->pending) != NULL) {
+    unmark_pending(ix, e);
+    keys = name(e->thing);
+    e->keys = (keys && *keys) ? strdup(keys) : NULL;
+    file_keys(ix, e, TRUE);
+  }
+}
+
+/* Whether an index can answer for 'word'. */
+static int word_usable(const char *word)
+{
+  return (word && *word && !strchr(word, ' ') && !strchr(word, '\t'));
+}
+
+/* The posting for 'word', NULL if nothing has a word like it; or sets
+ * *usable FALSE if the index cannot answer for it. */
+static struct kw_posting *index_lookup(struct kw_index *ix, const char *word, int *usable)
+{
+  char prefix[KEYWORD_PREFIX_MAX + 1];
+  int len;
+
+  *usable = word_usable(word);
+  if (!*usable)
+    return (NULL);
+
+  for (len = 0; word[len] && len < KEYWORD_PREFIX_MAX; len++)
+    prefix[len] = LOWER(word[len]);
+  prefix[len] = '\0';
+
+  lookups++;
+  return (find_posting(ix, prefix, FALSE));
+}
+
+static void index_clear(struct kw_index *ix)
+{
+  struct kw_posting *p, *next;
+  int i;
+
+  for (i = 0; i < ix->posting_buckets; i++) {
+    for (p = ix->postings[i]; p; p = next) {
+      next = p->next;
+      free(p->prefix);
+      if (p->list)
+        free(p->list);
+      free(p);
+    }
+    ix->postings[i] = NULL;
+  }
+  ix->num_postings = 0;
+}
+
+static void index_free(struct kw_index *ix)
+{
+  struct kw_entry *e, *next;
+  int i;
+
+  index_clear(ix);
+  if (ix->postings)
+    free(ix->postings);
+
+  for (i = 0; i < ix->entry_buckets; i++)
+    for (e = ix->entries[i]; e; e = next) {
+      next = e->next;
+      if (e->keys)
+        free(e->keys);
+      free(e);
+    }
+  if (ix->entries)
+    free(ix->entries);
+}
+
+static unsigned int list_hash(int kind, room_vnum room, struct obj_data *obj)
+{
+  if (kind == KWL_CONTAINS)
+    return (kw_thing_hash(obj) % KW_LIST_BUCKETS);
+  return ((unsigned int) (room * 2 + kind) % KW_LIST_BUCKETS);
+}
+
+/* The crowded list's index, or NULL if the list has none. */
+static struct kw_list **find_list(int kind, room_vnum room, struct obj_data *obj)
+{
+  struct kw_list **prev;
+
+  if (!num_lists)
+    return (NULL);
+
+  for (prev = &lists[list_hash(kind, room, obj)]; *prev; prev = &(*prev)->next)
+    if ((*prev)->kind == kind && (kind == KWL_CONTAINS ? (*prev)->obj == obj : (*prev)->room == room))
+      return (prev);
+  return (NULL);
+}
+
+/* Starts an index for a crowded list, for the caller to fill from the tail
+ * of the list to its head. */
+static struct kw_list *new_list(int kind, room_vnum room, struct obj_data *obj)
+{
+  struct kw_list *l;
+  unsigned int h = list_hash(kind, room, obj);
+
+  CREATE(l, struct kw_list, 1);
+  l->kind = kind;
+  l->room = room;
+  l->obj = obj;
+  l->index.start = KW_LIST_START;
+  l->next = lists[h];
+  lists[h] = l;
+  num_lists++;
+
+  return (l);
+}
+
+static void drop_list(struct kw_list **prev)
+{
+  struct kw_list *l = *prev;
+
+  *prev = l->next;
+  num_lists--;
+  index_free(&l->index);
+  free(l);
+}
+
+/* The index of the list obj is in, if it is crowded. */
+static struct kw_list **obj_list(struct obj_data *obj)
+{
+  if (obj->in_obj)
+    return (find_list(KWL_CONTAINS, NOWHERE, obj->in_obj));
+  if (IN_ROOM(obj) != NOWHERE)
+    return (find_list(KWL_CONTENTS, GET_ROOM_VNUM(IN_ROOM(obj)), NULL));
+  return (NULL);
+}
+
+static void list_leave(struct kw_list **prev, void *thing)
+{
+  if (!prev)
+    return;
+
+  index_leave(&(*prev)->index, thing);
+  if ((*prev)->index.num_entries < KEYWORD_CROWD / 4)
+    drop_list(prev);
+}
+
+static const char *char_keys(void *thing)
+{
+  return (((struct char_data *) thing)->player.name);
+}
+
+static const char *obj_keys(void *thing)
+{
+  return (((struct obj_data *) thing)->name);
+}
+
+/** Indexes ch as the newest member of character_list. */
+void keyword_char_add(struct char_data *ch)
+{
+  index_join(&char_keywords, ch);
+}
+
+/** Takes ch out of the index as it leaves character_list, or is freed. */
+void keyword_char_remove(struct char_data *ch)
+{
+  index_leave(&char_keywords, ch);
+}
+
+/** Files ch under its new name.  Call after changing ch->player.name. */
+void keyword_char_renamed(struct char_data *ch)
+{
+  struct kw_list **l;
+
+  index_renamed(&char_keywords, ch);
+  if (IN_ROOM(ch) != NOWHERE && (l = find_list(KWL_PEOPLE, GET_ROOM_VNUM(IN_ROOM(ch)), NULL)) != NULL)
+    index_renamed(&(*l)->index, ch);
+}
+
+/** Indexes obj as the newest member of object_list. */
+void keyword_obj_add(struct obj_data *obj)
+{
+  index_join(&obj_keywords, obj);
+}
+
+/** Takes obj out of the index as it leaves object_list, or is freed. */
+void keyword_obj_remove(struct obj_data *obj)
+{
+  struct kw_list **l;
+
+  index_leave(&obj_keywords, obj);
+  if ((l = find_list(KWL_CONTAINS, NOWHERE, obj)) != NULL)
+    drop_list(l);
+}
+
+/** Files obj under its new name.  Call after changing obj->name. */
+void keyword_obj_renamed(struct obj_data *obj)
+{
+  struct kw_list **l;
+
+  index_renamed(&obj_keywords, obj);
+  if ((l = obj_list(obj)) != NULL)
+    index_renamed(&(*l)->index, obj);
+}
+
+/** Indexes ch as the newest in its room, if the room is crowded.  Call
+ * after putting ch at the head of world[].people. */
+void keyword_people_add(struct char_data *ch)
+{
+  struct kw_list **l;
+
+  if ((l = find_list(KWL_PEOPLE, GET_ROOM_VNUM(IN_ROOM(ch)), NULL)) != NULL)
+    index_join(&(*l)->index, ch);
+}
+
+/** Takes ch out of its room's index.  Call before it leaves the room. */
+void keyword_people_remove(struct char_data *ch)
+{
+  list_leave(find_list(KWL_PEOPLE, GET_ROOM_VNUM(IN_ROOM(ch)), NULL), ch);
+}
+
+/** Indexes obj as the newest in its room or container, if that is crowded.
+ * Call after putting obj at the head of the list. */
+void keyword_contents_add(struct obj_data *obj)
+{
+  struct kw_list **l;
+
+  if ((l = obj_list(obj)) != NULL)
+    index_join(&(*l)->index, obj);
+}
+
+/** Takes obj out of its room's or container's index.  Call before it
+ * leaves. */
+void keyword_contents_remove(struct obj_data *obj)
+{
+  list_leave(obj_list(obj), obj);
+}
+
+/** Everyone in a room who might answer to 'word', in world[].people order;
+ * as keyword_chars(). */
+int keyword_people(room_rnum room, const char *word, struct char_data ***found)
+{
+  static struct char_data **list = NULL;
+  static int max = 0;
+  struct kw_list **l = NULL, *crowd;
+  struct kw_posting *p;
+  struct char_data *ch;
+  int i, n = 0, usable = word_usable(word);
+
+  if (room == NOWHERE || room > top_of_world) {
+    *found = list;
+    return (0);
+  }
+
+  if (!usable || (l = find_list(KWL_PEOPLE, GET_ROOM_VNUM(room), NULL)) == NULL) {
+    for (ch = world[room].people; ch; ch = ch->next_in_room) {
+      if (n >= max) {
+        max = MAX(64, max * 2);
+        RECREATE(list, struct char_data *, max);
+      }
+      list[n++] = ch;
+    }
+    *found = list;
+    if (!usable || n < KEYWORD_CROWD)
+      return (n);
+    crowd = new_list(KWL_PEOPLE, GET_ROOM_VNUM(room), NULL);
+    for (i = n - 1; i >= 0; i--)
+      index_join(&crowd->index, list[i]);
+  } else
+    crowd = *l;
+
+  index_flush(&crowd->index, char_keys);
+  n = 0;
+  if ((p = index_lookup(&crowd->index, word, &usable)) != NULL) {
+    if (p->count > max) {
+      max = p->count * 2;
+      RECREATE(list, struct char_data *, max);
+    }
+    for (i = p->count - 1; i >= 0; i--)
+      list[n++] = p->list[i]->thing;
+    candidates += n;
+  }
+
+  *found = list;
+  return (n);
+}
+
+/** Everything in a list of objects that might answer to 'word', in list
+ * order; as keyword_chars().  Only a whole room's or container's contents
+ * can be indexed; any other list, such as an inventory, is copied out. */
+int keyword_contents(struct obj_data *head, const char *word, struct obj_data ***found)
+{
+  static struct obj_data **list = NULL;
+  static int max = 0;
+  struct kw_list **l = NULL, *crowd;
+  struct kw_posting *p;
+  struct obj_data *obj, *container = NULL;
+  room_vnum room = NOWHERE;
+  int i, n = 0, kind = -1, usable = word_usable(word);
+
+  if (head && head->in_obj && head->in_obj->contains == head) {
+    kind = KWL_CONTAINS;
+    container = head->in_obj;
+  } else if (head && IN_ROOM(head) != NOWHERE && world[IN_ROOM(head)].contents == head) {
+    kind = KWL_CONTENTS;
+    room = GET_ROOM_VNUM(IN_ROOM(head));
+  }
+
+  if (!usable || kind < 0 || (l = find_list(kind, room, container)) == NULL) {
+    for (obj = head; obj; obj = obj->next_content) {
+      if (n >= max) {
+        max = MAX(64, max * 2);
+        RECREATE(list, struct obj_data *, max);
+      }
+      list[n++] = obj;
+    }
+    *found = list;
+    if (!usable || kind < 0 || n < KEYWORD_CROWD)
+      return (n);
+    crowd = new_list(kind, room, container);
+    for (i = n - 1; i >= 0; i--)
+      index_join(&crowd->index, list[i]);
+  } else
+    crowd = *l;
+
+  index_flush(&crowd->index, obj_keys);
+  n = 0;
+  if ((p = index_lookup(&crowd->index, word, &usable)) != NULL) {
+    if (p->count > max) {
+      max = p->count * 2;
+      RECREATE(list, struct obj_data *, max);
+    }
+    for (i = p->count - 1; i >= 0; i--)
+      list[n++] = p->list[i]->thing;
+    candidates += n;
+  }
+
+  *found = list;
+  return (n);
+}
+
+/** Everyone in character_list who might answer to 'word', in list order.
+ * Returns how many, with them in *found until the next call.  A word the
+ * index cannot answer for gets the whole list. */
+int keyword_chars(const char *word, struct char_data ***found)
+{
+  static struct char_data **list = NULL;
+  static int max = 0;
+  struct kw_posting *p;
+  struct char_data *ch;
+  int i, n = 0, usable;
+
+  index_flush(&char_keywords, char_keys);
+  p = index_lookup(&char_keywords, word, &usable);
+
+  if (!usable) {
+    for (ch = character_list; ch; ch = ch->next) {
+      if (n >= max) {
+        max = MAX(64, max * 2);
+        RECREATE(list, struct char_data *, max);
+      }
+      list[n++] = ch;
+    }
+  } else if (p) {
+    if (p->count > max) {
+      max = p->count * 2;
+      RECREATE(list, struct char_data *, max);
+    }
+    for (i = p->count - 1; i >= 0; i--)
+      list[n++] = p->list[i]->thing;
+    candidates += n;
+  }
+
+  *found = list;
+  return (n);
+}
+
+/** Everything in object_list that might answer to 'word', in list order;
+ * as keyword_chars(). */
+int keyword_objs(const char *word, struct obj_data ***found)
+{
+  static struct obj_data **list = NULL;
+  static int max = 0;
+  struct kw_posting *p;
+  struct obj_data *obj;
+  int i, n = 0, usable;
+
+  index_flush(&obj_keywords, obj_keys);
+  p = index_lookup(&obj_keywords, word, &usable);
+
+  if (!usable) {
+    for (obj = object_list; obj; obj = obj->next) {
+      if (n >= max) {
+        max = MAX(64, max * 2);
+        RECREATE(list, struct obj_data *, max);
+      }
+      list[n++] = obj;
+    }
+  } else if (p) {
+    if (p->count > max) {
+      max = p->count * 2;
+      RECREATE(list, struct obj_data *, max);
+    }
+    for (i = p->count - 1; i >= 0; i--)
+      list[n++] = p->list[i]->thing;
+    candidates += n;
+  }
+
+  *found = list;
+  return (n);
+}
+
+/** Marks a prototype table as changed: added to, deleted from, or edited. */
+void keyword_protos_changed(int table)
+{
+  if (table >= 0 && table < NUM_KW_TABLES)
+    tables[table].built = FALSE;
+}
+
+static int table_size(int table)
+{
+  switch (table) {
+  case KW_MOBILES:  return (top_of_mobt + 1);
+  case KW_OBJECTS:  return (top_of_objt + 1);
+  case KW_ROOMS:    return (top_of_world + 1);
+  case KW_TRIGGERS: return (top_of_trigt);
+  }
+  return (0);
+}
+
+static char *table_keys(int table, int nr)
+{
+  switch (table) {
+  case KW_MOBILES:  return (mob_proto[nr].player.name);
+  case KW_OBJECTS:  return (obj_proto[nr].name);
+  case KW_ROOMS:    return (world[nr].name);
+  case KW_TRIGGERS: return (trig_index[nr]->proto->name);
+  }
+  return (NULL);
+}
+
+static void build_table(int table)
+{
+  struct kw_table *t = &tables[table];
+  int nr, size = table_size(table);
+
+  index_clear(&t->index);
+  if (t->rows)
+    free(t->rows);
+  t->rows = NULL;
+
+  if (size > 0) {
+    CREATE(t->rows, struct kw_entry, size);
+    for (nr = 0; nr < size; nr++) {
+      /* The rows borrow the prototypes' strings until the next change. */
+      t->rows[nr].seq = nr;
+      t->rows[nr].keys = table_keys(table, nr);
+      file_keys(&t->index, &t->rows[nr], TRUE);
+    }
+  }
+  t->built = TRUE;
+}
+
+/** The rnums in a prototype table that might answer to 'word', lowest
+ * first; as keyword_chars(). */
+int keyword_protos(int table, const char *word, int **found)
+{
+  static int *list = NULL, max = 0;
+  struct kw_posting *p;
+  int i, n = 0, usable, size;
+
+  if (table < 0 || table >= NUM_KW_TABLES)
+    return (0);
+
+  size = table_size(table);
+  if (!tables[table].built)
+    build_table(table);
+  p = index_lookup(&tables[table].index, word, &usable);
+
+  if (MAX(size, 1) > max) {
+    max = MAX(size, 1);
+    RECREATE(list, int, max);
+  }
+  if (!usable)
+    for (n = 0; n < size; n++)
+      list[n] = n;
+  else if (p) {
+    for (i = 0; i < p->count; i++)
+      list[n++] = p->list[i]->seq;
+    candidates += n;
+  }
+
+  *found = list;
+  return (n);
+}
+
+/* One status line for the 'profile' command. */
+size_t keyword_status(char *buf, size_t len)
+{
+  return snprintf(buf, len,
+      "Keywords: %d characters and %d objects under %d prefixes, %d crowded "
+      "rooms and containers, %lu lookups (avg %lu candidates).\r\n",
+      char_keywords.num_entries, obj_keywords.num_entries,
+      char_keywords.num_postings + obj_keywords.num_postings, num_lists, lookups,
+      lookups ? candidates / lookups : 0);
+}
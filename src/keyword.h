@@ -0,0 +1,42 @@
+/**************************************************************************
+*  File: keyword.h                                         Part of tbaMUD *
+*  Usage: Finds characters, objects and prototypes by keyword.            *
+*                                                                         *
+*  All rights reserved.  See license for complete information.            *
+*                                                                         *
+*  Copyright (C) 1993, 94 by the Trustees of the Johns Hopkins University *
+*  CircleMUD is based on DikuMUD, Copyright (C) 1990, 1991.               *
+**************************************************************************/
+#ifndef KEYWORD_H_
+#define KEYWORD_H_
+
+#define KEYWORD_PREFIX_MAX  12  /* longest keyword prefix indexed, in bytes */
+#define KEYWORD_CROWD       32  /* room or container list long enough to index */
+
+/* The prototype tables, for keyword_protos() and keyword_protos_changed(). */
+#define KW_MOBILES    0
+#define KW_OBJECTS    1
+#define KW_ROOMS      2
+#define KW_TRIGGERS   3
+#define NUM_KW_TABLES 4
+
+/* Exported function prototypes */
+void keyword_char_add(struct char_data *ch);
+void keyword_char_remove(struct char_data *ch);
+void keyword_char_renamed(struct char_data *ch);
+void keyword_obj_add(struct obj_data *obj);
+void keyword_obj_remove(struct obj_data *obj);
+void keyword_obj_renamed(struct obj_data *obj);
+void keyword_people_add(struct char_data *ch);
+void keyword_people_remove(struct char_data *ch);
+void keyword_contents_add(struct obj_data *obj);
+void keyword_contents_remove(struct obj_data *obj);
+void keyword_protos_changed(int table);
+int keyword_chars(const char *word, struct char_data ***found);
+int keyword_objs(const char *word, struct obj_data ***found);
+int keyword_people(room_rnum room, const char *word, struct char_data ***found);
+int keyword_contents(struct obj_data *head, const char *word, struct obj_data ***found);
+int keyword_protos(int table, const char *word, int **found);
+size_t keyword_status(char *buf, size_t len);
+
+#endif /* KEYWORD_H_ */
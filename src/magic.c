@@ -22,6 +22,7 @@
 #include "class.h"
 #include "fight.h"
 #include "mud_event.h"
+#include "keyword.h"
 
 
 /* local file scope function prototypes */
@@ -769,6 +770,7 @@ void mag_summons(int level, struct char_data *ch, struct obj_data *obj,
     if (spellnum == SPELL_CLONE) {
       /* Don't mess up the prototype; use new string copies. */
       mob->player.name = strdup(GET_NAME(ch));
+      keyword_char_renamed(mob);
       mob->player.short_descr = strdup(GET_NAME(ch));
     }
     act(mag_summon_msgs[msg], FALSE, ch, 0, mob, TO_ROOM);
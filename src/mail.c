@@ -27,7 +27,31 @@ static void postmaster_receive_mail(struct char_data *ch, struct char_data *mail
 static int mail_recip_ok(const char *name);
 static void write_mail_record(FILE *mail_file, struct mail_t *record);
 static void free_mail_record(struct mail_t *record);
-static struct mail_t *read_mail_record(FILE *mail_file);
+static struct mail_t *parse_mail_record(FILE *mail_file, const char *line);
+static struct mail_box *find_mail_box(long recipient, int create);
+static void queue_mail(struct mail_t *record);
+static struct mail_t *dequeue_mail(long recipient);
+static int replay_mail_journal(void);
+static void journal_mail(struct mail_t *record, long deleted_for);
+static void compact_mail(void);
+
+/* All mail is held in memory, one first-in first-out queue per recipient,
+ * hashed on the recipient's idnum.  MAIL_FILE is a snapshot of that state;
+ * every delivery and pickup since the snapshot is appended to MAIL_JOURNAL.
+ * The journal is replayed at boot and folded into a fresh snapshot once it
+ * holds MAIL_JOURNAL_MAX entries.  Both files start with the same serial
+ * line, so a journal left over from before the last snapshot is ignored. */
+#define MAIL_HASH_SIZE 256
+
+struct mail_box {
+  long recipient;
+  struct mail_t *first, *last;
+  struct mail_box *next;
+};
+
+static struct mail_box *mail_hash[MAIL_HASH_SIZE];
+static long mail_serial = 0;     /* serial of the current snapshot */
+static int journal_entries = 0;  /* entries appended since the snapshot */
 
 static int mail_recip_ok(const char *name)
 {
@@ -47,16 +71,13 @@ static void free_mail_record(struct mail_t *record)
   free(record);
 }
 
-static struct mail_t *read_mail_record(FILE *mail_file)
+/* Reads the body of the record whose header line was just read. */
+static struct mail_t *parse_mail_record(FILE *mail_file, const char *line)
 {
-  char line[READ_SIZE];
   long sender, recipient;
   time_t sent_time;
   struct mail_t *record;
 
-  if (!get_line(mail_file, line))
-  	return NULL;
-
   if (sscanf(line, "### %ld %ld %ld", &recipient, &sender, (long *)&sent_time) != 3) {
   	log("Mail system - fatal error - malformed mail header");
   	log("Line was: %s", line);
@@ -83,34 +104,200 @@ static void write_mail_record(FILE *mail_file, struct mail_t *record)
                      record->body );
 }
 
+static struct mail_box *find_mail_box(long recipient, int create)
+{
+  struct mail_box *box, **bucket = &mail_hash[(unsigned long) recipient % MAIL_HASH_SIZE];
+
+  for (box = *bucket; box; box = box->next)
+    if (box->recipient == recipient)
+      return box;
+
+  if (!create)
+    return NULL;
+
+  CREATE(box, struct mail_box, 1);
+  box->recipient = recipient;
+  box->next = *bucket;
+  *bucket = box;
+  return box;
+}
+
+static void queue_mail(struct mail_t *record)
+{
+  struct mail_box *box = find_mail_box(record->recipient, TRUE);
+
+  record->next = NULL;
+  if (box->last)
+    box->last->next = record;
+  else
+    box->first = record;
+  box->last = record;
+}
+
+/* Unlinks the oldest mail for 'recipient', dropping the box once empty. */
+static struct mail_t *dequeue_mail(long recipient)
+{
+  struct mail_box *box, **prev = &mail_hash[(unsigned long) recipient % MAIL_HASH_SIZE];
+  struct mail_t *record;
+
+  for (box = *prev; box && box->recipient != recipient; box = box->next)
+    prev = &box->next;
+
+  if (!box)
+    return NULL;
+
+  record = box->first;
+  if (!(box->first = record->next)) {
+    *prev = box->next;
+    free(box);
+  }
+  return record;
+}
+
+void free_mail(void)
+{
+  struct mail_box *box;
+  int i;
+
+  for (i = 0; i < MAIL_HASH_SIZE; i++)
+    while ((box = mail_hash[i]) != NULL)
+      free_mail_record(dequeue_mail(box->recipient));
+}
+
+/* Appends one change to the journal: a new record, or the pickup of the
+ * oldest mail for 'deleted_for' when 'record' is NULL. */
+static void journal_mail(struct mail_t *record, long deleted_for)
+{
+  FILE *journal;
+
+  if (!(journal = fopen(MAIL_JOURNAL, "a"))) {
+    log("SYSERR: Mail journal not accessible: %s", strerror(errno));
+    return;
+  }
+
+  fseek(journal, 0, SEEK_END);
+  if (ftell(journal) == 0)
+    fprintf(journal, "#serial %ld\n", mail_serial);
+
+  if (record)
+    write_mail_record(journal, record);
+  else
+    fprintf(journal, "--- %ld\n", deleted_for);
+  fclose(journal);
+
+  if (++journal_entries >= MAIL_JOURNAL_MAX)
+    compact_mail();
+}
+
+/* Writes the in-memory mail out as a new snapshot and starts a new journal. */
+static void compact_mail(void)
+{
+  FILE *mail_file;
+  struct mail_box *box;
+  struct mail_t *record;
+  int i;
+
+  if (!(mail_file = fopen(MAIL_FILE_TMP, "w"))) {
+    log("SYSERR: Unable to write %s: %s", MAIL_FILE_TMP, strerror(errno));
+    return;
+  }
+
+  fprintf(mail_file, "#serial %ld\n", mail_serial + 1);
+  for (i = 0; i < MAIL_HASH_SIZE; i++)
+    for (box = mail_hash[i]; box; box = box->next)
+      for (record = box->first; record; record = record->next)
+        write_mail_record(mail_file, record);
+
+  if (fclose(mail_file) || rename(MAIL_FILE_TMP, MAIL_FILE)) {
+    log("SYSERR: Unable to replace %s: %s", MAIL_FILE, strerror(errno));
+    return;
+  }
+
+  /* The journal's serial no longer matches, so a crash from here on can't
+   * replay it twice. */
+  mail_serial++;
+  journal_entries = 0;
+  remove(MAIL_JOURNAL);
+}
+
+/* Applies the journal to the loaded snapshot.  Returns the number of entries
+ * replayed, or -1 if the journal is corrupt. */
+static int replay_mail_journal(void)
+{
+  FILE *journal;
+  char line[READ_SIZE];
+  struct mail_t *record;
+  long serial, recipient;
+  int count = 0;
+
+  if (!(journal = fopen(MAIL_JOURNAL, "r")))
+    return 0;
+
+  if (!get_line(journal, line) || sscanf(line, "#serial %ld", &serial) != 1 || serial != mail_serial) {
+    log("   Mail journal predates the mail file -- discarding it.");
+    fclose(journal);
+    /* Start over, or new mail would be appended under the old serial and
+     * thrown away with it at the next boot. */
+    remove(MAIL_JOURNAL);
+    return 0;
+  }
+
+  while (get_line(journal, line)) {
+    if (!strncmp(line, "###", 3)) {
+      if (!(record = parse_mail_record(journal, line)))
+        break;
+      queue_mail(record);
+    } else if (sscanf(line, "--- %ld", &recipient) == 1) {
+      if ((record = dequeue_mail(recipient)) != NULL)
+        free_mail_record(record);
+    } else {
+      log("Mail system - malformed journal entry: %s", line);
+      fclose(journal);
+      return -1;
+    }
+    count++;
+  }
+
+  fclose(journal);
+  return count;
+}
+
 /* int scan_file(none)
  * Returns false if mail file is corrupted or true if everything correct.
  *
- * This is called once during boot-up.  It scans through the mail file
- * and indexes all entries currently in the mail file. */
+ * This is called once during boot-up.  It loads every message in the mail
+ * file, replays the journal on top and writes a fresh snapshot. */
 int scan_file(void)
 {
   FILE *mail_file;
-  int count = 0;
+  char line[READ_SIZE];
+  int count = 0, replayed;
   struct mail_t *record;
 
   if (!(mail_file = fopen(MAIL_FILE, "r"))) {
     log("   Mail file non-existant... creating new file.");
     touch(MAIL_FILE);
-    return TRUE;
+  } else {
+    while (get_line(mail_file, line)) {
+      if (!count && sscanf(line, "#serial %ld", &mail_serial) == 1)
+        continue;
+      if (!(record = parse_mail_record(mail_file, line))) {
+        fclose(mail_file);
+        return FALSE;
+      }
+      queue_mail(record);
+      count++;
+    }
+    fclose(mail_file);
   }
 
-  record = read_mail_record(mail_file);
-
-  while (record) {
-    free_mail_record(record);
-    record = read_mail_record(mail_file);
-    count++;
-  }
+  if ((replayed = replay_mail_journal()) < 0)
+    return FALSE;
 
-  fclose(mail_file);
- 	log("   Mail file read -- %d messages.", count);
- 	return TRUE;
+  log("   Mail file read -- %d messages, %d journal entries.", count, replayed);
+  if (replayed)
+    compact_mail();
+  return TRUE;
 }
 
 /* int has_mail(long #1)
@@ -120,27 +307,7 @@ int scan_file(void)
  * A simple little function which tells you if the player has mail or not. */
 int has_mail(long recipient)
 {
-  FILE *mail_file;
-  struct mail_t *record;
-
-  if (!(mail_file = fopen(MAIL_FILE, "r"))) {
-    perror("read_delete: Mail file not accessible.");
-    return FALSE;
-  }
-
-  record = read_mail_record(mail_file);
-
-  while (record) {
-  	if (record->recipient == recipient) {
-  		free_mail_record(record);
-  		fclose(mail_file);
-  		return TRUE;
-    }
-    free_mail_record(record);
-    record = read_mail_record(mail_file);
-  }
-  fclose(mail_file);
-  return FALSE;
+  return (find_mail_box(recipient, FALSE) != NULL);
 }
 
 /* void store_mail(long #1, long #2, char * #3)
@@ -153,66 +320,43 @@ int has_mail(long recipient)
  * actual message text (char *). */
 void store_mail(long to, long from, char *message_pointer)
 {
-  FILE *mail_file;
-  struct mail_t *record;
+  struct mail_t *record, journaled;
 
-  if (!(mail_file = fopen(MAIL_FILE, "a"))) {
-    perror("store_mail: Mail file not accessible.");
-    return;
-  }
   CREATE(record, struct mail_t, 1);
 
   record->recipient = to;
   record->sender = from;
   record->sent_time = time(0);
-  record->body = message_pointer;
-
-  write_mail_record(mail_file, record);
-  free(record); /* don't free the body */
-  fclose(mail_file);
+  /* Keep what fread_string() would have handed back at the next boot. */
+  record->body = strdup(message_pointer);
+  parse_at(record->body);
+  queue_mail(record);
+
+  /* The journal gets the text as written; queue first in case this entry
+   * triggers a compaction. */
+  journaled = *record;
+  journaled.body = message_pointer;
+  journal_mail(&journaled, 0);
 }
 
 /* char *read_delete(long #1)
  * #1 - The id number of the person we're checking mail for.
  * Returns the message text of the mail received.
  *
- * Retrieves one messsage for a player. The mail is then discarded from
- * the file. Expects mail to exist. */
+ * Retrieves one messsage for a player. The mail is then discarded. Expects
+ * mail to exist. */
 char *read_delete(long recipient)
 {
-  FILE *mail_file, *new_file;
-  struct mail_t *record, *record_to_keep = NULL;
+  struct mail_t *record_to_keep;
   char buf[MAX_STRING_LENGTH];
 
-  if (!(mail_file = fopen(MAIL_FILE, "r"))) {
-    perror("read_delete: Mail file not accessible.");
-    return strdup("Mail system malfunction - please report this");
-  }
-
-  if (!(new_file = fopen(MAIL_FILE_TMP, "w"))) {
-    perror("read_delete: new Mail file not accessible.");
-    fclose(mail_file);
-    return strdup("Mail system malfunction - please report this");
-  }
-
-  record = read_mail_record(mail_file);
-
-  while (record) {
-  	if (!record_to_keep && record->recipient == recipient) {
-  		record_to_keep = record;
-  		record = read_mail_record(mail_file);
-  		continue; /* don't write and free this one just yet */
-    }
-    write_mail_record(new_file, record);
-    free_mail_record(record);
-    record = read_mail_record(mail_file);
-  }
-
-  if (!record_to_keep)
+  if (!(record_to_keep = dequeue_mail(recipient)))
   	sprintf(buf, "Mail system error - please report");
   else {
     char timestr[25], *from, *to;
 
+    journal_mail(NULL, recipient);
+
     strftime(timestr, sizeof(timestr), "%c", localtime(&(record_to_keep->sent_time)));
 
     from = get_name_by_id(record_to_keep->sender);
@@ -233,11 +377,6 @@ char *read_delete(long recipient)
 
     free_mail_record(record_to_keep);
   }
-  fclose(mail_file);
-  fclose(new_file);
-
-  remove(MAIL_FILE);
-  rename(MAIL_FILE_TMP, MAIL_FILE);
 
   return strdup(buf);
 }
@@ -24,6 +24,9 @@
 /* Maximum size of mail in bytes (arbitrary)	*/
 #define MAX_MAIL_SIZE 8192
 
+/* journal entries written before the mail file is rewritten */
+#define MAIL_JOURNAL_MAX 100
+
 /* size of mail file allocation blocks		*/
 #define BLOCK_SIZE 100
 
@@ -42,12 +45,14 @@ int	has_mail(long recipient);
 void	store_mail(long to, long from, char *message_pointer);
 char	*read_delete(long recipient);
 void    notify_if_playing(struct char_data *from, int recipient_id);
+void	free_mail(void);
 
 struct mail_t {
 	long recipient;
 	long sender;
 	time_t sent_time;
 	char *body;
+	struct mail_t *next;	/* next mail for the same recipient */
 };
 
 /* old stuff below */
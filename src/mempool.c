@@ -0,0 +1,148 @@
+/**************************************************************************
+*  File: mempool.c                                         Part of tbaMUD *
+*  Usage: Slab pools for the structures the game makes and frees most.    *
+*                                                                         *
+*  All rights reserved.  See license for complete information.            *
+*                                                                         *
+*  Copyright (C) 1993, 94 by the Trustees of the Johns Hopkins University *
+*  CircleMUD is based on DikuMUD, Copyright (C) 1990, 1991.               *
+**************************************************************************/
+
+#include "conf.h"
+#include "sysdep.h"
+#include "structs.h"
+#include "utils.h"
+#include "dg_event.h"
+#include "mud_event.h"
+#include "mempool.h"
+
+/* Zone resets make and free mobs, objects, affects and events by the
+ * thousand, and output queues take and release blocks every pulse.  Each
+ * type gets its own pool, carved from slabs of POOL_SLAB_BYTES, so they no
+ * longer churn and fragment the general heap over a long uptime, and
+ * 'show memory' can count them.
+ *
+ * With MEMORY_DEBUG each object is a separate zmalloc() and zfree() under
+ * the caller's file and line instead, so the checker still sees every leak,
+ * overrun and double free; only the counters are kept. */
+struct pool_slab {
+  char *mem;
+  struct pool_slab *next;
+};
+
+#define MEM_POOL(name, type)  { (name), sizeof(type), NULL, NULL, 0, 0, 0, 0, 0 }
+
+struct mem_pool char_pool      = MEM_POOL("characters", struct char_data);
+struct mem_pool obj_pool       = MEM_POOL("objects",    struct obj_data);
+struct mem_pool affect_pool    = MEM_POOL("affects",    struct affected_type);
+struct mem_pool event_pool     = MEM_POOL("events",     struct event);
+struct mem_pool mud_event_pool = MEM_POOL("mud events", struct mud_event_data);
+struct mem_pool out_block_pool = MEM_POOL("out blocks", struct out_block);
+struct mem_pool out_seg_pool   = MEM_POOL("out segs",   struct out_seg);
+
+static struct mem_pool *pool_list[] = {
+  &char_pool, &obj_pool, &affect_pool, &event_pool, &mud_event_pool,
+  &out_block_pool, &out_seg_pool, NULL
+};
+
+#ifndef MEMORY_DEBUG
+static int pool_slab_objects(struct mem_pool *pool)
+{
+  return (MAX(POOL_SLAB_MIN, POOL_SLAB_BYTES / pool->size));
+}
+
+/* Adds a slab and puts its objects on the free list, lowest address first. */
+static void pool_grow(struct mem_pool *pool)
+{
+  struct pool_slab *slab;
+  int i, count = pool_slab_objects(pool);
+
+  CREATE(slab, struct pool_slab, 1);
+  CREATE(slab->mem, char, count * pool->size);
+  slab->next = pool->slabs;
+  pool->slabs = slab;
+  pool->slab_count++;
+
+  for (i = count - 1; i >= 0; i--) {
+    void *obj = slab->mem + i * pool->size;
+
+    *(void **) obj = pool->free_list;
+    pool->free_list = obj;
+  }
+  pool->idle += count;
+}
+#endif
+
+/** Returns a zeroed object from 'pool', as CREATE() would. */
+void *pool_get(struct mem_pool *pool, const char *file, int line)
+{
+  void *obj;
+
+#ifdef MEMORY_DEBUG
+  if (!(obj = zmalloc(pool->size, (char *) file, line))) {
+    perror("SYSERR: malloc failure");
+    abort();
+  }
+#else
+  if (!pool->free_list)
+    pool_grow(pool);
+
+  obj = pool->free_list;
+  pool->free_list = *(void **) obj;
+  pool->idle--;
+  memset(obj, 0, pool->size);
+#endif
+
+  pool->allocs++;
+  if (++pool->live > pool->peak)
+    pool->peak = pool->live;
+
+  return (obj);
+}
+
+/** Gives an object from pool_get() back to 'pool'.  NULL is ignored. */
+void pool_put(struct mem_pool *pool, void *obj, const char *file, int line)
+{
+  if (!obj)
+    return;
+
+#ifdef MEMORY_DEBUG
+  zfree((unsigned char *) obj, (char *) file, line);
+#else
+  *(void **) obj = pool->free_list;
+  pool->free_list = obj;
+  pool->idle++;
+#endif
+
+  pool->live--;
+}
+
+/* One line per pool, for 'show memory'. */
+size_t pool_stats(char *buf, size_t len)
+{
+  struct mem_pool *pool;
+  size_t used;
+  int i;
+
+  used = snprintf(buf, len,
+	"Pool         Size     Live     Free     Peak  Slabs   KBytes       Allocs\r\n"
+	"----------- ----- -------- -------- -------- ------ -------- ------------\r\n");
+
+  for (i = 0; (pool = pool_list[i]) != NULL && used < len; i++)
+    used += snprintf(buf + used, len - used, "%-11s %5d %8ld %8ld %8ld %6d %8ld %12lu\r\n",
+	pool->name, (int) pool->size, pool->live, pool->idle, pool->peak, pool->slab_count,
+#ifdef MEMORY_DEBUG
+	(long) (pool->live * pool->size / 1024),
+#else
+	(long) (pool->idle + pool->live) * (long) pool->size / 1024,
+#endif
+	pool->allocs);
+
+#ifdef MEMORY_DEBUG
+  if (used < len)
+    used += snprintf(buf + used, len - used,
+	"MEMORY_DEBUG is on: objects come from zmalloc(), not slabs.\r\n");
+#endif
+
+  return (MIN(used, len));
+}
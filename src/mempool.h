@@ -0,0 +1,52 @@
+/**************************************************************************
+*  File: mempool.h                                         Part of tbaMUD *
+*  Usage: Slab pools for the structures the game makes and frees most.    *
+*                                                                         *
+*  All rights reserved.  See license for complete information.            *
+*                                                                         *
+*  Copyright (C) 1993, 94 by the Trustees of the Johns Hopkins University *
+*  CircleMUD is based on DikuMUD, Copyright (C) 1990, 1991.               *
+**************************************************************************/
+#ifndef MEMPOOL_H_
+#define MEMPOOL_H_
+
+/* Slabs are about this big, but always hold at least POOL_SLAB_MIN. */
+#define POOL_SLAB_BYTES  32768
+#define POOL_SLAB_MIN    16
+
+struct pool_slab;
+
+/** A pool hands out zeroed objects of one size.  Released objects go on the
+ * pool's free list and slabs are never given back, so repops reuse the same
+ * memory instead of working through the heap. */
+struct mem_pool {
+  const char *name;
+  size_t size;               /**< bytes in one object */
+  void *free_list;           /**< released objects, linked by first word */
+  struct pool_slab *slabs;
+  int slab_count;
+  long live;                 /**< handed out and not yet released */
+  long idle;                 /**< waiting on free_list */
+  long peak;                 /**< most live at once */
+  unsigned long allocs;      /**< objects handed out since boot */
+};
+
+extern struct mem_pool char_pool;
+extern struct mem_pool obj_pool;
+extern struct mem_pool affect_pool;
+extern struct mem_pool event_pool;
+extern struct mem_pool mud_event_pool;
+extern struct mem_pool out_block_pool;
+extern struct mem_pool out_seg_pool;
+
+/* Exported function prototypes */
+void *pool_get(struct mem_pool *pool, const char *file, int line);
+void pool_put(struct mem_pool *pool, void *obj, const char *file, int line);
+size_t pool_stats(char *buf, size_t len);
+
+/** Use these rather than pool_get() and pool_put(), so that under
+ * MEMORY_DEBUG zmalloc.c is told where the object really came from. */
+#define pool_alloc(pool)      pool_get(&(pool), __FILE__, __LINE__)
+#define pool_free(pool, obj)  pool_put(&(pool), (obj), __FILE__, __LINE__)
+
+#endif /* MEMPOOL_H_ */
@@ -14,6 +14,7 @@
 #include "constants.h"
 #include "comm.h"  /* For access to the game pulse */
 #include "mud_event.h"
+#include "mempool.h"
 
 /* Global List */
 struct list_data * world_events = NULL;
@@ -133,7 +134,7 @@ struct mud_event_data *new_mud_event(event_id iId, void *pStruct, char *sVariabl
   struct mud_event_data *pMudEvent;
   char *varString;
 
-  CREATE(pMudEvent, struct mud_event_data, 1);
+  pMudEvent = pool_alloc(mud_event_pool);
   varString = (sVariables != NULL) ? strdup(sVariables) : NULL;
 
   pMudEvent->iId         = iId;
@@ -182,7 +183,7 @@ void free_mud_event(struct mud_event_data *pMudEvent)
     free(pMudEvent->sVariables);
 
   pMudEvent->pEvent->event_obj = NULL;
-  free(pMudEvent);
+  pool_free(mud_event_pool, pMudEvent);
 }
 
 struct mud_event_data * char_has_mud_event(struct char_data * ch, event_id iId)
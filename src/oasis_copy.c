@@ -23,6 +23,7 @@
 #include "improved-edit.h"
 #include "constants.h"
 #include "dg_scripts.h"
+#include "graph.h"
 
 /* Local, filescope function prototypes */
 /* Utility function for buildwalk */
@@ -285,6 +286,7 @@ ACMD(do_dig)
     W_EXIT(rrnum, rev_dir[dir])->to_room = IN_ROOM(ch);
     add_to_save_list(zone_table[world[rrnum].zone].number, SL_WLD);
   }
+  graph_changed();
 }
 
 /* BuildWalk - OasisOLC Extension by D. Tyler Barnes. */
@@ -354,6 +356,7 @@ int buildwalk(struct char_data *ch, int dir)
       EXIT(ch, dir)->to_room = rnum;
       CREATE(world[rnum].dir_option[rev_dir[dir]], struct room_direction_data, 1);
       world[rnum].dir_option[rev_dir[dir]]->to_room = IN_ROOM(ch);
+      graph_changed();
 
       /* Report room creation to user */
       send_to_char(ch, "%s#  %d  ϴ.%s\r\n", yel, vnum, nrm);
@@ -22,6 +22,7 @@
 #include "config.h"
 #include "modify.h"
 #include "genolc.h" /* for strip_cr and sprintascii */
+#include "bgsave.h"
 
 /* these factors should be unique integers */
 #define RENT_FACTOR    1
@@ -266,6 +267,7 @@ int Crash_delete_file(char *name)
   if (!get_filename(filename, sizeof(filename), CRASH_FILE, name))
     return FALSE;
 
+  bgsave_sync(filename);
   if (!(fl = fopen(filename, "r"))) {
     if (errno != ENOENT)  /* if it fails but NOT because of no file */
       log("SYSERR: deleting crash file %s (1): %s", filename, strerror(errno));
@@ -291,6 +293,7 @@ int Crash_delete_crashfile(struct char_data *ch)
   if (!get_filename(filename, sizeof(filename), CRASH_FILE, GET_NAME(ch)))
     return FALSE;
 
+  bgsave_sync(filename);
   if (!(fl = fopen(filename, "r"))) {
     if (errno != ENOENT)  /* if it fails, NOT because of no file */
       log("SYSERR: checking for crash file %s (3): %s", filename, strerror(errno));
@@ -320,6 +323,7 @@ int Crash_clean_file(char *name)
   if (!get_filename(filename, sizeof(filename), CRASH_FILE, name))
     return FALSE;
 
+  bgsave_sync(filename);
   /* Open so that permission problems will be flagged now, at boot time. */
   if (!(fl = fopen(filename, "r"))) {
     if (errno != ENOENT)  /* if it fails, NOT because of no file */
@@ -386,6 +390,7 @@ void Crash_listrent(struct char_data *ch, char *name)
   if (!get_filename(filename, sizeof(filename), CRASH_FILE, name))
     return;
 
+  bgsave_sync(filename);
   if (!(fl = fopen(filename, "r"))) {
     send_to_char(ch, "%s has no rent file.\r\n", name);
     return;
@@ -558,6 +563,7 @@ void Crash_crashsave(struct char_data *ch)
 {
   char buf[MAX_INPUT_LENGTH];
   int j;
+  struct bgsave_file bf;
   FILE *fp;
 
   if (IS_NPC(ch))
@@ -566,29 +572,31 @@ void Crash_crashsave(struct char_data *ch)
   if (!get_filename(buf, sizeof(buf), CRASH_FILE, GET_NAME(ch)))
     return;
 
-  if (!(fp = fopen(buf, "w")))
+  if (!(fp = bgsave_open(&bf, buf)))
     return;
 
-  if (!objsave_write_rentcode(fp, RENT_CRASH, 0, ch))
-  	return;
+  if (!objsave_write_rentcode(fp, RENT_CRASH, 0, ch)) {
+    bgsave_abort(&bf);
+    return;
+  }
 
   for (j = 0; j < NUM_WEARS; j++)
     if (GET_EQ(ch, j)) {
       if (!Crash_save(GET_EQ(ch, j), fp, j + 1)) {
-        fclose(fp);
+        bgsave_abort(&bf);
         return;
       }
       Crash_restore_weight(GET_EQ(ch, j));
     }
 
   if (!Crash_save(ch->carrying, fp, 0)) {
-    fclose(fp);
+    bgsave_abort(&bf);
     return;
   }
   Crash_restore_weight(ch->carrying);
 
   fprintf(fp, "$~\n");
-  fclose(fp);
+  bgsave_commit(&bf);
   REMOVE_BIT_AR(PLR_FLAGS(ch), PLR_CRASH);
 }
 
@@ -597,6 +605,7 @@ void Crash_idlesave(struct char_data *ch)
   char buf[MAX_INPUT_LENGTH];
   int j;
   int cost, cost_eq;
+  struct bgsave_file bf;
   FILE *fp;
 
   if (IS_NPC(ch))
@@ -605,7 +614,7 @@ void Crash_idlesave(struct char_data *ch)
   if (!get_filename(buf, sizeof(buf), CRASH_FILE, GET_NAME(ch)))
     return;
 
-  if (!(fp = fopen(buf, "w")))
+  if (!(fp = bgsave_open(&bf, buf)))
     return;
 
   Crash_extract_norent_eq(ch);
@@ -637,19 +646,21 @@ void Crash_idlesave(struct char_data *ch)
   if (ch->carrying == NULL) {
     for (j = 0; j < NUM_WEARS && GET_EQ(ch, j) == NULL; j++) /* Nothing */ ;
     if (j == NUM_WEARS) {  /* No equipment or inventory. */
-      fclose(fp);
+      bgsave_abort(&bf);
       Crash_delete_file(GET_NAME(ch));
       return;
     }
   }
 
-  if (!objsave_write_rentcode(fp, RENT_TIMEDOUT, cost, ch))
-  	return;
+  if (!objsave_write_rentcode(fp, RENT_TIMEDOUT, cost, ch)) {
+    bgsave_abort(&bf);
+    return;
+  }
 
   for (j = 0; j < NUM_WEARS; j++) {
     if (GET_EQ(ch, j)) {
       if (!Crash_save(GET_EQ(ch, j), fp, j + 1)) {
-        fclose(fp);
+        bgsave_abort(&bf);
         return;
       }
       Crash_restore_weight(GET_EQ(ch, j));
@@ -657,11 +668,11 @@ void Crash_idlesave(struct char_data *ch)
     }
   }
   if (!Crash_save(ch->carrying, fp, 0)) {
-    fclose(fp);
+    bgsave_abort(&bf);
     return;
   }
   fprintf(fp, "$~\n");
-  fclose(fp);
+  bgsave_commit(&bf);
 
   Crash_extract_objs(ch->carrying);
 }
@@ -670,6 +681,7 @@ void Crash_rentsave(struct char_data *ch, int cost)
 {
   char buf[MAX_INPUT_LENGTH];
   int j;
+  struct bgsave_file bf;
   FILE *fp;
 
   if (IS_NPC(ch))
@@ -678,19 +690,21 @@ void Crash_rentsave(struct char_data *ch, int cost)
   if (!get_filename(buf, sizeof(buf), CRASH_FILE, GET_NAME(ch)))
     return;
 
-  if (!(fp = fopen(buf, "w")))
+  if (!(fp = bgsave_open(&bf, buf)))
     return;
 
   Crash_extract_norent_eq(ch);
   Crash_extract_norents(ch->carrying);
 
-  if (!objsave_write_rentcode(fp, RENT_RENTED, cost, ch))
-  	return;
+  if (!objsave_write_rentcode(fp, RENT_RENTED, cost, ch)) {
+    bgsave_abort(&bf);
+    return;
+  }
 
   for (j = 0; j < NUM_WEARS; j++)
     if (GET_EQ(ch, j)) {
       if (!Crash_save(GET_EQ(ch,j), fp, j + 1)) {
-        fclose(fp);
+        bgsave_abort(&bf);
         return;
       }
       Crash_restore_weight(GET_EQ(ch, j));
@@ -698,11 +712,11 @@ void Crash_rentsave(struct char_data *ch, int cost)
 
     }
   if (!Crash_save(ch->carrying, fp, 0)) {
-    fclose(fp);
+    bgsave_abort(&bf);
     return;
   }
   fprintf(fp, "$~\n");
-  fclose(fp);
+  bgsave_commit(&bf);
 
   Crash_extract_objs(ch->carrying);
 }
@@ -729,6 +743,7 @@ static void Crash_cryosave(struct char_data *ch, int cost)
 {
   char buf[MAX_INPUT_LENGTH];
   int j;
+  struct bgsave_file bf;
   FILE *fp;
 
   if (IS_NPC(ch))
@@ -737,7 +752,7 @@ static void Crash_cryosave(struct char_data *ch, int cost)
   if (!get_filename(buf, sizeof(buf), CRASH_FILE, GET_NAME(ch)))
     return;
 
-  if (!(fp = fopen(buf, "w")))
+  if (!(fp = bgsave_open(&bf, buf)))
     return;
 
   Crash_extract_norent_eq(ch);
@@ -745,24 +760,26 @@ static void Crash_cryosave(struct char_data *ch, int cost)
 
   GET_GOLD(ch) = MAX(0, GET_GOLD(ch) - cost);
 
-  if (!objsave_write_rentcode(fp, RENT_CRYO, 0, ch))
-  	return;
+  if (!objsave_write_rentcode(fp, RENT_CRYO, 0, ch)) {
+    bgsave_abort(&bf);
+    return;
+  }
 
   for (j = 0; j < NUM_WEARS; j++)
     if (GET_EQ(ch, j)) {
       if (!Crash_save(GET_EQ(ch, j), fp, j + 1)) {
-        fclose(fp);
+        bgsave_abort(&bf);
         return;
       }
       Crash_restore_weight(GET_EQ(ch, j));
       Crash_extract_objs(GET_EQ(ch, j));
     }
   if (!Crash_save(ch->carrying, fp, 0)) {
-    fclose(fp);
+    bgsave_abort(&bf);
     return;
   }
   fprintf(fp, "$~\n");
-  fclose(fp);
+  bgsave_commit(&bf);
 
   Crash_extract_objs(ch->carrying);
   SET_BIT_AR(PLR_FLAGS(ch), PLR_CRYO);
@@ -1194,6 +1211,7 @@ static int Crash_load_objs(struct char_data *ch) {
   for (i = 0; i < MAX_BAG_ROWS; i++)
     cont_row[i] = NULL;
 
+  bgsave_sync(filename);
   if (!(fl = fopen(filename, "r"))) {
     if (errno != ENOENT) { /* if it fails, NOT because of no file */
       snprintf(buf, MAX_STRING_LENGTH, "SYSERR: READING OBJECT FILE %s (5)", filename);
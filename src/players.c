@@ -22,6 +22,7 @@
 #include "config.h" /* for pclean_criteria[] */
 #include "dg_scripts.h" /* To enable saving of player variables to disk */
 #include "quest.h"
+#include "bgsave.h"
 
 #define LOAD_HIT	0
 #define LOAD_MANA	1
@@ -41,6 +42,19 @@ static void load_quests(FILE *fl, struct char_data *ch);
 static void load_HMVS(struct char_data *ch, const char *line, int mode);
 static void write_aliases_ascii(FILE *file, struct char_data *ch);
 static void read_aliases_ascii(FILE *file, struct char_data *ch, int count);
+static void ptable_hash_build(void);
+static void ptable_hash_add(int pos);
+
+/* Open-addressing hash indexes into player_table, one keyed by case-folded
+ * name and one by idnum.  Slots hold a player_table position or -1.  A slot
+ * whose entry no longer carries the key it was filed under (a name reused by
+ * create_entry() gets a fresh id) is simply skipped by the lookups, and the
+ * indexes are rebuilt whenever positions shift or either one is half full,
+ * counting such stale slots, so a lookup always reaches an empty slot. */
+static int *ptable_name_hash = NULL;
+static int *ptable_id_hash = NULL;
+static int ptable_hash_size = 0;	/* always a power of two */
+static int ptable_name_used = 0, ptable_id_used = 0;	/* slots filled */
 
 /* New version to build player index for ASCII Player Files. Generate index
  * table for the player file. */
@@ -82,6 +96,7 @@ void build_player_index(void)
 
   fclose(plr_index);
   top_of_p_file = top_of_p_table = i - 1;
+  ptable_hash_build();
 }
 
 /* Create a new entry in the in-memory index table for the player file. If the
@@ -109,7 +124,10 @@ int create_entry(char *name)
 
   /* clear the bitflag in case we have garbage data */
   player_table[pos].flags = 0;
+  /* no idnum until init_char() gives it one */
+  player_table[pos].id = -1;
 
+  ptable_hash_add(pos);
   return (pos);
 }
 
@@ -146,6 +164,9 @@ static void remove_player_from_index(int pos)
     free(player_table);
     player_table = NULL;
   }
+
+  /* Every position past 'pos' moved down one. */
+  ptable_hash_build();
 }
 
 /* This function necessary to save a seperate ASCII player index */
@@ -187,39 +208,155 @@ void free_player_index(void)
   free(player_table);
   player_table = NULL;
   top_of_p_table = 0;
+
+  if (ptable_name_hash)
+    free(ptable_name_hash);
+  if (ptable_id_hash)
+    free(ptable_id_hash);
+  ptable_name_hash = ptable_id_hash = NULL;
+  ptable_hash_size = 0;
+  ptable_name_used = ptable_id_used = 0;
 }
 
-long get_ptable_by_name(const char *name)
+/* FNV-1a over the name folded the same way str_cmp() folds it. */
+static unsigned int ptable_name_key(const char *name)
 {
-  int i;
+  unsigned int h = 2166136261U;
 
-  for (i = 0; i <= top_of_p_table; i++)
-    if (!str_cmp(player_table[i].name, name))
-      return (i);
+  for (; *name; name++)
+    h = (h ^ (unsigned char) LOWER(*name)) * 16777619U;
+
+  return (h);
+}
+
+static unsigned int ptable_id_key(long id)
+{
+  return ((unsigned int) id * 2654435761U);
+}
+
+static int ptable_find_name(const char *name)
+{
+  unsigned int i;
+  int pos;
+
+  if (!ptable_hash_size)
+    return (-1);
+
+  for (i = ptable_name_key(name); (pos = ptable_name_hash[i & (ptable_hash_size - 1)]) != -1; i++)
+    if (pos <= top_of_p_table && !str_cmp(player_table[pos].name, name))
+      return (pos);
 
   return (-1);
 }
 
-long get_id_by_name(const char *name)
+static int ptable_find_id(long id)
 {
-  int i;
+  unsigned int i;
+  int pos;
 
-  for (i = 0; i <= top_of_p_table; i++)
-    if (!str_cmp(player_table[i].name, name))
-      return (player_table[i].id);
+  if (!ptable_hash_size)
+    return (-1);
+
+  for (i = ptable_id_key(id); (pos = ptable_id_hash[i & (ptable_hash_size - 1)]) != -1; i++)
+    if (pos <= top_of_p_table && player_table[pos].id == id)
+      return (pos);
 
   return (-1);
 }
 
-char *get_name_by_id(long id)
+/* File 'pos' under its name and id.  When two entries share a key the lower
+ * position wins, which is what the old front-to-back scans returned. */
+static void ptable_hash_insert(int pos)
 {
-  int i;
+  unsigned int i;
+
+  if (player_table[pos].name && ptable_find_name(player_table[pos].name) == -1) {
+    for (i = ptable_name_key(player_table[pos].name); ptable_name_hash[i & (ptable_hash_size - 1)] != -1; i++)
+      ;
+    ptable_name_hash[i & (ptable_hash_size - 1)] = pos;
+    ptable_name_used++;
+  }
+
+  if (ptable_find_id(player_table[pos].id) == -1) {
+    for (i = ptable_id_key(player_table[pos].id); ptable_id_hash[i & (ptable_hash_size - 1)] != -1; i++)
+      ;
+    ptable_id_hash[i & (ptable_hash_size - 1)] = pos;
+    ptable_id_used++;
+  }
+}
+
+/* Size the indexes to at most half full and refile every entry. */
+static void ptable_hash_build(void)
+{
+  int i, size = 64;
+
+  while (size < (top_of_p_table + 1) * 2)
+    size <<= 1;
+
+  if (size != ptable_hash_size) {
+    if (ptable_name_hash)
+      free(ptable_name_hash);
+    if (ptable_id_hash)
+      free(ptable_id_hash);
+    CREATE(ptable_name_hash, int, size);
+    CREATE(ptable_id_hash, int, size);
+    ptable_hash_size = size;
+  }
+
+  for (i = 0; i < ptable_hash_size; i++)
+    ptable_name_hash[i] = ptable_id_hash[i] = -1;
+  ptable_name_used = ptable_id_used = 0;
 
   for (i = 0; i <= top_of_p_table; i++)
-    if (player_table[i].id == id)
-      return (player_table[i].name);
+    ptable_hash_insert(i);
+}
+
+static void ptable_hash_add(int pos)
+{
+  if ((MAX(ptable_name_used, ptable_id_used) + 1) * 2 > ptable_hash_size)
+    ptable_hash_build();
+  else
+    ptable_hash_insert(pos);
+}
+
+/* Give the index entry at 'pos' a new idnum. */
+void set_player_index_id(int pos, long id)
+{
+  player_table[pos].id = id;
+  ptable_hash_add(pos);
+}
 
-  return (NULL);
+/* Give the index entry at 'pos' a new name, stored in lower case. */
+void set_player_index_name(int pos, const char *name)
+{
+  int i;
+
+  free(player_table[pos].name);
+  CREATE(player_table[pos].name, char, strlen(name) + 1);
+  for (i = 0; (player_table[pos].name[i] = LOWER(name[i])); i++)
+    /* Nothing */;
+
+  /* The old name's slot can't be told apart from a live one, so refile. */
+  ptable_hash_build();
+}
+
+long get_ptable_by_name(const char *name)
+{
+  return (ptable_find_name(name));
+}
+
+long get_id_by_name(const char *name)
+{
+  int pos = ptable_find_name(name);
+
+  return (pos == -1 ? -1 : player_table[pos].id);
+}
+
+char *get_name_by_id(long id)
+{
+  int pos = ptable_find_id(id);
+
+  return (pos == -1 ? NULL : player_table[pos].name);
 }
 
 /* Stuff related to the save/load player system. */
@@ -240,6 +377,7 @@ int load_char(const char *name, struct char_data *ch)
   else {
     if (!get_filename(filename, sizeof(filename), PLR_FILE, player_table[id].name))
       return (-1);
+    bgsave_sync(filename);
     if (!(fl = fopen(filename, "r"))) {
       mudlog(NRM, LVL_GOD, TRUE, "SYSERR: Couldn't open player file %s", filename);
       return (-1);
@@ -462,6 +600,7 @@ int load_char(const char *name, struct char_data *ch)
           if (!SCRIPT(ch))
             CREATE(SCRIPT(ch), struct script_data, 1);
           add_trigger(SCRIPT(ch), t, -1);
+          list_random_script(ch, MOB_TRIGGER);
           }
          }
 	break;
@@ -500,6 +639,7 @@ int load_char(const char *name, struct char_data *ch)
 /* This is the ASCII Player Files save routine. */
 void save_char(struct char_data * ch)
 {
+  struct bgsave_file bf;
   FILE *fl;
   char filename[40], buf[MAX_STRING_LENGTH], bits[127], bits2[127], bits3[127], bits4[127];
   int i, j, id, save_index = FALSE;
@@ -530,7 +670,7 @@ void save_char(struct char_data * ch)
 
   if (!get_filename(filename, sizeof(filename), PLR_FILE, GET_NAME(ch)))
     return;
-  if (!(fl = fopen(filename, "w"))) {
+  if (!(fl = bgsave_open(&bf, filename))) {
     mudlog(NRM, LVL_GOD, TRUE, "SYSERR: Couldn't open player file %s for write", filename);
     return;
   }
@@ -703,7 +843,7 @@ void save_char(struct char_data * ch)
   write_aliases_ascii(fl, ch);
   save_char_vars_ascii(fl, ch);
 
-  fclose(fl);
+  bgsave_commit(&bf);
 
   /* More char_to_store code to add spell and eq affections back in. */
   for (i = 0; i < MAX_AFFECT; i++) {
@@ -787,8 +927,10 @@ void remove_player(int pfilepos)
 
   /* Unlink all player-owned files */
   for (i = 0; i < MAX_FILES; i++) {
-    if (get_filename(filename, sizeof(filename), i, player_table[pfilepos].name))
+    if (get_filename(filename, sizeof(filename), i, player_table[pfilepos].name)) {
+      bgsave_sync(filename);
       unlink(filename);
+    }
   }
 
   strftime(timestr, sizeof(timestr), "%c", localtime(&(player_table[pfilepos].last)));
@@ -0,0 +1,293 @@
+/**************************************************************************
+*  File: profiler.c                                        Part of tbaMUD *
+*  Usage: Latency histograms for the game loop and heartbeat phases.      *
+*                                                                         *
+*  All rights reserved.  See license for complete information.            *
+*                                                                         *
+*  Copyright (C) 1993, 94 by the Trustees of the Johns Hopkins University *
+*  CircleMUD is based on DikuMUD, Copyright (C) 1990, 1991.               *
+**************************************************************************/
+
+#include "conf.h"
+#include "sysdep.h"
+#include "structs.h"
+#include "utils.h"
+#include "comm.h"
+#include "interpreter.h"
+#include "db.h"
+#include "modify.h"
+#include "profiler.h"
+#include "autosave.h"
+#include "fight.h"
+#include "resolver.h"
+#include "keyword.h"
+
+/* Each histogram is log-linear, in the spirit of HdrHistogram: every power
+ * of two is split into PROF_SUB_BUCKETS equal buckets, so any sample is
+ * recorded to within 1/8th of its value and a phase from 1 usec to over an
+ * hour fits in 240 counters. */
+#define PROF_SUB_BITS     3
+#define PROF_SUB_BUCKETS  (1 << PROF_SUB_BITS)
+#define PROF_BUCKETS      ((32 - PROF_SUB_BITS + 1) * PROF_SUB_BUCKETS)
+
+struct prof_hist {
+  unsigned int counts[PROF_BUCKETS];
+  unsigned long samples;
+  unsigned long max;
+  double total;
+};
+
+static const char *prof_phase_names[NUM_PROF_PHASES] = {
+  "pulse",
+  "input",
+  "commands",
+  "output",
+  "heartbeat",
+  " events",
+  " scripts",
+  " msdp",
+  " zones",
+  " idlepwd",
+  " mobiles",
+  " violence",
+  " tick",
+  " affects",
+  " points",
+  " quests",
+  " autosave",
+  " usage",
+  " timesave",
+  " baseball",
+  " extract"
+};
+
+static struct prof_hist prof_data[PROF_SLOTS][NUM_PROF_PHASES];
+static int prof_slot = 0;                /* slot now being filled */
+static unsigned long prof_slot_start = 0; /* when it started, usec */
+static time_t prof_since = 0;           /* when the data was last cleared */
+
+static int prof_bucket(unsigned long usecs)
+{
+  int msb;
+
+  if (usecs < PROF_SUB_BUCKETS)
+    return (usecs);
+
+  if (usecs > 0xFFFFFFFFUL)
+    usecs = 0xFFFFFFFFUL;
+
+  for (msb = PROF_SUB_BITS; (usecs >> (msb + 1)) != 0; msb++)
+    ;
+
+  return ((msb - PROF_SUB_BITS + 1) * PROF_SUB_BUCKETS +
+          ((usecs >> (msb - PROF_SUB_BITS)) & (PROF_SUB_BUCKETS - 1)));
+}
+
+/* The largest value that lands in 'bucket'; percentiles err on the high side. */
+static unsigned long prof_bucket_value(int bucket)
+{
+  int shift;
+
+  if (bucket < PROF_SUB_BUCKETS)
+    return (bucket);
+
+  shift = bucket / PROF_SUB_BUCKETS - 1;
+  return ((((unsigned long) PROF_SUB_BUCKETS + bucket % PROF_SUB_BUCKETS) << shift) +
+          (1UL << shift) - 1);
+}
+
+/* Microseconds from a clock that never steps backwards. */
+unsigned long prof_now(void)
+{
+#ifdef CLOCK_MONOTONIC
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((unsigned long) ts.tv_sec * 1000000UL + ts.tv_nsec / 1000);
+#else
+  struct timeval tv;
+
+  gettimeofday(&tv, (struct timezone *) 0);
+  return ((unsigned long) tv.tv_sec * 1000000UL + tv.tv_usec);
+#endif
+}
+
+/* Charge the time since 'start' to 'phase' and return the current time, so
+ * consecutive phases can be timed by chaining calls. */
+unsigned long prof_lap(int phase, unsigned long start)
+{
+  unsigned long now = prof_now(), elapsed = now - start;
+  struct prof_hist *h;
+
+  if (!prof_since) {
+    prof_since = time(0);
+    prof_slot_start = now;
+  } else if (now - prof_slot_start >= PROF_SLOT_SECS * 1000000UL) {
+    prof_slot = (prof_slot + 1) % PROF_SLOTS;
+    memset(prof_data[prof_slot], 0, sizeof(prof_data[prof_slot]));
+    prof_slot_start = now;
+  }
+
+  h = &prof_data[prof_slot][phase];
+  h->counts[prof_bucket(elapsed)]++;
+  h->samples++;
+  h->total += elapsed;
+  if (elapsed > h->max)
+    h->max = elapsed;
+
+  return (now);
+}
+
+void prof_reset(void)
+{
+  memset(prof_data, 0, sizeof(prof_data));
+  prof_slot = 0;
+  prof_since = 0;
+}
+
+/* Fold every slot of one phase into a single histogram. */
+static void prof_merge(int phase, struct prof_hist *out)
+{
+  int slot, i;
+
+  memset(out, 0, sizeof(*out));
+  for (slot = 0; slot < PROF_SLOTS; slot++) {
+    struct prof_hist *h = &prof_data[slot][phase];
+
+    for (i = 0; i < PROF_BUCKETS; i++)
+      out->counts[i] += h->counts[i];
+    out->samples += h->samples;
+    out->total += h->total;
+    out->max = MAX(out->max, h->max);
+  }
+}
+
+static unsigned long prof_percentile(struct prof_hist *h, int pct)
+{
+  unsigned long want, seen = 0;
+  int i;
+
+  if (!h->samples)
+    return (0);
+
+  want = (h->samples * pct + 99) / 100;
+  for (i = 0; i < PROF_BUCKETS; i++)
+    if ((seen += h->counts[i]) >= want)
+      return (MIN(prof_bucket_value(i), h->max));
+
+  return (h->max);
+}
+
+/* Number of samples that took at least 'usecs'. */
+static unsigned long prof_count_over(struct prof_hist *h, unsigned long usecs)
+{
+  unsigned long over = 0;
+  int i;
+
+  for (i = prof_bucket(usecs); i < PROF_BUCKETS; i++)
+    over += h->counts[i];
+
+  return (over);
+}
+
+/* Writes the summary and every non-empty bucket to 'fname'.  Returns FALSE
+ * if the file could not be opened. */
+int prof_dump(const char *fname)
+{
+  struct prof_hist h;
+  FILE *fl;
+  int phase, i;
+
+  if (!(fl = fopen(fname, "w"))) {
+    log("SYSERR: Unable to open profile dump file '%s': %s", fname, strerror(errno));
+    return (FALSE);
+  }
+
+  fprintf(fl, "# tbaMUD pulse profile written %ld, collecting since %ld\n",
+          (long) time(0), (long) prof_since);
+  fprintf(fl, "# phase samples avg_usec p50 p99 max\n");
+  fprintf(fl, "# followed by bucket_upper_usec:count pairs\n");
+
+  for (phase = 0; phase < NUM_PROF_PHASES; phase++) {
+    const char *name = prof_phase_names[phase];
+
+    while (*name == ' ')	/* the indent is only for the in-game table */
+      name++;
+
+    prof_merge(phase, &h);
+    fprintf(fl, "%s %lu %.0f %lu %lu %lu\n", name, h.samples,
+            h.samples ? h.total / h.samples : 0.0,
+            prof_percentile(&h, 50), prof_percentile(&h, 99), h.max);
+    for (i = 0; i < PROF_BUCKETS; i++)
+      if (h.counts[i])
+        fprintf(fl, " %lu:%u", prof_bucket_value(i), h.counts[i]);
+    fprintf(fl, "\n");
+  }
+
+  fclose(fl);
+  return (TRUE);
+}
+
+ACMD(do_profile)
+{
+  char arg[MAX_INPUT_LENGTH], buf[MAX_STRING_LENGTH];
+  struct prof_hist h;
+  size_t len;
+  int phase;
+
+  one_argument(argument, arg);
+
+  if (*arg && is_abbrev(arg, "reset")) {
+    prof_reset();
+    send_to_char(ch, "Profile data cleared.\r\n");
+    mudlog(BRF, MAX(LVL_GOD, GET_INVIS_LEV(ch)), TRUE, "(GC) %s reset the pulse profile.", GET_NAME(ch));
+    return;
+  }
+
+  if (*arg && is_abbrev(arg, "dump")) {
+    if (prof_dump(PROFILE_FILE))
+      send_to_char(ch, "Profile written to %s.\r\n", PROFILE_FILE);
+    else
+      send_to_char(ch, "Could not write %s; see the syslog.\r\n", PROFILE_FILE);
+    return;
+  }
+
+  if (*arg) {
+    send_to_char(ch, "Usage: profile [reset | dump]\r\n");
+    return;
+  }
+
+  if (!prof_since) {
+    send_to_char(ch, "No samples recorded yet.\r\n");
+    return;
+  }
+
+  prof_merge(PROF_PULSE, &h);
+  len = snprintf(buf, sizeof(buf),
+         "Pulse profile, last %d minutes at most (since %-24.24s):\r\n"
+         "%lu passes, %lu over the %d usec budget.\r\n\r\n"
+         "Phase         Samples    Avg(us)    p50(us)    p99(us)    Max(us)\r\n"
+         "------------- ---------- ---------- ---------- ---------- ----------\r\n",
+         PROF_SLOTS * PROF_SLOT_SECS / 60, ctime(&prof_since),
+         h.samples, prof_count_over(&h, OPT_USEC), OPT_USEC);
+
+  for (phase = 0; phase < NUM_PROF_PHASES && len < sizeof(buf); phase++) {
+    prof_merge(phase, &h);
+    len += snprintf(buf + len, sizeof(buf) - len, "%-13s %10lu %10.0f %10lu %10lu %10lu\r\n",
+         prof_phase_names[phase], h.samples, h.samples ? h.total / h.samples : 0.0,
+         prof_percentile(&h, 50), prof_percentile(&h, 99), h.max);
+  }
+
+  if (len < sizeof(buf))
+    len += snprintf(buf + len, sizeof(buf) - len, "\r\n");
+  if (len < sizeof(buf))
+    len += autosave_status(buf + len, sizeof(buf) - len);
+  if (len < sizeof(buf))
+    len += combat_status(buf + len, sizeof(buf) - len);
+  if (len < sizeof(buf))
+    len += resolver_status(buf + len, sizeof(buf) - len);
+  if (len < sizeof(buf))
+    keyword_status(buf + len, sizeof(buf) - len);
+
+  page_string(ch->desc, buf, TRUE);
+}
@@ -0,0 +1,51 @@
+/**************************************************************************
+*  File: profiler.h                                        Part of tbaMUD *
+*  Usage: Latency histograms for the game loop and heartbeat phases.      *
+*                                                                         *
+*  All rights reserved.  See license for complete information.            *
+*                                                                         *
+*  Copyright (C) 1993, 94 by the Trustees of the Johns Hopkins University *
+*  CircleMUD is based on DikuMUD, Copyright (C) 1990, 1991.               *
+**************************************************************************/
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+/* Timed phases of one pass through game_loop().  The first group covers the
+ * pass itself, the second the pieces of heartbeat(). */
+#define PROF_PULSE      0  /* everything but the sleep */
+#define PROF_INPUT      1  /* poll, accept and process_input() */
+#define PROF_COMMANDS   2  /* nanny() and command_interpreter() */
+#define PROF_OUTPUT     3  /* process_output() and prompts */
+#define PROF_HEARTBEAT  4  /* all heartbeat() calls this pass */
+#define PROF_EVENTS     5  /* event_process() */
+#define PROF_SCRIPTS    6  /* script_trigger_check() */
+#define PROF_MSDP       7  /* msdp_update() */
+#define PROF_ZONES      8  /* zone_update() */
+#define PROF_IDLEPWD    9  /* check_idle_passwords() */
+#define PROF_MOBILES   10  /* mobile_activity() */
+#define PROF_VIOLENCE  11  /* perform_violence() */
+#define PROF_TICK      12  /* weather and time triggers */
+#define PROF_AFFECTS   13  /* affect_update() */
+#define PROF_POINTS    14  /* point_update() */
+#define PROF_QUESTS    15  /* check_timed_quests() */
+#define PROF_AUTOSAVE  16  /* autosave_step(), when it saved anything */
+#define PROF_USAGE     17  /* record_usage() */
+#define PROF_TIMESAVE  18  /* save_mud_time() */
+#define PROF_BALL      19  /* move_ball() */
+#define PROF_EXTRACT   20  /* extract_pending_chars() */
+/** Total number of timed phases. */
+#define NUM_PROF_PHASES 21
+
+/* Samples are kept in PROF_SLOTS windows of PROF_SLOT_SECS each; reports
+ * cover the whole ring, so they describe roughly the last five minutes. */
+#define PROF_SLOTS      5
+#define PROF_SLOT_SECS  60
+
+/* Exported function prototypes */
+unsigned long prof_now(void);
+unsigned long prof_lap(int phase, unsigned long start);
+void prof_reset(void);
+int prof_dump(const char *fname);
+ACMD(do_profile);
+
+#endif /* PROFILER_H_ */
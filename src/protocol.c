@@ -40,7 +40,7 @@ static void Write( descriptor_t *apDescriptor, const char *apData )
 {
    if ( apDescriptor != NULL)
    {
-      if ( apDescriptor->pProtocol->WriteOOB > 0 || *(apDescriptor->output) == '\0' )
+      if ( apDescriptor->pProtocol->WriteOOB > 0 || apDescriptor->out_bytes == 0 )
       {
          apDescriptor->pProtocol->WriteOOB = 2;
       }
@@ -61,24 +61,12 @@ static void InfoMessage( descriptor_t *apDescriptor, const char *apData )
 
 static void CompressStart( descriptor_t *apDescriptor )
 {
-   /* If your mud uses MCCP (Mud Client Compression Protocol), you need to 
-    * call whatever function normally starts compression from here - the 
-    * ReportBug() call should then be deleted.
-    * 
-    * Otherwise you can just ignore this function.
-    */
-   ReportBug( "CompressStart() in protocol.c is being called, but it doesn't do anything!\n" );
+   start_compression( apDescriptor );
 }
 
 static void CompressEnd( descriptor_t *apDescriptor )
 {
-   /* If your mud uses MCCP (Mud Client Compression Protocol), you need to 
-    * call whatever function normally starts compression from here - the 
-    * ReportBug() call should then be deleted.
-    * 
-    * Otherwise you can just ignore this function.
-    */
-   ReportBug( "CompressEnd() in protocol.c is being called, but it doesn't do anything!\n" );
+   end_compression( apDescriptor );
 }
 
 /******************************************************************************
@@ -859,6 +847,61 @@ const char *ProtocolOutput( descriptor_t *apDescriptor, const char *apData, int
    return Result;
 }
 
+output_share_t ProtocolOutputShared( const char *apData )
+{
+   output_share_t Share = eOUTPUT_PLAIN;
+   int j = 0;
+
+   for ( ; apData[j] != '\0'; ++j )
+   {
+      if ( j >= MAX_OUTPUT_BUFFER )
+         return eOUTPUT_EACH;
+      else if ( apData[j] == '!' && apData[j+1] == '!' )
+         Share = eOUTPUT_BY_CLASS;
+      else if ( apData[j] == '\t' )
+      {
+         switch ( apData[++j] )
+         {
+            case '<': case '(': case ')': /* MXP, which keeps state */
+               return eOUTPUT_EACH;
+            case '[':
+               if ( tolower(apData[j+1]) == 'x' )
+                  return eOUTPUT_EACH;
+               break;
+            case '\0':
+               return eOUTPUT_BY_CLASS;
+         }
+         Share = eOUTPUT_BY_CLASS;
+      }
+   }
+
+   return Share;
+}
+
+int ProtocolOutputClass( descriptor_t *apDescriptor )
+{
+   protocol_t *pProtocol = apDescriptor->pProtocol;
+   int Class = 0;
+
+   if ( pProtocol == NULL )
+      return 0;
+
+   /* The same tests ColourRGB() makes */
+   if ( pProtocol->pVariables[eMSDP_ANSI_COLORS]->ValueInt && 
+      (!apDescriptor->character || clr(apDescriptor->character, C_CMP)) )
+   {
+      Class |= 1;
+      if ( pProtocol->pVariables[eMSDP_XTERM_256_COLORS]->ValueInt )
+         Class |= 2;
+   }
+   if ( pProtocol->bMSP || pProtocol->pVariables[eMSDP_SOUND]->ValueInt )
+      Class |= 4;
+   if ( pProtocol->pVariables[eMSDP_UTF_8]->ValueInt )
+      Class |= 8;
+
+   return 1 + Class;
+}
+
 /* Some clients (such as GMud) don't properly handle negotiation, and simply 
  * display every printable character to the screen.  However TTYPE isn't a 
  * printable character, so we negotiate for it first, and only negotiate for 
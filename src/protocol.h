@@ -14,12 +14,12 @@
 typedef struct descriptor_data descriptor_t;
 
 /******************************************************************************
- If your mud supports MCCP (compression), uncomment the next line.
+ MCCP (compression) is offered whenever configure found zlib.
  ******************************************************************************/
 
-/*
+#ifdef HAVE_ZLIB
 #define USING_MCCP
-*/
+#endif
 
 /******************************************************************************
  If your offer a Mudlet GUI for autoinstallation, put the path/filename here.
@@ -319,6 +319,31 @@ ssize_t ProtocolInput( descriptor_t *apDescriptor, char *apData, int aSize, char
  */
 const char *ProtocolOutput( descriptor_t *apDescriptor, const char *apData, int *apLength );
 
+/* Function: ProtocolOutputShared
+ *
+ * Tells a caller sending the same string to many descriptors how often it 
+ * really needs to call ProtocolOutput().  Returns eOUTPUT_PLAIN if the 
+ * result would be the string itself for everyone, eOUTPUT_BY_CLASS if it 
+ * would be the same for any two descriptors with the same 
+ * ProtocolOutputClass(), or eOUTPUT_EACH if it depends on more than that 
+ * (MXP tags, or a string too long for the output buffer).
+ */
+typedef enum
+{
+   eOUTPUT_EACH = -1, 
+   eOUTPUT_PLAIN, 
+   eOUTPUT_BY_CLASS
+} output_share_t;
+
+output_share_t ProtocolOutputShared( const char *apData );
+
+/* Function: ProtocolOutputClass
+ *
+ * Returns a small number standing for the colour, sound and UTF-8 settings 
+ * of the descriptor that ProtocolOutput() looks at (see above).
+ */
+int ProtocolOutputClass( descriptor_t *apDescriptor );
+
 /******************************************************************************
  Copyover save/load functions.
  ******************************************************************************/
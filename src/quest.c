@@ -46,6 +46,23 @@ const char *aq_flags[] = {
  *--------------------------------------------------------------------------*/
 static int cmd_tell;
 
+/* The quest table is looked up by vnum on every kill, pickup and step a
+ * questing player makes, and by questmaster on every command typed near
+ * one, so both are hashed.  The hashes are rebuilt the first time they are
+ * needed after quest_table_changed().  Each questmaster's quests are kept
+ * together in qm_quests, in table order. */
+struct qm_slot {
+  mob_vnum qm;
+  int used;
+  int first, count;             /* its quests in qm_quests */
+};
+
+static qst_rnum *vnum_slots = NULL;     /* rnums by vnum; NOTHING is empty */
+static struct qm_slot *qm_slots = NULL;
+static qst_rnum *qm_quests = NULL;
+static int quest_slots = 0;             /* size of both hashes */
+static int quest_index_built = FALSE;
+
 static const char *quest_cmd[] = {
   "", "Ϸ", "", "", "", "", "\n"};
 
@@ -59,36 +76,153 @@ static const char *quest_imm_usage =
 /* Utility Functions                                                        */
 /*--------------------------------------------------------------------------*/
 
+static unsigned int quest_hash(IDXTYPE vnum, int slots)
+{
+  return (((unsigned int) vnum * 2654435761u) & (slots - 1));
+}
+
+static struct qm_slot *find_qm(mob_vnum qm)
+{
+  unsigned int h;
+
+  for (h = quest_hash(qm, quest_slots); qm_slots[h].used; h = (h + 1) & (quest_slots - 1))
+    if (qm_slots[h].qm == qm)
+      return (&qm_slots[h]);
+  return (NULL);
+}
+
+static void build_quest_index(void)
+{
+  struct qm_slot *q;
+  qst_rnum rnum;
+  unsigned int h;
+  int first = 0;
+
+  for (quest_slots = 16; quest_slots < total_quests * 2; quest_slots *= 2)
+    ;
+  RECREATE(vnum_slots, qst_rnum, quest_slots);
+  RECREATE(qm_slots, struct qm_slot, quest_slots);
+  RECREATE(qm_quests, qst_rnum, MAX(total_quests, 1));
+  memset(qm_slots, 0, sizeof(struct qm_slot) * quest_slots);
+  for (h = 0; h < quest_slots; h++)
+    vnum_slots[h] = NOTHING;
+
+  for (rnum = 0; rnum < total_quests; rnum++) {
+    /* The first of a vnum wins, as it did when the table was scanned. */
+    for (h = quest_hash(QST_NUM(rnum), quest_slots); vnum_slots[h] != NOTHING; h = (h + 1) & (quest_slots - 1))
+      if (QST_NUM(vnum_slots[h]) == QST_NUM(rnum))
+        break;
+    if (vnum_slots[h] == NOTHING)
+      vnum_slots[h] = rnum;
+
+    if ((q = find_qm(QST_MASTER(rnum))) == NULL) {
+      for (h = quest_hash(QST_MASTER(rnum), quest_slots); qm_slots[h].used; h = (h + 1) & (quest_slots - 1))
+        ;
+      q = &qm_slots[h];
+      q->qm = QST_MASTER(rnum);
+      q->used = TRUE;
+    }
+    q->count++;
+  }
+
+  for (h = 0; h < quest_slots; h++)
+    if (qm_slots[h].used) {
+      qm_slots[h].first = first;
+      first += qm_slots[h].count;
+      qm_slots[h].count = 0;
+    }
+  for (rnum = 0; rnum < total_quests; rnum++) {
+    q = find_qm(QST_MASTER(rnum));
+    qm_quests[q->first + q->count++] = rnum;
+  }
+
+  quest_index_built = TRUE;
+}
+
+/** Marks the quest table as changed: loaded, added to, deleted from, or a
+ * quest edited. */
+void quest_table_changed(void)
+{
+  quest_index_built = FALSE;
+}
+
 qst_rnum real_quest(qst_vnum vnum)
 {
-  int rnum;
+  unsigned int h;
+
+  if (!quest_index_built)
+    build_quest_index();
 
-  for (rnum = 0; rnum < total_quests; rnum++)
-    if (QST_NUM(rnum) == vnum)
-      return(rnum);
+  for (h = quest_hash(vnum, quest_slots); vnum_slots[h] != NOTHING; h = (h + 1) & (quest_slots - 1))
+    if (QST_NUM(vnum_slots[h]) == vnum)
+      return (vnum_slots[h]);
   return(NOTHING);
 }
 
-int is_complete(struct char_data *ch, qst_vnum vnum)
+/* The quests given out by questmaster qm, in table order; returns how
+ * many. */
+static int quests_of(mob_vnum qm, qst_rnum **rnums)
+{
+  struct qm_slot *q;
+
+  if (!quest_index_built)
+    build_quest_index();
+
+  if ((q = find_qm(qm)) == NULL)
+    return (0);
+  *rnums = qm_quests + q->first;
+  return (q->count);
+}
+
+/* Each player's completed quests are hashed alongside the saved list, which
+ * keeps the order they were done in.  The hash is kept at most half full;
+ * NOTHING marks an empty slot. */
+static void completed_insert(struct player_special_data *ps, qst_vnum vnum)
+{
+  unsigned int h;
+
+  for (h = quest_hash(vnum, ps->quests_done_size); ps->quests_done[h] != NOTHING; h = (h + 1) & (ps->quests_done_size - 1))
+    if (ps->quests_done[h] == vnum)
+      return;
+  ps->quests_done[h] = vnum;
+}
+
+static void completed_rehash(struct player_special_data *ps)
 {
   int i;
 
-  for (i = 0; i < GET_NUM_QUESTS(ch); i++)
-    if (ch->player_specials->saved.completed_quests[i] == vnum)
+  for (ps->quests_done_size = 16; ps->quests_done_size < ps->saved.num_completed_quests * 2;)
+    ps->quests_done_size *= 2;
+  RECREATE(ps->quests_done, qst_vnum, ps->quests_done_size);
+  for (i = 0; i < ps->quests_done_size; i++)
+    ps->quests_done[i] = NOTHING;
+
+  for (i = 0; i < ps->saved.num_completed_quests; i++)
+    if (ps->saved.completed_quests[i] != NOTHING)
+      completed_insert(ps, ps->saved.completed_quests[i]);
+}
+
+int is_complete(struct char_data *ch, qst_vnum vnum)
+{
+  struct player_special_data *ps = ch->player_specials;
+  unsigned int h;
+
+  if (!ps->quests_done_size || vnum == NOTHING)
+    return FALSE;
+
+  for (h = quest_hash(vnum, ps->quests_done_size); ps->quests_done[h] != NOTHING; h = (h + 1) & (ps->quests_done_size - 1))
+    if (ps->quests_done[h] == vnum)
       return TRUE;
   return FALSE;
 }
 
 qst_vnum find_quest_by_qmnum(struct char_data *ch, mob_vnum qm, int num)
 {
-  qst_rnum rnum;
-  int found=0;
-  for (rnum = 0; rnum < total_quests; rnum++) {
-    if (qm == QST_MASTER(rnum))
-      if (++found == num)
-        return (QST_NUM(rnum));
-  }
-  return NOTHING;
+  qst_rnum *rnums;
+
+  if (num < 1 || num > quests_of(qm, &rnums))
+    return NOTHING;
+  return (QST_NUM(rnums[num - 1]));
 }
 
 /*--------------------------------------------------------------------------*/
@@ -108,6 +242,7 @@ void destroy_quests(void)
   free(aquest_table);
   aquest_table = NULL;
   total_quests = 0;
+  quest_table_changed();
 
   return;
 }
@@ -203,6 +338,7 @@ void parse_quest(FILE *quest_f, int nr)
     switch(*line) {
     case 'S':
       total_quests = ++i;
+      quest_table_changed();
       return;
     }
   }
@@ -254,36 +390,34 @@ void clear_quest(struct char_data *ch)
 
 void add_completed_quest(struct char_data *ch, qst_vnum vnum)
 {
-  qst_vnum *temp;
-  int i;
+  struct player_special_data *ps = ch->player_specials;
 
-  CREATE(temp, qst_vnum, GET_NUM_QUESTS(ch) +1);
-  for (i=0; i < GET_NUM_QUESTS(ch); i++)
-    temp[i] = ch->player_specials->saved.completed_quests[i];
-
-  temp[GET_NUM_QUESTS(ch)] = vnum;
+  if (GET_NUM_QUESTS(ch) >= ps->quests_max) {
+    ps->quests_max = MAX(16, ps->quests_max * 2);
+    RECREATE(ps->saved.completed_quests, qst_vnum, ps->quests_max);
+  }
+  ps->saved.completed_quests[GET_NUM_QUESTS(ch)] = vnum;
   GET_NUM_QUESTS(ch)++;
 
-  if (ch->player_specials->saved.completed_quests)
-    free(ch->player_specials->saved.completed_quests);
-  ch->player_specials->saved.completed_quests = temp;
+  if (GET_NUM_QUESTS(ch) * 2 > ps->quests_done_size)
+    completed_rehash(ps);
+  else if (vnum != NOTHING)
+    completed_insert(ps, vnum);
 }
 
 void remove_completed_quest(struct char_data *ch, qst_vnum vnum)
 {
-  qst_vnum *temp;
+  struct player_special_data *ps = ch->player_specials;
   int i, j = 0;
 
-  CREATE(temp, qst_vnum, GET_NUM_QUESTS(ch));
   for (i = 0; i < GET_NUM_QUESTS(ch); i++)
-    if (ch->player_specials->saved.completed_quests[i] != vnum)
-      temp[j++] = ch->player_specials->saved.completed_quests[i];
+    if (ps->saved.completed_quests[i] != vnum)
+      ps->saved.completed_quests[j++] = ps->saved.completed_quests[i];
 
+  /* As before, the count drops by one however many were taken out. */
   GET_NUM_QUESTS(ch)--;
 
-  if (ch->player_specials->saved.completed_quests)
-    free(ch->player_specials->saved.completed_quests);
-  ch->player_specials->saved.completed_quests = temp;
+  completed_rehash(ps);
 }
 
 void generic_complete_quest(struct char_data *ch)
@@ -630,18 +764,18 @@ static void quest_progress(struct char_data *ch)
 
 static void quest_show(struct char_data *ch, mob_vnum qm)
 {
-  qst_rnum rnum;
-  int counter = 0;
+  qst_rnum *rnums;
+  int i, n, counter = 0;
 
   send_to_char(ch,
   "  Ʈ:\r\n"
   "      (ȣ)   ϷῩ?\r\n"
   "----- ---------------------------------------------------- ------- -----\r\n");
-  for (rnum = 0; rnum < total_quests; rnum++)
-    if (qm == QST_MASTER(rnum))
-      send_to_char(ch, "\tg%d\tn) \tc%s\tn \ty(%d)\tn \ty(%s)\tn\r\n",
-        ++counter, QST_DESC(rnum), QST_NUM(rnum),
-        (is_complete(ch, QST_NUM(rnum)) ? "Ϸ" : "̿Ϸ"));
+  n = quests_of(qm, &rnums);
+  for (i = 0; i < n; i++)
+    send_to_char(ch, "\tg%d\tn) \tc%s\tn \ty(%d)\tn \ty(%s)\tn\r\n",
+      ++counter, QST_DESC(rnums[i]), QST_NUM(rnums[i]),
+      (is_complete(ch, QST_NUM(rnums[i])) ? "Ϸ" : "̿Ϸ"));
   if (!counter)
     send_to_char(ch, "   ӹ ϴ.\r\n");
 }
@@ -789,17 +923,16 @@ ACMD(do_quest)
 
 SPECIAL(questmaster)
 {
-  qst_rnum rnum;
+  qst_rnum rnum, *rnums;
   char arg1[MAX_INPUT_LENGTH], arg2[MAX_INPUT_LENGTH];
   int  tp;
   struct char_data *qm = (struct char_data *)me;
 
   /* check that qm mob has quests assigned */
-  for (rnum = 0; (rnum < total_quests &&
-      QST_MASTER(rnum) != GET_MOB_VNUM(qm)) ; rnum ++);
-  if (rnum >= total_quests)
+  if (!quests_of(GET_MOB_VNUM(qm), &rnums))
     return FALSE; /* No quests for this mob */
-  else if (QST_FUNC(rnum) && (QST_FUNC(rnum) (ch, me, cmd, argument)))
+  rnum = rnums[0];
+  if (QST_FUNC(rnum) && (QST_FUNC(rnum) (ch, me, cmd, argument)))
     return TRUE;  /* The secondary spec proc handled this command */
   else if (CMD_IS("ӹ")) {
     two_arguments(argument, arg1, arg2);
@@ -0,0 +1,341 @@
+/**************************************************************************
+*  File: resolver.c                                        Part of tbaMUD *
+*  Usage: Looks up the names of connecting sites off the game thread.     *
+*                                                                         *
+*  All rights reserved.  See license for complete information.            *
+*                                                                         *
+*  Copyright (C) 1993, 94 by the Trustees of the Johns Hopkins University *
+*  CircleMUD is based on DikuMUD, Copyright (C) 1990, 1991.               *
+**************************************************************************/
+
+#include "conf.h"
+#include "sysdep.h"
+#include "structs.h"
+#include "utils.h"
+#include "profiler.h"
+#include "resolver.h"
+
+/* A reverse lookup can take seconds, or time out altogether, so the game
+ * never waits for one.  resolver_lookup() answers from the cache when it
+ * can, and otherwise queues the address for one of RESOLVER_THREADS threads
+ * and says so; the connection carries on under its numeric address.
+ * resolver_poll(), called every pass, takes the finished lookups, caches
+ * them and hands each to the done function given to resolver_init().
+ *
+ * Only the queue is shared with the threads.  The cache, the counters and
+ * the done function belong to the game thread.  An address already being
+ * looked up is not queued again.  Without pthreads the lookup is made on
+ * the spot, as the game always used to. */
+#define RESOLVER_BUCKETS  256
+#define RESOLVER_NAME     256   /* longest name kept, with its NUL */
+
+struct resolve_job {
+  struct in_addr addr;
+  char name[RESOLVER_NAME];
+  int found;
+  unsigned long usec;         /* how long the lookup took */
+  struct resolve_job *next;
+};
+
+struct resolve_entry {
+  struct in_addr addr;
+  char *name;                 /* NULL if it has none */
+  time_t expires;             /* 0 while the lookup is under way */
+  struct resolve_entry *next;
+};
+
+static int default_lookup(struct in_addr addr, char *name, size_t len);
+
+static resolver_fn backend = default_lookup;
+static resolver_done_fn report = NULL;
+
+static struct resolve_entry *cache[RESOLVER_BUCKETS];
+static int cache_count = 0;
+static int waiting = 0;       /* queued or being looked up */
+static unsigned long hits = 0, lookups = 0, failures = 0;
+static unsigned long usec_total = 0, usec_max = 0;
+
+static struct resolve_job *queue = NULL, *queue_tail = NULL;
+static struct resolve_job *finished = NULL;
+
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t resolver_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t resolver_work = PTHREAD_COND_INITIALIZER;
+static int resolver_running = FALSE, resolver_stopping = FALSE;
+#define LOCK()   pthread_mutex_lock(&resolver_lock)
+#define UNLOCK() pthread_mutex_unlock(&resolver_lock)
+#else
+#define LOCK()
+#define UNLOCK()
+#endif
+
+/* The system resolver.  getnameinfo() is thread safe; gethostbyaddr() is
+ * not, but without pthreads it is only ever called from the game thread. */
+static int default_lookup(struct in_addr addr, char *name, size_t len)
+{
+#ifdef HAVE_PTHREAD
+  struct sockaddr_in sa;
+
+  memset(&sa, 0, sizeof(sa));
+  sa.sin_family = AF_INET;
+  sa.sin_addr = addr;
+
+  return (getnameinfo((struct sockaddr *) &sa, sizeof(sa), name, len, NULL, 0, NI_NAMEREQD) == 0);
+#else
+  struct hostent *from;
+
+  if (!(from = gethostbyaddr((char *) &addr, sizeof(addr), AF_INET)))
+    return (FALSE);
+  strlcpy(name, from->h_name, len);
+  return (TRUE);
+#endif
+}
+
+static int resolver_hash(struct in_addr addr)
+{
+  unsigned long a = ntohl(addr.s_addr);
+
+  return ((a ^ (a >> 8) ^ (a >> 16)) % RESOLVER_BUCKETS);
+}
+
+static struct resolve_entry *cache_find(struct in_addr addr)
+{
+  struct resolve_entry *e;
+
+  for (e = cache[resolver_hash(addr)]; e; e = e->next)
+    if (e->addr.s_addr == addr.s_addr)
+      return (e);
+  return (NULL);
+}
+
+/* Forget finished entries: those that have run out or, with 'all', every
+ * one.  Lookups under way are kept so they are not queued twice. */
+static void cache_prune(int all)
+{
+  struct resolve_entry *e, **prev;
+  time_t now = time(0);
+  int i;
+
+  for (i = 0; i < RESOLVER_BUCKETS; i++)
+    for (prev = &cache[i]; (e = *prev) != NULL; ) {
+      if (e->expires && (all || e->expires <= now)) {
+        *prev = e->next;
+        if (e->name)
+          free(e->name);
+        free(e);
+        cache_count--;
+      } else
+        prev = &e->next;
+    }
+}
+
+static struct resolve_entry *cache_add(struct in_addr addr)
+{
+  struct resolve_entry *e;
+  int h;
+
+  if (cache_count >= RESOLVER_CACHE_MAX) {
+    cache_prune(FALSE);
+    if (cache_count >= RESOLVER_CACHE_MAX)
+      cache_prune(TRUE);
+  }
+
+  CREATE(e, struct resolve_entry, 1);
+  e->addr = addr;
+  h = resolver_hash(addr);
+  e->next = cache[h];
+  cache[h] = e;
+  cache_count++;
+
+  return (e);
+}
+
+/* Record how a lookup went, on the game thread. */
+static void resolve_finish(struct resolve_job *job)
+{
+  struct resolve_entry *e;
+
+  if ((e = cache_find(job->addr)) == NULL)
+    e = cache_add(job->addr);
+  if (e->name)
+    free(e->name);
+  e->name = job->found ? strdup(job->name) : NULL;
+  e->expires = time(0) + (job->found ? RESOLVER_TTL : RESOLVER_FAIL_TTL);
+
+  lookups++;
+  if (!job->found)
+    failures++;
+  usec_total += job->usec;
+  usec_max = MAX(usec_max, job->usec);
+}
+
+static void resolve_run(struct resolve_job *job)
+{
+  unsigned long start = prof_now();
+
+  job->found = backend(job->addr, job->name, sizeof(job->name));
+  job->usec = prof_now() - start;
+}
+
+#ifdef HAVE_PTHREAD
+static void *resolver_main(void *unused)
+{
+  struct resolve_job *job;
+
+  LOCK();
+  for (;;) {
+    while (!queue && !resolver_stopping)
+      pthread_cond_wait(&resolver_work, &resolver_lock);
+    if (resolver_stopping)
+      break;
+
+    job = queue;
+    if ((queue = job->next) == NULL)
+      queue_tail = NULL;
+    UNLOCK();
+
+    resolve_run(job);
+
+    LOCK();
+    job->next = finished;
+    finished = job;
+  }
+  UNLOCK();
+
+  return (NULL);
+}
+#endif
+
+/** Starts the lookup threads.  'done' hears about every lookup that
+ * resolver_lookup() had to queue. */
+void resolver_init(resolver_done_fn done)
+{
+#ifdef HAVE_PTHREAD
+  sigset_t all, old;
+  pthread_t thread;
+  int i;
+#endif
+
+  report = done;
+
+#ifdef HAVE_PTHREAD
+  /* Signals are for the game thread. */
+  sigfillset(&all);
+  pthread_sigmask(SIG_SETMASK, &all, &old);
+  for (i = 0; i < RESOLVER_THREADS; i++) {
+    if (pthread_create(&thread, NULL, resolver_main, NULL) != 0) {
+      log("SYSERR: resolver: thread %d not started: %s", i, strerror(errno));
+      break;
+    }
+    pthread_detach(thread);
+    resolver_running = TRUE;
+  }
+  pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+  if (!resolver_running)
+    log("SYSERR: resolver: looking up site names on the game thread.");
+#endif
+}
+
+/** Tells the threads to stop.  One stuck in a lookup is left to finish on
+ * its own rather than holding up a shutdown or copyover. */
+void resolver_shutdown(void)
+{
+#ifdef HAVE_PTHREAD
+  if (resolver_running) {
+    LOCK();
+    resolver_stopping = TRUE;
+    pthread_cond_broadcast(&resolver_work);
+    UNLOCK();
+  }
+#endif
+}
+
+/** Replaces the system resolver, for testing without a network. */
+void resolver_set_backend(resolver_fn fn)
+{
+  backend = fn ? fn : default_lookup;
+}
+
+/** Looks up the name of 'addr'.  Returns RESOLVE_FOUND with the name in
+ * 'name', RESOLVE_NONE if it has none, or RESOLVE_PENDING if the answer
+ * will come through the done function instead. */
+int resolver_lookup(struct in_addr addr, char *name, size_t len)
+{
+  struct resolve_entry *e;
+  struct resolve_job *job;
+
+  if ((e = cache_find(addr)) != NULL) {
+    if (!e->expires)
+      return (RESOLVE_PENDING);
+    if (e->expires > time(0)) {
+      hits++;
+      if (!e->name)
+        return (RESOLVE_NONE);
+      strlcpy(name, e->name, len);
+      return (RESOLVE_FOUND);
+    }
+  } else
+    e = cache_add(addr);
+
+  e->expires = 0;
+
+  CREATE(job, struct resolve_job, 1);
+  job->addr = addr;
+
+#ifdef HAVE_PTHREAD
+  if (resolver_running && !resolver_stopping) {
+    LOCK();
+    if (queue_tail)
+      queue_tail->next = job;
+    else
+      queue = job;
+    queue_tail = job;
+    pthread_cond_signal(&resolver_work);
+    UNLOCK();
+    waiting++;
+    return (RESOLVE_PENDING);
+  }
+#endif
+
+  resolve_run(job);
+  resolve_finish(job);
+  if (job->found)
+    strlcpy(name, job->name, len);
+  free(job);
+
+  return (e->name ? RESOLVE_FOUND : RESOLVE_NONE);
+}
+
+/** Passes on the lookups the threads have finished.  Game thread only. */
+void resolver_poll(void)
+{
+  struct resolve_job *job, *next;
+
+  if (!waiting)
+    return;
+
+  LOCK();
+  job = finished;
+  finished = NULL;
+  UNLOCK();
+
+  for (; job; job = next) {
+    next = job->next;
+    waiting--;
+    resolve_finish(job);
+    if (report)
+      report(job->addr, job->found ? job->name : NULL);
+    free(job);
+  }
+}
+
+/* One status line for the 'profile' command. */
+size_t resolver_status(char *buf, size_t len)
+{
+  return snprintf(buf, len,
+      "Resolver: %d cached, %lu hits, %lu lookups (%lu failed, avg %lu us, "
+      "max %lu us), %d waiting.\r\n",
+      cache_count, hits, lookups, failures,
+      lookups ? usec_total / lookups : 0, usec_max, waiting);
+}
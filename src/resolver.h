@@ -0,0 +1,39 @@
+/**************************************************************************
+*  File: resolver.h                                        Part of tbaMUD *
+*  Usage: Looks up the names of connecting sites off the game thread.     *
+*                                                                         *
+*  All rights reserved.  See license for complete information.            *
+*                                                                         *
+*  Copyright (C) 1993, 94 by the Trustees of the Johns Hopkins University *
+*  CircleMUD is based on DikuMUD, Copyright (C) 1990, 1991.               *
+**************************************************************************/
+#ifndef RESOLVER_H_
+#define RESOLVER_H_
+
+#define RESOLVER_THREADS    2     /* lookups that can be waiting at once */
+#define RESOLVER_TTL        3600  /* seconds a name is remembered */
+#define RESOLVER_FAIL_TTL   300   /* ...and an address without one */
+#define RESOLVER_CACHE_MAX  4096  /* addresses remembered at most */
+
+/** Finds the name of 'addr' and writes it into 'name'; returns FALSE if it
+ * has none.  Runs on a resolver thread, so it must not touch the game. */
+typedef int (*resolver_fn)(struct in_addr addr, char *name, size_t len);
+
+/** Called on the game thread with the name of 'addr' (NULL if it has none)
+ * once a lookup started by resolver_lookup() finishes. */
+typedef void (*resolver_done_fn)(struct in_addr addr, const char *name);
+
+/* What resolver_lookup() found. */
+#define RESOLVE_NONE     0  /* the address has no name */
+#define RESOLVE_FOUND    1  /* the name was copied out */
+#define RESOLVE_PENDING  2  /* being looked up; the done function will say */
+
+/* Exported function prototypes */
+void resolver_init(resolver_done_fn done);
+void resolver_shutdown(void);
+void resolver_set_backend(resolver_fn fn);
+int resolver_lookup(struct in_addr addr, char *name, size_t len);
+void resolver_poll(void);
+size_t resolver_status(char *buf, size_t len);
+
+#endif /* RESOLVER_H_ */
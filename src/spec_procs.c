@@ -26,6 +26,7 @@
 #include "class.h"
 #include "fight.h"
 #include "modify.h"
+#include "keyword.h"
 
 
 /* locally defined functions of local (file) scope */
@@ -631,6 +632,7 @@ SPECIAL(pet_shops)
       snprintf(buf, sizeof(buf), "%s %s", pet->player.name, pet_name);
       /* free(pet->player.name); don't free the prototype! */
       pet->player.name = strdup(buf);
+      keyword_char_renamed(pet);
 
       snprintf(buf, sizeof(buf), "%sA small sign on a chain around the neck says 'My name is %s'\r\n",
 	      pet->player.description, pet_name);
@@ -21,6 +21,7 @@
 #include "dg_scripts.h"
 #include "act.h"
 #include "fight.h"
+#include "keyword.h"
 
 
 
@@ -210,9 +211,9 @@ static int isname_obj(char *search, char *list)
 
 ASPELL(spell_locate_object)
 {
-  struct obj_data *i;
+  struct obj_data *i, **found;
   char name[MAX_INPUT_LENGTH];
-  int j;
+  int j, k, n;
 
   if (!obj) {
     send_to_char(ch, "You sense nothing.\r\n");
@@ -224,7 +225,10 @@ ASPELL(spell_locate_object)
 
   j = GET_LEVEL(ch) / 2;  /* # items to show = twice char's level */
 
-  for (i = object_list; i && (j > 0); i = i->next) {
+  /* isname_obj() matches only what the keyword index would offer. */
+  n = keyword_objs(name, &found);
+  for (k = 0; k < n && (j > 0); k++) {
+    i = found[k];
     if (!isname_obj(name, i->name))
       continue;
 
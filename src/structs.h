@@ -593,8 +593,12 @@
 #define MAX_PROMPT_LENGTH  96          /**< Max length of prompt        */
 #define GARBAGE_SPACE      32          /**< Space for **OVERFLOW** etc  */
 #define SMALL_BUFSIZE      1024        /**< Static output buffer size   */
-/** Max amount of output that can be buffered */
+/** Max amount of output that one write_to_output() call can add */
 #define LARGE_BUFSIZE      (MAX_SOCK_BUF - GARBAGE_SPACE - MAX_PROMPT_LENGTH)
+#define OUT_BLOCK_SIZE     4096        /**< Text held by one out_block  */
+/** Max amount of output queued for one descriptor; past this it is dropped
+ * until the queue has drained, and the player is told **OVERFLOW**. */
+#define MAX_OUTPUT_QUEUE   (8 * MAX_SOCK_BUF)
 
 #define MAX_STRING_LENGTH     49152  /**< Max length of string, as defined */
 #define MAX_INPUT_LENGTH      512    /**< Max length per *line* of input */
@@ -951,6 +955,7 @@ struct char_special_data
   int carry_weight; /**< Carried weight */
   byte carry_items; /**< Number of items carried */
   int timer;        /**< Timer for update */
+  bool zone_counted; /**< Counted in its zone's players; see char_to_room() */
 
   struct char_special_data_saved saved; /**< Constants saved for PCs. */
 };
@@ -996,6 +1001,9 @@ struct player_special_data
   int last_olc_mode;     /**< ? Currently Unused ? */
   char *host;            /**< Resolved hostname, or ip, for player. */
   int buildwalk_sector;  /**< Default sector type for buildwalk */
+  int quests_max;        /**< Room in saved.completed_quests */
+  qst_vnum *quests_done; /**< saved.completed_quests hashed, for is_complete() */
+  int quests_done_size;  /**< Slots in quests_done */
 };
 
 /** Special data used by NPCs, not PCs */
@@ -1086,6 +1094,26 @@ struct txt_q
   struct txt_block *tail; /**< ? */
 };
 
+/** Text waiting to be sent.  A block can be shared by the output queues of
+ * more than one descriptor (a snooper sees what its victim sees), and goes
+ * back to its pool when the last segment using it has been sent. */
+struct out_block
+{
+  int refs;                  /**< out_segs pointing into text */
+  size_t len;                /**< bytes of text filled in */
+  char text[OUT_BLOCK_SIZE]; /**< not NUL terminated */
+};
+
+/** One piece of a descriptor's output queue: len unsent bytes of block,
+ * starting at off. */
+struct out_seg
+{
+  struct out_block *block;   /**< where the text is */
+  size_t off;                /**< first unsent byte in block->text */
+  size_t len;                /**< unsent bytes from there */
+  struct out_seg *next;      /**< next piece of output, or NULL */
+};
+
 /** Master structure players. Holds the real players connection to the mud.
  * An analogy is the char_data is the body of the character, the descriptor_data
  * is the soul. */
@@ -1093,6 +1121,8 @@ struct descriptor_data
 {
   socket_t descriptor;      /**< file descriptor for socket */
   char host[HOST_LENGTH+1]; /**< hostname */
+  bool resolving;           /**< host is numeric until the lookup is back */
+  struct in_addr addr;      /**< numeric address, for address block bans */
   byte bad_pws;             /**< number of bad pw attemps this login */
   byte idle_tics;           /**< tics idle at password prompt		*/
   int connected;            /**< mode of 'connectedness'		*/
@@ -1107,15 +1137,16 @@ struct descriptor_data
   size_t max_str;           /**< maximum size of string in modify-str	*/
   long mail_to;             /**< name for mail system			*/
   int has_prompt;           /**< is the user at a prompt?             */
+  int io_flags;             /**< readiness reported by the I/O backend */
+  struct compr_data *comp;  /**< MCCP stream, NULL when not compressing */
   char inbuf[MAX_RAW_INPUT_LENGTH];  /**< buffer for raw input		*/
   char last_input[MAX_INPUT_LENGTH]; /**< the last input			*/
-  char small_outbuf[SMALL_BUFSIZE];  /**< standard output buffer		*/
-  char *output;             /**< ptr to the current output buffer	*/
+  struct out_seg *out_head; /**< output waiting to be sent, oldest first */
+  struct out_seg *out_tail; /**< newest output, appended to if we can	*/
+  size_t out_bytes;         /**< unsent bytes from out_head to out_tail	*/
+  int out_overflow;         /**< output dropped since the queue emptied	*/
   char **history;           /**< History of commands, for ! mostly.	*/
   int history_pos;          /**< Circular array position.		*/
-  int bufptr;               /**< ptr to end of current output		*/
-  int bufspace;             /**< space left in the output buffer	*/
-  struct txt_block *large_outbuf; /**< ptr to large buffer, if we need it */
   struct txt_q input;       /**< q of unprocessed input		*/
   struct char_data *character; /**< linked to char			*/
   struct char_data *original;  /**< original char if switched		*/
@@ -181,6 +181,22 @@ struct in_addr {
 #include <sys/select.h>
 #endif
 
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
 #ifdef HAVE_FCNTL_H
 #include <fcntl.h>
 #endif
@@ -225,6 +241,13 @@ struct in_addr {
 
 #ifdef HAVE_SYS_UIO_H
 # include <sys/uio.h>
+#else
+/* comm.c passes output around in these; without writev() it sends them one
+ * at a time. */
+struct iovec {
+  void *iov_base;
+  size_t iov_len;
+};
 #endif
 
 #ifdef HAVE_SYS_STAT_H
@@ -22,6 +22,7 @@
 #include "handler.h"
 #include "interpreter.h"
 #include "class.h"
+#include "bootpool.h"
 
 
 /** Aportable random number function.
@@ -202,6 +203,10 @@ void basic_mud_vlog(const char *format, va_list args)
   if (format == NULL)
     format = "SYSERR: log() received a NULL format.";
 
+  /* A world file being parsed by a boot worker; see bootpool.c. */
+  if (bootpool_capture(format, args))
+    return;
+
   for (i=0;i<21;i++) timestr[i]=0;
   strftime(timestr, sizeof(timestr), "%b %d %H:%M:%S %Y", localtime(&ct));
 
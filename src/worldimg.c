@@ -0,0 +1,419 @@
+/**************************************************************************
+*  File: worldimg.c                                        Part of tbaMUD *
+*  Usage: Compiled image of the room files, loaded instead of parsing.    *
+*                                                                         *
+*  All rights reserved.  See license for complete information.            *
+*                                                                         *
+*  Copyright (C) 1993, 94 by the Trustees of the Johns Hopkins University *
+*  CircleMUD is based on DikuMUD, Copyright (C) 1990, 1991.               *
+**************************************************************************/
+
+#include "conf.h"
+#include "sysdep.h"
+#include "structs.h"
+#include "utils.h"
+#include "comm.h"
+#include "db.h"
+#include "dg_scripts.h"
+#include "worldimg.h"
+
+/* Parsing the .wld files is the slowest part of booting the world: every
+ * line goes through fgets, sscanf and strcat.  After a text boot the rooms
+ * are written out as fixed-size records plus a pool of strings, and the
+ * next boot copies them straight back in, as long as no .wld or .trg file
+ * has changed since (triggers count because rooms attach them by vnum
+ * while loading).  The image holds the rooms exactly as parse_room() left
+ * them, exits still pointing at vnums, so renum_world() and everything
+ * after it runs the same either way.  Zones are not in the image; each
+ * room's zone is worked out again on load. */
+
+static unsigned int wldimg_hash(unsigned int h, const void *data, size_t len)
+{
+  const unsigned char *p = data;
+
+  while (len--)
+    h = (h ^ *p++) * 16777619U;
+
+  return (h);
+}
+
+/* The image checksum: the same idea as wldimg_hash() a word at a time,
+ * which every section allows since each is a multiple of four bytes. */
+static unsigned int wldimg_sum(unsigned int h, const void *data, size_t len)
+{
+  const unsigned int *p = data;
+
+  for (len /= sizeof(*p); len--; )
+    h = (h ^ *p++) * 16777619U;
+
+  return (h);
+}
+
+/* Hash the names, sizes and times of every file the rooms come from and
+ * find the newest of them.  FALSE if a listed file is missing, in which
+ * case the text loader is left to complain about it. */
+static int wldimg_sources(unsigned int *hash, time_t *newest)
+{
+  const char *prefixes[] = { WLD_PREFIX, TRG_PREFIX };
+  const char *index_filename = mini_mud ? MINDEX_FILE : INDEX_FILE;
+  char name[PATH_MAX], path[PATH_MAX];
+  struct stat st;
+  unsigned int h = 2166136261U;
+  FILE *fl;
+  int i;
+
+  *newest = 0;
+  h = wldimg_hash(h, index_filename, strlen(index_filename));
+
+  for (i = 0; i < 2; i++) {
+    snprintf(path, sizeof(path), "%s%s", prefixes[i], index_filename);
+    if (!(fl = fopen(path, "r")))
+      return (FALSE);
+
+    for (*name = '\0'; fscanf(fl, "%s\n", name) == 1 && *name != '$'; ) {
+      snprintf(path, sizeof(path), "%s%s", prefixes[i], name);
+      if (stat(path, &st) < 0) {
+        fclose(fl);
+        return (FALSE);
+      }
+      h = wldimg_hash(h, path, strlen(path) + 1);
+      h = wldimg_hash(h, &st.st_size, sizeof(st.st_size));
+      h = wldimg_hash(h, &st.st_mtime, sizeof(st.st_mtime));
+      *newest = MAX(*newest, st.st_mtime);
+    }
+    fclose(fl);
+  }
+
+  *hash = h;
+  return (TRUE);
+}
+
+/* Check every record of a mapped image against the header, so the rooms
+ * can be built without further tests. */
+static int wldimg_verify(const struct wldimg_header *hdr, const char *base)
+{
+  const struct wldimg_room *room = (const void *) (base + sizeof(*hdr));
+  const struct wldimg_exit *ex = (const void *) (room + hdr->rooms);
+  const struct wldimg_extra *ed = (const void *) (ex + hdr->exits);
+  const char *pool = (const char *) ((const int *) (ed + hdr->extras) + hdr->trigs);
+  unsigned int i;
+
+#define BAD_STR(off)  ((off) != WLDIMG_NULL && (off) >= hdr->pool)
+
+  if (hdr->pool && pool[hdr->pool - 1] != '\0')
+    return (FALSE);
+
+  for (i = 0; i < hdr->rooms; i++) {
+    if (BAD_STR(room[i].name) || BAD_STR(room[i].description))
+      return (FALSE);
+    if (room[i].exit_first > hdr->exits || room[i].exit_count > hdr->exits - room[i].exit_first ||
+        room[i].extra_first > hdr->extras || room[i].extra_count > hdr->extras - room[i].extra_first ||
+        room[i].trig_first > hdr->trigs || room[i].trig_count > hdr->trigs - room[i].trig_first)
+      return (FALSE);
+  }
+  for (i = 0; i < hdr->exits; i++)
+    if (ex[i].dir < 0 || ex[i].dir >= NUM_OF_DIRS ||
+        BAD_STR(ex[i].general_description) || BAD_STR(ex[i].keyword))
+      return (FALSE);
+  for (i = 0; i < hdr->extras; i++)
+    if (BAD_STR(ed[i].keyword) || BAD_STR(ed[i].description))
+      return (FALSE);
+
+#undef BAD_STR
+  return (TRUE);
+}
+
+static char *wldimg_str(const char *pool, unsigned int off)
+{
+  return (off == WLDIMG_NULL ? NULL : strdup(pool + off));
+}
+
+/* Fill 'world' from the image instead of the .wld files.  Returns FALSE,
+ * having touched nothing, if there is no usable image. */
+int wldimg_load(void)
+{
+  const struct wldimg_header *hdr;
+  const struct wldimg_room *room;
+  const struct wldimg_exit *ex;
+  const struct wldimg_extra *ed;
+  const int *trig;
+  const char *base, *pool;
+  struct extra_descr_data *new_descr, **tail;
+  struct room_direction_data *dir;
+  struct stat st;
+  unsigned int sources, i, j;
+  size_t expect;
+  time_t newest;
+  int fd, ok, zone = 0, mapped = FALSE;
+  char *buf = NULL;
+
+  if (no_world_image || scheck || !wldimg_sources(&sources, &newest))
+    return (FALSE);
+
+  if ((fd = open(WLD_IMAGE_FILE, O_RDONLY)) < 0)
+    return (FALSE);
+  if (fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(*hdr) || st.st_mtime < newest) {
+    close(fd);
+    log("   %s is out of date; parsing the room files.", WLD_IMAGE_FILE);
+    return (FALSE);
+  }
+
+#ifdef HAVE_SYS_MMAN_H
+  if ((base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) != MAP_FAILED)
+    mapped = TRUE;
+  else
+#endif
+  {
+    CREATE(buf, char, st.st_size);
+    if (read(fd, buf, st.st_size) != st.st_size) {
+      log("SYSERR: reading %s: %s", WLD_IMAGE_FILE, strerror(errno));
+      free(buf);
+      close(fd);
+      return (FALSE);
+    }
+    base = buf;
+  }
+  close(fd);
+
+  hdr = (const struct wldimg_header *) base;
+  expect = sizeof(*hdr) + (size_t) hdr->rooms * sizeof(struct wldimg_room) +
+           (size_t) hdr->exits * sizeof(struct wldimg_exit) +
+           (size_t) hdr->extras * sizeof(struct wldimg_extra) +
+           (size_t) hdr->trigs * sizeof(int) + hdr->pool;
+
+  ok = !memcmp(hdr->magic, WLDIMG_MAGIC, sizeof(hdr->magic)) &&
+       hdr->version == WLDIMG_VERSION && hdr->byte_order == 0x01020304 &&
+       hdr->sources == sources && hdr->diagonal == (unsigned int) CONFIG_DIAGONAL_DIRS &&
+       hdr->rooms > 0 && expect == (size_t) st.st_size;
+  if (!ok)
+    log("   %s was built from other room files; parsing them instead.", WLD_IMAGE_FILE);
+  else if (!(ok = (wldimg_sum(2166136261U, base + sizeof(*hdr), expect - sizeof(*hdr)) == hdr->checksum &&
+                   wldimg_verify(hdr, base))))
+    log("SYSERR: %s is damaged; parsing the room files instead.", WLD_IMAGE_FILE);
+
+  if (!ok) {
+#ifdef HAVE_SYS_MMAN_H
+    if (mapped)
+      munmap((void *) base, st.st_size);
+#endif
+    if (buf)
+      free(buf);
+    return (FALSE);
+  }
+
+  room = (const struct wldimg_room *) (base + sizeof(*hdr));
+  ex = (const struct wldimg_exit *) (room + hdr->rooms);
+  ed = (const struct wldimg_extra *) (ex + hdr->exits);
+  trig = (const int *) (ed + hdr->extras);
+  pool = (const char *) (trig + hdr->trigs);
+
+  CREATE(world, struct room_data, hdr->rooms);
+  log("   %d rooms, %d bytes, from %s.", hdr->rooms,
+      (int) (sizeof(struct room_data) * hdr->rooms), WLD_IMAGE_FILE);
+
+  for (i = 0; i < hdr->rooms; i++, room++) {
+    /* Same zone walk, and the same complaints, as parse_room(). */
+    if (room->number < zone_table[zone].bot) {
+      log("SYSERR: Room #%d is below zone %d (bot=%d, top=%d).", room->number, zone_table[zone].number, zone_table[zone].bot, zone_table[zone].top);
+      exit(1);
+    }
+    while (room->number > zone_table[zone].top)
+      if (++zone > top_of_zone_table) {
+        log("SYSERR: Room %d is outside of any zone.", room->number);
+        exit(1);
+      }
+
+    world[i].zone = zone;
+    world[i].number = room->number;
+    world[i].sector_type = room->sector_type;
+    for (j = 0; j < RF_ARRAY_MAX; j++)
+      world[i].room_flags[j] = room->room_flags[j];
+    world[i].name = wldimg_str(pool, room->name);
+    world[i].description = wldimg_str(pool, room->description);
+
+    for (j = room->exit_first; j < room->exit_first + room->exit_count; j++) {
+      CREATE(dir, struct room_direction_data, 1);
+      dir->general_description = wldimg_str(pool, ex[j].general_description);
+      dir->keyword = wldimg_str(pool, ex[j].keyword);
+      dir->exit_info = ex[j].exit_info;
+      dir->key = ex[j].key;
+      dir->to_room = ex[j].to_room;
+      world[i].dir_option[ex[j].dir] = dir;
+    }
+
+    for (tail = &world[i].ex_description, j = room->extra_first; j < room->extra_first + room->extra_count; j++) {
+      CREATE(new_descr, struct extra_descr_data, 1);
+      new_descr->keyword = wldimg_str(pool, ed[j].keyword);
+      new_descr->description = wldimg_str(pool, ed[j].description);
+      *tail = new_descr;
+      tail = &new_descr->next;
+    }
+
+    for (j = room->trig_first; j < room->trig_first + room->trig_count; j++)
+      dg_attach_trigger(&world[i], WLD_TRIGGER, trig[j]);
+
+    vnum_index_set(DB_BOOT_WLD, room->number, i);
+    top_of_world = i;
+  }
+
+#ifdef HAVE_SYS_MMAN_H
+  if (mapped)
+    munmap((void *) base, st.st_size);
+#endif
+  if (buf)
+    free(buf);
+
+  return (TRUE);
+}
+
+/* String pool being built by wldimg_save(). */
+static char *pool_buf = NULL;
+static size_t pool_len = 0, pool_size = 0;
+
+static unsigned int pool_add(const char *str)
+{
+  size_t len, off = pool_len;
+
+  if (!str)
+    return (WLDIMG_NULL);
+
+  len = strlen(str) + 1;
+  if (pool_len + len > pool_size) {
+    pool_size = MAX(pool_size * 2, pool_len + len + 65536);
+    RECREATE(pool_buf, char, pool_size);
+  }
+  memcpy(pool_buf + pool_len, str, len);
+  pool_len += len;
+
+  return (off);
+}
+
+/* Write the rooms just parsed from the .wld files out as an image for the
+ * next boot.  Must run before renum_world(). */
+void wldimg_save(void)
+{
+  struct wldimg_header hdr;
+  struct wldimg_room *rooms;
+  struct wldimg_exit *exits;
+  struct wldimg_extra *extras;
+  struct extra_descr_data *desc;
+  struct trig_proto_list *tp;
+  char tmpname[PATH_MAX];
+  unsigned int nex = 0, ned = 0, ntr = 0, h;
+  time_t newest;
+  room_rnum i;
+  int *trigs, j, ok;
+  FILE *fl;
+
+  if (no_world_image || scheck)
+    return;
+
+  memset(&hdr, 0, sizeof(hdr));
+  if (!wldimg_sources(&hdr.sources, &newest))
+    return;
+
+  for (i = 0; i <= top_of_world; i++) {
+    for (j = 0; j < NUM_OF_DIRS; j++)
+      nex += (world[i].dir_option[j] != NULL);
+    for (desc = world[i].ex_description; desc; desc = desc->next)
+      ned++;
+    for (tp = world[i].proto_script; tp; tp = tp->next)
+      ntr++;
+  }
+
+  CREATE(rooms, struct wldimg_room, top_of_world + 1);
+  CREATE(exits, struct wldimg_exit, MAX(nex, 1));
+  CREATE(extras, struct wldimg_extra, MAX(ned, 1));
+  CREATE(trigs, int, MAX(ntr, 1));
+  nex = ned = ntr = 0;
+  pool_len = 0;
+
+  for (i = 0; i <= top_of_world; i++) {
+    struct wldimg_room *r = &rooms[i];
+
+    r->number = world[i].number;
+    r->sector_type = world[i].sector_type;
+    for (j = 0; j < RF_ARRAY_MAX; j++)
+      r->room_flags[j] = world[i].room_flags[j];
+    r->name = pool_add(world[i].name);
+    r->description = pool_add(world[i].description);
+
+    r->exit_first = nex;
+    for (j = 0; j < NUM_OF_DIRS; j++) {
+      struct room_direction_data *dir = world[i].dir_option[j];
+
+      if (!dir)
+        continue;
+      exits[nex].dir = j;
+      exits[nex].general_description = pool_add(dir->general_description);
+      exits[nex].keyword = pool_add(dir->keyword);
+      exits[nex].exit_info = dir->exit_info;
+      exits[nex].key = dir->key;
+      exits[nex].to_room = dir->to_room;
+      nex++;
+    }
+    r->exit_count = nex - r->exit_first;
+
+    r->extra_first = ned;
+    for (desc = world[i].ex_description; desc; desc = desc->next, ned++) {
+      extras[ned].keyword = pool_add(desc->keyword);
+      extras[ned].description = pool_add(desc->description);
+    }
+    r->extra_count = ned - r->extra_first;
+
+    r->trig_first = ntr;
+    for (tp = world[i].proto_script; tp; tp = tp->next)
+      trigs[ntr++] = tp->vnum;
+    r->trig_count = ntr - r->trig_first;
+  }
+
+  /* Keep the pool's length a multiple of four like everything else. */
+  while (pool_len % 4)
+    pool_add("");
+
+  memcpy(hdr.magic, WLDIMG_MAGIC, sizeof(hdr.magic));
+  hdr.version = WLDIMG_VERSION;
+  hdr.byte_order = 0x01020304;
+  hdr.diagonal = CONFIG_DIAGONAL_DIRS;
+  hdr.rooms = top_of_world + 1;
+  hdr.exits = nex;
+  hdr.extras = ned;
+  hdr.trigs = ntr;
+  hdr.pool = pool_len;
+
+  h = wldimg_sum(2166136261U, rooms, sizeof(*rooms) * hdr.rooms);
+  h = wldimg_sum(h, exits, sizeof(*exits) * nex);
+  h = wldimg_sum(h, extras, sizeof(*extras) * ned);
+  h = wldimg_sum(h, trigs, sizeof(*trigs) * ntr);
+  hdr.checksum = wldimg_sum(h, pool_buf, pool_len);
+
+  /* Written under another name and renamed, so a crash part way through
+   * leaves the old image or none rather than half of one. */
+  snprintf(tmpname, sizeof(tmpname), "%s.tmp", WLD_IMAGE_FILE);
+  if (!(fl = fopen(tmpname, "wb"))) {
+    log("SYSERR: Unable to write room image %s: %s", tmpname, strerror(errno));
+  } else {
+    ok = fwrite(&hdr, sizeof(hdr), 1, fl) == 1 &&
+         fwrite(rooms, sizeof(*rooms), hdr.rooms, fl) == hdr.rooms &&
+         fwrite(exits, sizeof(*exits), nex, fl) == nex &&
+         fwrite(extras, sizeof(*extras), ned, fl) == ned &&
+         fwrite(trigs, sizeof(*trigs), ntr, fl) == ntr &&
+         fwrite(pool_buf, 1, pool_len, fl) == pool_len;
+    if (fclose(fl) != 0)
+      ok = FALSE;
+
+    if (!ok || rename(tmpname, WLD_IMAGE_FILE) < 0) {
+      log("SYSERR: Unable to write room image %s: %s", WLD_IMAGE_FILE, strerror(errno));
+      unlink(tmpname);
+    } else
+      log("   Wrote %s for the next boot.", WLD_IMAGE_FILE);
+  }
+
+  free(rooms);
+  free(exits);
+  free(extras);
+  free(trigs);
+  free(pool_buf);
+  pool_buf = NULL;
+  pool_size = pool_len = 0;
+}
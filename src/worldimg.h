@@ -0,0 +1,58 @@
+/**************************************************************************
+*  File: worldimg.h                                        Part of tbaMUD *
+*  Usage: Compiled image of the room files, loaded instead of parsing.    *
+*                                                                         *
+*  All rights reserved.  See license for complete information.            *
+*                                                                         *
+*  Copyright (C) 1993, 94 by the Trustees of the Johns Hopkins University *
+*  CircleMUD is based on DikuMUD, Copyright (C) 1990, 1991.               *
+**************************************************************************/
+#ifndef WORLDIMG_H_
+#define WORLDIMG_H_
+
+/* Bump whenever the layout below or what gets stored changes. */
+#define WLDIMG_VERSION  1
+#define WLDIMG_MAGIC    "tbaWLD\032"   /* 8 bytes with the NUL */
+#define WLDIMG_NULL     0xFFFFFFFFU    /* string offset standing for NULL */
+
+/* The file is the header followed by four arrays of fixed-size records and
+ * then the string pool, every section 4-byte aligned, in native byte
+ * order.  Strings are stored as offsets into the pool. */
+struct wldimg_header {
+  char magic[8];
+  unsigned int version;
+  unsigned int byte_order;  /**< 0x01020304 as the writer saw it */
+  unsigned int sources;     /**< hash of the names, sizes and times of the
+                                 .wld and .trg files it was built from */
+  unsigned int diagonal;    /**< CONFIG_DIAGONAL_DIRS when built */
+  unsigned int rooms, exits, extras, trigs;
+  unsigned int pool;        /**< bytes in the string pool */
+  unsigned int checksum;    /**< FNV-1a, by words, of everything after it */
+};
+
+struct wldimg_room {
+  int number;
+  int sector_type;
+  int room_flags[RF_ARRAY_MAX];
+  unsigned int name, description;
+  unsigned int exit_first, extra_first, trig_first; /**< record indexes */
+  unsigned short exit_count, extra_count, trig_count, unused;
+};
+
+struct wldimg_exit {
+  int dir;
+  unsigned int general_description, keyword;
+  int exit_info;
+  int key;
+  int to_room;             /**< still a vnum, as before renum_world() */
+};
+
+struct wldimg_extra {
+  unsigned int keyword, description;
+};
+
+/* Exported function prototypes */
+int wldimg_load(void);
+void wldimg_save(void);
+
+#endif /* WORLDIMG_H_ */